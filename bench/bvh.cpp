@@ -0,0 +1,145 @@
+#include <svke/bvh.hpp>
+#include <svke/camera.hpp>
+#include <svke/job_system.hpp>
+
+#include "harness.hpp"
+
+#include <random>
+
+// Build, refit and query times of Bvh over scenes of 10k, 100k and 1M small boxes spread at a constant density,
+// next to a linear scan over all boxes for reference. No Vulkan device is needed. Takes the harness options, see
+// harness.hpp, for example:
+//
+//   bench-bvh --filter 100k
+
+struct BvhScene {
+  std::string                name;
+  std::vector<svke::AABB>    bounds;
+  std::unique_ptr<svke::Bvh> bvh;
+};
+
+constexpr float    DENSITY        = 0.01f;  // Boxes per cubic unit
+constexpr float    MOVED_FRACTION = 0.01f;
+constexpr uint32_t QUERY_COUNT    = 64;
+
+static std::vector<svke::AABB> RandomBounds(uint32_t count, std::mt19937& rng) {
+  const float half_side = 0.5f * std::cbrt(count / DENSITY);
+
+  std::uniform_real_distribution<float> position {-half_side, half_side};
+  std::uniform_real_distribution<float> size {0.25f, 1.0f};
+
+  std::vector<svke::AABB> bounds(count);
+
+  for (auto& box : bounds) {
+    glm::vec3 center {position(rng), position(rng), position(rng)};
+    glm::vec3 extent {size(rng), size(rng), size(rng)};
+
+    box = {center - extent, center + extent};
+  }
+
+  return bounds;
+}
+
+int main(int argc, char** argv) {
+  bench::Harness  harness {argc, argv};
+  svke::JobSystem job_system {};
+  std::mt19937    rng {42};
+
+  std::uniform_real_distribution<float> unit {-1.0f, 1.0f};
+
+  // Queries start from around the middle of the scene, where the density is the same at every scene size
+  std::vector<svke::Frustum> frustums;
+  std::vector<svke::Sphere>  spheres;
+  std::vector<svke::Ray>     rays;
+
+  for (uint32_t i = 0; i < QUERY_COUNT; i++) {
+    glm::vec3 origin {unit(rng) * 5.0f, unit(rng) * 5.0f, unit(rng) * 5.0f};
+    glm::vec3 direction = glm::normalize(glm::vec3 {unit(rng), unit(rng), unit(rng)} + glm::vec3 {0.0f, 0.0f, 2.0f});
+
+    svke::Camera camera {};
+    camera.UsePerspectiveProjection(glm::radians(50.0f), 16.0f / 9.0f, 0.1f, 50.0f);
+    camera.SetViewDirection(origin, direction);
+
+    frustums.push_back(svke::Frustum::FromMatrix(camera.getProjectionMatrix() * camera.getViewMatrix()));
+    spheres.push_back({origin, 10.0f});
+    rays.push_back({origin, direction});
+  }
+
+  std::vector<BvhScene> scenes;
+  scenes.push_back({"10k", RandomBounds(10000, rng), std::make_unique<svke::Bvh>()});
+  scenes.push_back({"100k", RandomBounds(100000, rng), std::make_unique<svke::Bvh>()});
+  scenes.push_back({"1M", RandomBounds(1000000, rng), std::make_unique<svke::Bvh>()});
+
+  std::vector<uint32_t> results;
+
+  for (auto& scene : scenes) {
+    const uint32_t count = static_cast<uint32_t>(scene.bounds.size());
+
+    scene.bvh->Build(job_system, scene.bounds);
+
+    harness.Add("Bvh::Build " + scene.name, [&](uint64_t iterations) {
+      for (uint64_t i = 0; i < iterations; i++) {
+        scene.bvh->Build(job_system, scene.bounds);
+      }
+    });
+
+    // Moves a fraction of the boxes by a small step each frame and back on the next, so the tree keeps its quality
+    harness.Add("Bvh::Refit " + scene.name + " (1% moved)", [&, count](uint64_t iterations) {
+      const uint32_t moved = static_cast<uint32_t>(count * MOVED_FRACTION);
+
+      for (uint64_t i = 0; i < iterations; i++) {
+        glm::vec3 step {(i % 2 == 0) ? 0.1f : -0.1f, 0.0f, 0.0f};
+
+        for (uint32_t j = 0; j < moved; j++) {
+          uint32_t    item = (j * 7919u) % count;
+          svke::AABB& box  = scene.bounds[item];
+
+          box = {box.min + step, box.max + step};
+          scene.bvh->Update(item, box);
+        }
+
+        scene.bvh->Refit(job_system);
+      }
+    });
+
+    harness.Add("Bvh::QueryFrustum " + scene.name, [&](uint64_t iterations) {
+      for (uint64_t i = 0; i < iterations; i++) {
+        results.clear();
+        scene.bvh->QueryFrustum(frustums[i % QUERY_COUNT], results);
+        bench::DoNotOptimize(results.size());
+      }
+    });
+
+    harness.Add("Linear frustum " + scene.name, [&](uint64_t iterations) {
+      for (uint64_t i = 0; i < iterations; i++) {
+        const auto& frustum = frustums[i % QUERY_COUNT];
+
+        results.clear();
+
+        for (uint32_t item = 0; item < scene.bounds.size(); item++) {
+          if (frustum.Intersects(scene.bounds[item])) {
+            results.push_back(item);
+          }
+        }
+
+        bench::DoNotOptimize(results.size());
+      }
+    });
+
+    harness.Add("Bvh::QuerySphere " + scene.name, [&](uint64_t iterations) {
+      for (uint64_t i = 0; i < iterations; i++) {
+        results.clear();
+        scene.bvh->QuerySphere(spheres[i % QUERY_COUNT], results);
+        bench::DoNotOptimize(results.size());
+      }
+    });
+
+    harness.Add("Bvh::Raycast " + scene.name, [&](uint64_t iterations) {
+      for (uint64_t i = 0; i < iterations; i++) {
+        bench::DoNotOptimize(scene.bvh->Raycast(rays[i % QUERY_COUNT]));
+      }
+    });
+  }
+
+  return harness.Run();
+}
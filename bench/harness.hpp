@@ -0,0 +1,238 @@
+#ifndef SVKE_BENCH_HARNESS_HPP
+#define SVKE_BENCH_HARNESS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Minimal micro-benchmark harness. Each benchmark runs its operation a given number of times, the harness calibrates
+// that count until a sample takes SAMPLE_TIME, warms up and then takes repeated samples, reporting the median time
+// per operation and its median absolute deviation. Results can be saved as a baseline and later compared against it,
+// a benchmark whose median got slower by more than the threshold and by more than its noise counts as a regression
+// and makes the process exit with 1. Unknown options and baselines that cannot be read or written exit with 2, so a
+// typo in a path never passes for a clean comparison.
+//
+//   [--filter substring] [--samples N] [--threshold percent] [--baseline path] [--save-baseline path]
+
+namespace bench {
+  // Keeps the compiler from optimizing away a value or the computation that produced it
+  template <typename T>
+  inline void DoNotOptimize(const T& value) {
+    __asm__ __volatile__("" : : "r,m"(value) : "memory");
+  }
+
+  struct Result {
+    std::string name;
+    double      median_ns;  // Per operation
+    double      mad_ns;
+    double      min_ns;
+    uint64_t    iterations;  // Per sample
+  };
+
+  class Harness {
+   public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds SAMPLE_TIME {10};
+    static constexpr uint32_t                  WARMUP_SAMPLES = 3;
+
+   public:
+    Harness(int argc, char** argv) {
+      for (int i = 1; i < argc; i++) {
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : ""; };
+
+        if (std::strcmp(argv[i], "--filter") == 0) {
+          pFilter = next();
+        } else if (std::strcmp(argv[i], "--samples") == 0) {
+          pSamples = static_cast<uint32_t>(std::max(std::atoi(next()), 3));
+        } else if (std::strcmp(argv[i], "--threshold") == 0) {
+          pThreshold = std::atof(next()) / 100.0;
+        } else if (std::strcmp(argv[i], "--baseline") == 0) {
+          pBaselinePath = next();
+        } else if (std::strcmp(argv[i], "--save-baseline") == 0) {
+          pSavePath = next();
+        } else {
+          std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+          std::exit(2);
+        }
+      }
+    }
+
+    // operation runs the measured code the given number of times
+    void Add(const std::string& name, std::function<void(uint64_t iterations)> operation) {
+      if (pFilter.empty() || name.find(pFilter) != std::string::npos) {
+        pBenchmarks.push_back({name, std::move(operation)});
+      }
+    }
+
+    int Run() {
+      std::unordered_map<std::string, double> baseline = pLoadBaseline();
+
+      std::printf("%-44s %12s %8s %12s %9s\n", "benchmark", "median (ns)", "mad", "baseline", "change");
+
+      std::vector<Result> results;
+      uint32_t            regressions = 0;
+
+      for (const auto& benchmark : pBenchmarks) {
+        Result result = pMeasure(benchmark.name, benchmark.operation);
+        results.push_back(result);
+
+        std::printf("%-44s %12.2f %7.1f%%", result.name.c_str(), result.median_ns, pRelative(result.mad_ns, result));
+
+        auto found = baseline.find(result.name);
+
+        if (found == baseline.end()) {
+          std::printf(" %12s %9s\n", "-", "-");
+          continue;
+        }
+
+        double change     = (result.median_ns - found->second) / found->second;
+        bool   regression = change > pThreshold && result.median_ns - found->second > 3.0 * result.mad_ns;
+
+        std::printf(" %12.2f %+8.1f%%%s\n", found->second, change * 100.0, regression ? "  REGRESSION" : "");
+
+        regressions += regression ? 1 : 0;
+      }
+
+      if (!pSavePath.empty()) {
+        pSaveBaseline(results);
+      }
+
+      if (regressions > 0) {
+        std::printf("%u regression(s) over %.1f%%\n", regressions, pThreshold * 100.0);
+        return 1;
+      }
+
+      return 0;
+    }
+
+   private:
+    struct Benchmark {
+      std::string                              name;
+      std::function<void(uint64_t iterations)> operation;
+    };
+
+    static double pRelative(double value, const Result& result) {
+      return result.median_ns > 0.0 ? value / result.median_ns * 100.0 : 0.0;
+    }
+
+    static double pMedian(std::vector<double> values) {
+      std::sort(values.begin(), values.end());
+      size_t middle = values.size() / 2;
+
+      return values.size() % 2 == 0 ? (values[middle - 1] + values[middle]) / 2.0 : values[middle];
+    }
+
+    static double pTime(const std::function<void(uint64_t)>& operation, uint64_t iterations) {
+      auto start = clock::now();
+      operation(iterations);
+      return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    }
+
+    Result pMeasure(const std::string& name, const std::function<void(uint64_t)>& operation) {
+      const double sample_ns = std::chrono::duration<double, std::nano>(SAMPLE_TIME).count();
+
+      uint64_t iterations = 1;
+
+      while (true) {
+        double elapsed = pTime(operation, iterations);
+
+        if (elapsed >= sample_ns || iterations >= (uint64_t {1} << 40)) {
+          break;
+        }
+
+        // Aim straight for the sample time once the measurement is long enough to trust, double otherwise
+        iterations = elapsed > sample_ns / 100.0 ? static_cast<uint64_t>(iterations * sample_ns / elapsed * 1.1) + 1
+                                                 : iterations * 2;
+      }
+
+      for (uint32_t i = 0; i < WARMUP_SAMPLES; i++) {
+        pTime(operation, iterations);
+      }
+
+      std::vector<double> samples(pSamples);
+
+      for (auto& sample : samples) {
+        sample = pTime(operation, iterations) / iterations;
+      }
+
+      double              median = pMedian(samples);
+      std::vector<double> deviations(samples.size());
+
+      for (size_t i = 0; i < samples.size(); i++) {
+        deviations[i] = std::abs(samples[i] - median);
+      }
+
+      return {name, median, pMedian(deviations), *std::min_element(samples.begin(), samples.end()), iterations};
+    }
+
+    // One benchmark per line, the median in nanoseconds after a tab
+    std::unordered_map<std::string, double> pLoadBaseline() {
+      std::unordered_map<std::string, double> baseline;
+
+      if (pBaselinePath.empty()) {
+        return baseline;
+      }
+
+      std::ifstream file {pBaselinePath};
+
+      if (!file.is_open()) {
+        std::fprintf(stderr, "Failed to open baseline %s\n", pBaselinePath.c_str());
+        std::exit(2);
+      }
+
+      std::string line;
+
+      while (std::getline(file, line)) {
+        size_t tab = line.rfind('\t');
+
+        if (tab != std::string::npos) {
+          baseline[line.substr(0, tab)] = std::atof(line.c_str() + tab + 1);
+        }
+      }
+
+      if (file.bad()) {
+        std::fprintf(stderr, "Failed to read baseline %s\n", pBaselinePath.c_str());
+        std::exit(2);
+      }
+
+      return baseline;
+    }
+
+    void pSaveBaseline(const std::vector<Result>& results) {
+      std::ofstream file {pSavePath, std::ios::trunc};
+
+      if (!file.is_open()) {
+        std::fprintf(stderr, "Failed to write baseline %s\n", pSavePath.c_str());
+        std::exit(2);
+      }
+
+      for (const auto& result : results) {
+        file << result.name << '\t' << result.median_ns << '\n';
+      }
+
+      if (!file.flush()) {
+        std::fprintf(stderr, "Failed to write baseline %s\n", pSavePath.c_str());
+        std::exit(2);
+      }
+    }
+
+   private:
+    std::vector<Benchmark> pBenchmarks;
+    std::string            pFilter;
+    uint32_t               pSamples {25};
+    double                 pThreshold {0.05};
+    std::string            pBaselinePath;
+    std::string            pSavePath;
+  };
+}
+
+#endif
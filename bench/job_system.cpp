@@ -0,0 +1,106 @@
+#include <svke/camera.hpp>
+#include <svke/draw_list.hpp>
+#include <svke/game_object.hpp>
+#include <svke/job_system.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+// CPU side of a frame over a 100k object scene (transform update, culling, sort key generation and sorting) run on job
+// systems from 1 to N threads. No Vulkan device is needed, every object uses the same unit cube bounds.
+
+constexpr uint32_t OBJECT_COUNT  = 100000;
+constexpr uint32_t WARMUP_FRAMES = 10;
+constexpr uint32_t FRAMES        = 200;
+
+struct BenchObject {
+  svke::TransformComponent transform;
+  uint32_t                 model_id;
+};
+
+static double RunFrames(svke::JobSystem& job_system, std::vector<BenchObject>& objects) {
+  svke::DrawList        draw_list;
+  svke::DrawListBuilder builder;
+  svke::AABB            cube_bounds {glm::vec3 {-0.5f}, glm::vec3 {0.5f}};
+
+  svke::Camera camera {};
+  camera.UsePerspectiveProjection(glm::radians(50.0f), 1.0f, 0.1f, 100.0f);
+  camera.SetViewTarget(glm::vec3 {0.0f, 0.0f, -60.0f}, glm::vec3 {0.0f});
+
+  builder.Resize(OBJECT_COUNT);
+
+  double total_ms = 0.0;
+
+  for (uint32_t frame = 0; frame < WARMUP_FRAMES + FRAMES; frame++) {
+    auto start = std::chrono::steady_clock::now();
+
+    svke::JobCounter transform_counter;
+
+    job_system.ParallelFor(
+        0,
+        OBJECT_COUNT,
+        svke::DrawListBuilder::GRAIN,
+        [&](uint32_t begin, uint32_t end) {
+          for (uint32_t i = begin; i < end; i++) {
+            auto& transform = objects[i].transform;
+
+            transform.rotation.y = glm::mod(transform.rotation.y + 0.001f, glm::two_pi<float>());
+            transform.rotation.x = glm::mod(transform.rotation.x + 0.0005f, glm::two_pi<float>());
+
+            builder.SetObject(i, transform.matrix(), cube_bounds, 0, objects[i].model_id, i);
+          }
+        },
+        transform_counter);
+
+    builder.Build(job_system, camera.getProjectionMatrix(), camera.getViewMatrix(), draw_list, &transform_counter);
+
+    auto end = std::chrono::steady_clock::now();
+
+    if (frame >= WARMUP_FRAMES) {
+      total_ms += std::chrono::duration<double, std::milli>(end - start).count();
+    }
+  }
+
+  return total_ms / FRAMES;
+}
+
+int main(int argc, char** argv) {
+  uint32_t max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+  if (argc > 1) {
+    max_threads = static_cast<uint32_t>(std::max(std::atoi(argv[1]), 1));
+  }
+
+  std::mt19937                          rng {42};
+  std::uniform_real_distribution<float> position {-50.0f, 50.0f};
+  std::uniform_real_distribution<float> angle {0.0f, glm::two_pi<float>()};
+
+  std::vector<BenchObject> objects(OBJECT_COUNT);
+
+  for (uint32_t i = 0; i < OBJECT_COUNT; i++) {
+    objects[i].transform.translation = {position(rng), position(rng), position(rng)};
+    objects[i].transform.scale       = glm::vec3 {0.5f};
+    objects[i].transform.rotation    = {angle(rng), angle(rng), 0.0f};
+    objects[i].model_id              = i % 64;
+  }
+
+  std::printf("%u objects, %u frames\n", OBJECT_COUNT, FRAMES);
+  std::printf("%8s %12s %8s\n", "threads", "frame (ms)", "speedup");
+
+  double single_thread_ms = 0.0;
+
+  for (uint32_t threads = 1; threads <= max_threads; threads++) {
+    svke::JobSystem job_system {threads - 1};
+
+    double frame_ms = RunFrames(job_system, objects);
+
+    if (threads == 1) {
+      single_thread_ms = frame_ms;
+    }
+
+    std::printf("%8u %12.3f %7.2fx\n", threads, frame_ms, single_thread_ms / frame_ms);
+  }
+
+  return 0;
+}
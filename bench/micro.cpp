@@ -0,0 +1,191 @@
+#include <svke/camera.hpp>
+#include <svke/draw_list.hpp>
+#include <svke/game_object.hpp>
+#include <svke/game_object_pool.hpp>
+#include <svke/job_system.hpp>
+#include <svke/scene_graph.hpp>
+
+#include "harness.hpp"
+
+#include <random>
+
+// Micro-benchmarks of CPU side hot paths: transform matrices, camera matrices, the per object work of
+// SimpleRenderSystem::RenderGameObjects, scene graph updates and game object churn. Only CPU only modules are used,
+// so it builds against the engine's core objects alone and runs without Vulkan or GLFW installed. See harness.hpp for
+// the options, for example:
+//
+//   bench-micro --save-baseline micro.baseline
+//   bench-micro --baseline micro.baseline
+
+constexpr uint32_t TRANSFORM_COUNT = 1024;
+constexpr uint32_t OBJECT_COUNT    = 10000;
+
+static std::vector<svke::TransformComponent> RandomTransforms(uint32_t count) {
+  std::mt19937                          rng {42};
+  std::uniform_real_distribution<float> position {-50.0f, 50.0f};
+  std::uniform_real_distribution<float> angle {0.0f, glm::two_pi<float>()};
+
+  std::vector<svke::TransformComponent> transforms(count);
+
+  for (auto& transform : transforms) {
+    transform.translation = {position(rng), position(rng), position(rng)};
+    transform.scale       = glm::vec3 {0.5f};
+    transform.rotation    = {angle(rng), angle(rng), angle(rng)};
+  }
+
+  return transforms;
+}
+
+int main(int argc, char** argv) {
+  bench::Harness harness {argc, argv};
+
+  auto transforms = RandomTransforms(TRANSFORM_COUNT);
+
+  harness.Add("TransformComponent::matrix", [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+      bench::DoNotOptimize(transforms[i % TRANSFORM_COUNT].matrix());
+    }
+  });
+
+  harness.Add("TransformComponent::Interpolate", [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+      const auto& from = transforms[i % TRANSFORM_COUNT];
+      const auto& to   = transforms[(i + 1) % TRANSFORM_COUNT];
+
+      bench::DoNotOptimize(svke::TransformComponent::Interpolate(from, to, 0.5f));
+    }
+  });
+
+  svke::Camera camera {};
+
+  harness.Add("Camera::UsePerspectiveProjection", [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+      camera.UsePerspectiveProjection(glm::radians(50.0f), 1.0f + (i & 7) * 0.1f, 0.1f, 100.0f);
+      bench::DoNotOptimize(camera.getProjectionMatrix());
+    }
+  });
+
+  harness.Add("Camera::SetViewDirection", [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+      const auto& transform = transforms[i % TRANSFORM_COUNT];
+
+      camera.SetViewDirection(transform.translation, glm::normalize(transform.rotation + 0.1f));
+      bench::DoNotOptimize(camera.getViewMatrix());
+    }
+  });
+
+  harness.Add("Camera::SetViewYXZ", [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+      const auto& transform = transforms[i % TRANSFORM_COUNT];
+
+      camera.SetViewYXZ(transform.translation, transform.rotation);
+      bench::DoNotOptimize(camera.getViewMatrix());
+    }
+  });
+
+  // The CPU side of RenderGameObjects for a 10k object scene on a single thread, interpolating transforms, then
+  // culling, keying and sorting. Draw recording needs a device and is left out. Reported per object.
+  auto                  objects = RandomTransforms(OBJECT_COUNT);
+  auto                  targets = RandomTransforms(OBJECT_COUNT);
+  svke::JobSystem       job_system {0};
+  svke::DrawList        draw_list;
+  svke::DrawListBuilder builder;
+  svke::AABB            cube_bounds {glm::vec3 {-0.5f}, glm::vec3 {0.5f}};
+
+  camera.UsePerspectiveProjection(glm::radians(50.0f), 1.0f, 0.1f, 100.0f);
+  camera.SetViewTarget(glm::vec3 {0.0f, 0.0f, -60.0f}, glm::vec3 {0.0f});
+  builder.Resize(OBJECT_COUNT);
+
+  harness.Add("RenderGameObjects per object (10k)", [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+      uint32_t index = static_cast<uint32_t>(i % OBJECT_COUNT);
+
+      auto transform = svke::TransformComponent::Interpolate(objects[index], targets[index], 0.5f);
+      builder.SetObject(index, transform.matrix(), cube_bounds, 0, index % 64, index);
+
+      if (index == OBJECT_COUNT - 1) {
+        builder.Build(job_system, camera.getProjectionMatrix(), camera.getViewMatrix(), draw_list);
+        bench::DoNotOptimize(draw_list.getSize());
+      }
+    }
+  });
+
+  // A 10k node hierarchy of 100 roots with 100 children each. Changing a leaf recomputes one world matrix, changing a
+  // root recomputes its 101 node subtree and nothing else.
+  svke::SceneGraph             scene_graph;
+  std::vector<svke::SceneNode> roots, leaves;
+
+  for (uint32_t i = 0; i < OBJECT_COUNT; i++) {
+    if (i % 100 == 0) {
+      roots.push_back(scene_graph.Create(objects[i]));
+    } else {
+      leaves.push_back(scene_graph.Create(objects[i], roots.back()));
+    }
+  }
+
+  scene_graph.Update();
+
+  harness.Add("SceneGraph::Update one leaf (10k)", [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+      svke::SceneNode node = leaves[i % leaves.size()];
+
+      scene_graph.SetLocal(node, targets[i % OBJECT_COUNT]);
+      scene_graph.Update();
+      bench::DoNotOptimize(scene_graph.getWorld(node));
+    }
+  });
+
+  harness.Add("SceneGraph::Update one root (10k)", [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+      svke::SceneNode node = roots[i % roots.size()];
+
+      scene_graph.SetLocal(node, targets[i % OBJECT_COUNT]);
+      scene_graph.Update();
+      bench::DoNotOptimize(scene_graph.getWorld(node));
+    }
+  });
+
+  // Spawning and despawning against a 10k object pool, destroying a random live object and creating one in its place.
+  // Reported per pair, along with a pass over the dense objects to show iteration stays packed under churn.
+  svke::GameObjectPool                pool;
+  std::vector<svke::GameObject::id_t> handles;
+  std::mt19937                        rng {42};
+
+  pool.Reserve(OBJECT_COUNT);
+
+  for (uint32_t i = 0; i < OBJECT_COUNT; i++) {
+    auto& object     = pool.Create();
+    object.Transform = objects[i];
+    handles.push_back(object.getId());
+  }
+
+  harness.Add("GameObjectPool destroy and create (10k)", [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+      uint32_t slot = rng() % OBJECT_COUNT;
+
+      pool.Destroy(handles[slot]);
+
+      auto& object     = pool.Create();
+      object.Transform = targets[slot];
+      handles[slot]    = object.getId();
+    }
+
+    bench::DoNotOptimize(pool.getSize());
+  });
+
+  harness.Add("GameObjectPool iterate per object (10k)", [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations;) {
+      for (auto& object : pool) {
+        object.PreviousTransform = object.Transform;
+
+        if (++i == iterations) {
+          break;
+        }
+      }
+    }
+
+    bench::DoNotOptimize(pool[0].PreviousTransform);
+  });
+
+  return harness.Run();
+}
@@ -0,0 +1,300 @@
+#include <svke/camera.hpp>
+#include <svke/device.hpp>
+#include <svke/game_object.hpp>
+#include <svke/game_object_pool.hpp>
+#include <svke/job_system.hpp>
+#include <svke/model.hpp>
+#include <svke/model_registry.hpp>
+#include <svke/pipeline_library.hpp>
+#include <svke/renderer.hpp>
+#include <svke/simple_render_system.hpp>
+#include <svke/window.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+// Renders a synthetic scene of cubes for a fixed number of frames in an invisible window and writes frame rate, frame,
+// CPU and GPU time percentiles and bind counts as JSON. Run from the directory holding shaders/, on a machine without
+// a display under xvfb-run, and with SVKE_DEVICE=llvmpipe to use lavapipe.
+//
+//   bench-scene [--objects N] [--models N] [--animated] [--no-occlusion] [--frames N] [--warmup N] [--output path]
+
+struct BenchOptions {
+  uint32_t    objects  = 10000;
+  uint32_t    models   = 1;
+  bool        animated  = false;
+  bool        occlusion = true;
+  uint32_t    frames    = 500;
+  uint32_t    warmup    = 50;
+  std::string output;
+};
+
+struct Percentiles {
+  double mean = 0.0;
+  double p50  = 0.0;
+  double p95  = 0.0;
+  double p99  = 0.0;
+  double max  = 0.0;
+};
+
+static Percentiles ComputePercentiles(std::vector<double> samples) {
+  Percentiles result;
+
+  if (samples.empty()) {
+    return result;
+  }
+
+  std::sort(samples.begin(), samples.end());
+
+  auto rank = [&](double fraction) {
+    size_t index = static_cast<size_t>(std::ceil(fraction * samples.size()));
+    return samples[std::min(std::max(index, size_t {1}), samples.size()) - 1];
+  };
+
+  for (double sample : samples) {
+    result.mean += sample;
+  }
+
+  result.mean /= samples.size();
+  result.p50 = rank(0.50);
+  result.p95 = rank(0.95);
+  result.p99 = rank(0.99);
+  result.max = samples.back();
+
+  return result;
+}
+
+static void WritePercentiles(FILE* file, const char* name, const Percentiles& percentiles, bool last = false) {
+  std::fprintf(file,
+               "  \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}%s\n",
+               name,
+               percentiles.mean,
+               percentiles.p50,
+               percentiles.p95,
+               percentiles.p99,
+               percentiles.max,
+               last ? "" : ",");
+}
+
+static BenchOptions ParseOptions(int argc, char** argv) {
+  BenchOptions options;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char* {
+      if (i + 1 >= argc) {
+        throw std::runtime_error(std::string("Missing value for ") + argv[i]);
+      }
+
+      return argv[++i];
+    };
+
+    if (std::strcmp(argv[i], "--objects") == 0) {
+      options.objects = static_cast<uint32_t>(std::max(std::atoi(next()), 1));
+    } else if (std::strcmp(argv[i], "--models") == 0) {
+      options.models = static_cast<uint32_t>(std::max(std::atoi(next()), 1));
+    } else if (std::strcmp(argv[i], "--animated") == 0) {
+      options.animated = true;
+    } else if (std::strcmp(argv[i], "--no-occlusion") == 0) {
+      options.occlusion = false;
+    } else if (std::strcmp(argv[i], "--frames") == 0) {
+      options.frames = static_cast<uint32_t>(std::max(std::atoi(next()), 1));
+    } else if (std::strcmp(argv[i], "--warmup") == 0) {
+      options.warmup = static_cast<uint32_t>(std::max(std::atoi(next()), 0));
+    } else if (std::strcmp(argv[i], "--output") == 0) {
+      options.output = next();
+    } else {
+      throw std::runtime_error(std::string("Unknown option ") + argv[i]);
+    }
+  }
+
+  options.models = std::min(options.models, options.objects);
+
+  return options;
+}
+
+// Unit cube with a single color, so that unique models differ in their buffers but not in their cost
+static std::unique_ptr<svke::Model> CreateCube(svke::Device& device, glm::vec3 color) {
+  const glm::vec3 corners[8] = {
+      {-.5f, -.5f, -.5f},
+      {.5f, -.5f, -.5f},
+      {.5f, .5f, -.5f},
+      {-.5f, .5f, -.5f},
+      {-.5f, -.5f, .5f},
+      {.5f, -.5f, .5f},
+      {.5f, .5f, .5f},
+      {-.5f, .5f, .5f},
+  };
+
+  std::vector<svke::Model::Vertex> vertices;
+
+  for (const auto& corner : corners) {
+    vertices.push_back({corner, color});
+  }
+
+  std::vector<uint32_t> indices = {0, 2, 1, 0, 3, 2, 4, 5, 6, 4, 6, 7, 0, 1, 5, 0, 5, 4,
+                                   3, 6, 2, 3, 7, 6, 0, 4, 7, 0, 7, 3, 1, 2, 6, 1, 6, 5};
+
+  return std::make_unique<svke::Model>(device, vertices, indices);
+}
+
+int main(int argc, char** argv) {
+  BenchOptions options = ParseOptions(argc, argv);
+
+  svke::Window             window {1280, 720, "svke bench", false};
+  svke::Device             device {window};
+  svke::Renderer           renderer {window, device, svke::SwapChainConfig::FromEnvironment()};
+  svke::PipelineLibrary    pipeline_library {device};
+  svke::SimpleRenderSystem render_system {device, pipeline_library, renderer};
+  svke::JobSystem          job_system {};
+
+  renderer.getHiZPyramid().SetEnabled(options.occlusion);
+
+  std::mt19937                          rng {42};
+  std::uniform_real_distribution<float> unit {0.0f, 1.0f};
+
+  svke::ModelRegistry            registry {device};
+  std::vector<svke::ModelHandle> models;
+
+  for (uint32_t i = 0; i < options.models; i++) {
+    models.push_back(registry.Add(CreateCube(device, {unit(rng), unit(rng), unit(rng)})));
+  }
+
+  // A grid of cubes, with the camera far enough back to have all of it in view
+  const uint32_t side    = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(options.objects))));
+  const float    spacing = 1.5f;
+  const float    extent  = side * spacing;
+
+  svke::GameObjectPool objects;
+  objects.Reserve(options.objects);
+
+  for (uint32_t i = 0; i < options.objects; i++) {
+    glm::vec3 cell(i % side, (i / side) % side, i / (side * side));
+
+    auto& object                 = objects.Create();
+    object.ObjectModel           = models[i % options.models];
+    object.Transform.translation = (cell + 0.5f) * spacing - extent * 0.5f;
+    object.Transform.scale       = glm::vec3 {0.5f};
+    object.Transform.rotation    = {unit(rng) * glm::two_pi<float>(), unit(rng) * glm::two_pi<float>(), 0.0f};
+    object.PreviousTransform     = object.Transform;
+  }
+
+  svke::Camera camera {};
+  camera.SetViewTarget(glm::vec3 {0.0f, 0.0f, -extent * 1.5f}, glm::vec3 {0.0f});
+
+  std::vector<double> frame_ms, cpu_ms, gpu_ms;
+  uint64_t            draw_calls = 0, pipeline_binds = 0, buffer_binds = 0;
+  uint64_t            occlusion_tested = 0, occlusion_culled = 0;
+
+  auto previous_time = std::chrono::steady_clock::now();
+  auto bench_start   = previous_time;
+
+  for (uint32_t frame = 0; frame < options.warmup + options.frames; frame++) {
+    window.PollEvents();
+
+    if (frame == options.warmup) {
+      bench_start = std::chrono::steady_clock::now();
+    }
+
+    double frame_cpu_ms = 0.0;
+    auto   cpu_start    = std::chrono::steady_clock::now();
+
+    if (options.animated) {
+      svke::JobCounter update_counter;
+
+      job_system.ParallelFor(
+          0,
+          objects.getSize(),
+          svke::DrawListBuilder::GRAIN,
+          [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+              auto& transform = objects[i].Transform;
+
+              objects[i].PreviousTransform = transform;
+              transform.rotation.y         = glm::mod(transform.rotation.y + 0.01f, glm::two_pi<float>());
+            }
+          },
+          update_counter);
+
+      job_system.Wait(update_counter);
+    }
+
+    camera.UsePerspectiveProjection(glm::radians(50.f), renderer.getAspectRatio(), 0.1f, extent * 4.0f);
+
+    frame_cpu_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cpu_start).count();
+
+    // Acquiring and submitting wait on the GPU, so only recording counts towards CPU time
+    if (auto command_buffer = renderer.BeginFrame()) {
+      cpu_start = std::chrono::steady_clock::now();
+
+      renderer.BeginSwapChainRenderPass(command_buffer);
+      render_system.RenderGameObjects(command_buffer, objects, registry, camera, job_system, 1.0f);
+      renderer.EndSwapChainRenderPass(command_buffer);
+
+      frame_cpu_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cpu_start).count();
+
+      renderer.EndFrame();
+    }
+
+    auto now = std::chrono::steady_clock::now();
+
+    if (frame >= options.warmup) {
+      frame_ms.push_back(std::chrono::duration<double, std::milli>(now - previous_time).count());
+      cpu_ms.push_back(frame_cpu_ms);
+
+      // Read back a few frames late, that lag does not matter for the distribution
+      const auto& gpu_results = renderer.getGpuProfiler().getResults();
+
+      if (!gpu_results.empty() && gpu_results.front().has_timestamps) {
+        gpu_ms.push_back(gpu_results.front().gpu_ms);
+      }
+
+      draw_calls += render_system.getStats().draw_calls;
+      pipeline_binds += render_system.getStats().pipeline_binds;
+      buffer_binds += render_system.getStats().buffer_binds;
+      occlusion_tested += render_system.getStats().occlusion_tested;
+      occlusion_culled += render_system.getStats().occlusion_culled;
+    }
+
+    previous_time = now;
+  }
+
+  device.WaitIdle();
+
+  double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - bench_start).count();
+
+  FILE* file = options.output.empty() ? stdout : std::fopen(options.output.c_str(), "w");
+
+  if (file == nullptr) {
+    std::fprintf(stderr, "Failed to open %s\n", options.output.c_str());
+    return 1;
+  }
+
+  std::fprintf(file, "{\n");
+  std::fprintf(file, "  \"device\": \"%s\",\n", device.properties.deviceName);
+  std::fprintf(file,
+               "  \"scene\": {\"objects\": %u, \"models\": %u, \"animated\": %s, \"occlusion\": %s},\n",
+               options.objects,
+               options.models,
+               options.animated ? "true" : "false",
+               options.occlusion ? "true" : "false");
+  std::fprintf(file, "  \"frames\": %u,\n", options.frames);
+  std::fprintf(file, "  \"fps\": %.2f,\n", options.frames / elapsed_s);
+  std::fprintf(file, "  \"draw_calls\": %.1f,\n", static_cast<double>(draw_calls) / options.frames);
+  std::fprintf(file, "  \"pipeline_binds\": %.1f,\n", static_cast<double>(pipeline_binds) / options.frames);
+  std::fprintf(file, "  \"buffer_binds\": %.1f,\n", static_cast<double>(buffer_binds) / options.frames);
+  std::fprintf(file,
+               "  \"occlusion_culled_percent\": %.1f,\n",
+               occlusion_tested > 0 ? 100.0 * occlusion_culled / occlusion_tested : 0.0);
+  WritePercentiles(file, "frame_ms", ComputePercentiles(frame_ms));
+  WritePercentiles(file, "cpu_ms", ComputePercentiles(cpu_ms));
+  WritePercentiles(file, "gpu_ms", ComputePercentiles(gpu_ms), true);
+  std::fprintf(file, "}\n");
+
+  if (file != stdout) {
+    std::fclose(file);
+  }
+
+  return 0;
+}
@@ -0,0 +1,266 @@
+#include <svke/asset_loader.hpp>
+#include <svke/camera.hpp>
+#include <svke/device.hpp>
+#include <svke/game_object.hpp>
+#include <svke/job_system.hpp>
+#include <svke/model.hpp>
+#include <svke/model_registry.hpp>
+#include <svke/pipeline_library.hpp>
+#include <svke/renderer.hpp>
+#include <svke/scene_file.hpp>
+#include <svke/scene_graph.hpp>
+#include <svke/simple_render_system.hpp>
+#include <svke/window.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+// Writes a synthetic scene of cubes to a scene file and measures loading it back, from mapping the file until the first
+// frame drawing it has finished on the GPU, and writes the times as JSON. Cubes hang in groups of eight under scene
+// nodes of their own, the models are OBJ files written next to the scene. Run like bench-scene, from the directory
+// holding shaders/ and under xvfb-run without a display.
+//
+// With --stream the models go through an AssetLoader instead, the first frame waits only for the first N essential
+// ones and the rest stream in after it, adding the loader's per stage times and when all assets were ready.
+//
+//   bench-scene_load [--objects N] [--models N] [--stream] [--essential N] [--directory path] [--output path]
+
+struct BenchOptions {
+  uint32_t    objects   = 1000000;
+  uint32_t    models    = 16;
+  bool        stream    = false;
+  uint32_t    essential = 0;  // Models the first frame waits for when streaming
+  std::string directory;
+  std::string output;
+};
+
+static BenchOptions ParseOptions(int argc, char** argv) {
+  BenchOptions options;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char* {
+      if (i + 1 >= argc) {
+        throw std::runtime_error(std::string("Missing value for ") + argv[i]);
+      }
+
+      return argv[++i];
+    };
+
+    if (std::strcmp(argv[i], "--objects") == 0) {
+      options.objects = static_cast<uint32_t>(std::max(std::atoi(next()), 1));
+    } else if (std::strcmp(argv[i], "--models") == 0) {
+      options.models = static_cast<uint32_t>(std::max(std::atoi(next()), 1));
+    } else if (std::strcmp(argv[i], "--stream") == 0) {
+      options.stream = true;
+    } else if (std::strcmp(argv[i], "--essential") == 0) {
+      options.essential = static_cast<uint32_t>(std::max(std::atoi(next()), 0));
+    } else if (std::strcmp(argv[i], "--directory") == 0) {
+      options.directory = next();
+    } else if (std::strcmp(argv[i], "--output") == 0) {
+      options.output = next();
+    } else {
+      throw std::runtime_error(std::string("Unknown option ") + argv[i]);
+    }
+  }
+
+  if (options.directory.empty()) {
+    options.directory = (std::filesystem::temp_directory_path() / "svke_bench_scene_load").string();
+  }
+
+  options.models = std::min(options.models, options.objects);
+
+  return options;
+}
+
+// Unit cube with a single color, as an OBJ file with the color extension
+static void WriteCube(const std::filesystem::path& path, glm::vec3 color) {
+  std::ofstream file {path, std::ios::trunc};
+
+  for (int corner = 0; corner < 8; corner++) {
+    file << "v " << (corner & 1 ? 0.5f : -0.5f) << " " << (corner & 2 ? 0.5f : -0.5f) << " "
+         << (corner & 4 ? 0.5f : -0.5f) << " " << color.x << " " << color.y << " " << color.z << "\n";
+  }
+
+  file << "f 1 3 4 2\nf 5 6 8 7\nf 1 2 6 5\nf 3 7 8 4\nf 1 5 7 3\nf 2 4 8 6\n";
+
+  if (!file.good()) {
+    throw std::runtime_error("Failed to write " + path.string());
+  }
+}
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+  BenchOptions options = ParseOptions(argc, argv);
+
+  std::filesystem::path directory {options.directory};
+  std::filesystem::create_directories(directory);
+
+  std::mt19937                          rng {42};
+  std::uniform_real_distribution<float> unit {0.0f, 1.0f};
+
+  svke::SceneFile scene;
+
+  for (uint32_t i = 0; i < options.models; i++) {
+    std::string name = "cube_" + std::to_string(i) + ".obj";
+
+    WriteCube(directory / name, {unit(rng), unit(rng), unit(rng)});
+    scene.AddModel(name);
+  }
+
+  // A grid of cubes, with the camera far enough back to have all of it in view. Every eight consecutive cubes hang
+  // under a group node without a model, placed at the first of them.
+  const uint32_t side    = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(options.objects))));
+  const float    spacing = 1.5f;
+  const float    extent  = side * spacing;
+
+  uint32_t  group = svke::SceneFile::NO_PARENT;
+  glm::vec3 group_position {};
+
+  for (uint32_t i = 0; i < options.objects; i++) {
+    glm::vec3 cell(i % side, (i / side) % side, i / (side * side));
+    glm::vec3 position = (cell + 0.5f) * spacing - extent * 0.5f;
+
+    if (i % 8 == 0) {
+      svke::TransformComponent group_local {};
+      group_local.translation = position;
+      group_local.scale       = glm::vec3 {1.0f};
+
+      group          = scene.AddObject(group_local);
+      group_position = position;
+    }
+
+    svke::TransformComponent local {};
+    local.translation = position - group_position;
+    local.scale       = glm::vec3 {0.5f};
+    local.rotation    = {unit(rng) * glm::two_pi<float>(), unit(rng) * glm::two_pi<float>(), 0.0f};
+
+    scene.AddObject(local, i % options.models, group);
+  }
+
+  const std::string scene_path = (directory / "scene.svks").string();
+
+  auto save_start = std::chrono::steady_clock::now();
+  scene.Save(scene_path);
+  double save_ms = MillisecondsSince(save_start);
+
+  const uint64_t file_size = std::filesystem::file_size(scene_path);
+
+  auto init_start = std::chrono::steady_clock::now();
+
+  svke::Window             window {1280, 720, "svke bench", false};
+  svke::Device             device {window};
+  svke::Renderer           renderer {window, device, svke::SwapChainConfig::FromEnvironment()};
+  svke::PipelineLibrary    pipeline_library {device};
+  svke::SimpleRenderSystem render_system {device, pipeline_library, renderer};
+  svke::JobSystem          job_system {};
+  svke::ModelRegistry      registry {device};
+  svke::AssetLoader        loader {device, job_system, registry};
+
+  double init_ms = MillisecondsSince(init_start);
+
+  svke::SceneGraph     scene_graph;
+  svke::GameObjectPool objects;
+
+  auto load_start = std::chrono::steady_clock::now();
+
+  svke::SceneLoadStats stats;
+
+  if (options.stream) {
+    stats = svke::SceneFile::Load(scene_path, job_system, loader, options.essential, scene_graph, objects);
+    loader.WaitEssential();
+  } else {
+    stats = svke::SceneFile::Load(
+        scene_path,
+        job_system,
+        [&](const std::string& reference) {
+          return svke::Model::FromObjFile(device, (directory / reference).string());
+        },
+        registry,
+        scene_graph,
+        objects);
+  }
+
+  double load_ms = MillisecondsSince(load_start);
+
+  svke::Camera camera {};
+  camera.SetViewTarget(glm::vec3 {0.0f, 0.0f, -extent * 1.5f}, glm::vec3 {0.0f});
+
+  auto first_frame_start = std::chrono::steady_clock::now();
+
+  // Acquiring can fail on a swap chain that went out of date, which recreates it for the next try
+  for (bool rendered = false; !rendered;) {
+    window.PollEvents();
+    camera.UsePerspectiveProjection(glm::radians(50.f), renderer.getAspectRatio(), 0.1f, extent * 4.0f);
+
+    if (auto command_buffer = renderer.BeginFrame()) {
+      renderer.BeginSwapChainRenderPass(command_buffer);
+      render_system.RenderGameObjects(command_buffer, objects, registry, camera, job_system, 1.0f, &scene_graph);
+      renderer.EndSwapChainRenderPass(command_buffer);
+      renderer.EndFrame();
+
+      rendered = true;
+    }
+  }
+
+  device.WaitIdle();
+
+  double first_frame_ms = MillisecondsSince(first_frame_start);
+
+  // Streamed models keep loading while the first frame renders
+  loader.WaitAll();
+
+  double all_assets_ms = MillisecondsSince(load_start);
+
+  const svke::AssetLoaderStats loader_stats = loader.getStats();
+
+  FILE* file = options.output.empty() ? stdout : std::fopen(options.output.c_str(), "w");
+
+  if (file == nullptr) {
+    std::fprintf(stderr, "Failed to open %s\n", options.output.c_str());
+    return 1;
+  }
+
+  std::fprintf(file, "{\n");
+  std::fprintf(file, "  \"device\": \"%s\",\n", device.properties.deviceName);
+  std::fprintf(file,
+               "  \"scene\": {\"nodes\": %u, \"objects\": %u, \"models\": %u, \"file_mib\": %.2f},\n",
+               stats.node_count,
+               stats.object_count,
+               stats.model_count,
+               file_size / 1024.0 / 1024.0);
+  std::fprintf(file, "  \"save_ms\": %.2f,\n", save_ms);
+  std::fprintf(file, "  \"device_init_ms\": %.2f,\n", init_ms);
+  std::fprintf(file, "  \"map_ms\": %.2f,\n", stats.map_ms);
+  std::fprintf(file, "  \"nodes_ms\": %.2f,\n", stats.nodes_ms);
+  std::fprintf(file, "  \"objects_ms\": %.2f,\n", stats.objects_ms);
+  std::fprintf(file, "  \"load_ms\": %.2f,\n", load_ms);
+  std::fprintf(file, "  \"first_frame_ms\": %.2f,\n", first_frame_ms);
+  std::fprintf(file, "  \"time_to_first_frame_ms\": %.2f,\n", load_ms + first_frame_ms);
+
+  if (options.stream) {
+    std::fprintf(file, "  \"streamed\": {\"essential_models\": %u", std::min(options.essential, stats.model_count));
+
+    for (uint32_t stage = 0; stage < loader_stats.stage_ms.size(); stage++) {
+      std::fprintf(file,
+                   ", \"%s_ms\": %.2f",
+                   svke::LoadStageName(static_cast<svke::LoadStage>(stage)),
+                   loader_stats.stage_ms[stage]);
+    }
+
+    std::fprintf(file, "},\n");
+  }
+
+  std::fprintf(file, "  \"all_assets_ms\": %.2f\n", all_assets_ms);
+  std::fprintf(file, "}\n");
+
+  if (file != stdout) {
+    std::fclose(file);
+  }
+
+  return 0;
+}
@@ -1,6 +1,7 @@
 #include "application.hpp"
 #include "defines.hpp"
 #include "pch.hpp"
+#include "profiler.hpp"
 
 std::unique_ptr<svke::Model> CreateCubeModel(svke::Device& device, glm::vec3 offset) {
   std::vector<svke::Model::Vertex> vertices = {
@@ -54,7 +55,44 @@ std::unique_ptr<svke::Model> CreateCubeModel(svke::Device& device, glm::vec3 off
 namespace svke {
   Application::Application(uint32_t width, uint32_t height, const std::string& window_name)
       : pWidth {width}, pHeight {height}, pWindowName {window_name} {
+    Profiler::SetThreadName("Main");
+
+    if (const char* path = std::getenv("SVKE_PROFILE_OUTPUT")) {
+      pProfilePath = path;
+    }
+
+    // Captures from the very first frame, so that loading shows up as well
+    if (const char* frames = std::getenv("SVKE_PROFILE_FRAMES")) {
+      pProfileFrames = static_cast<uint32_t>(std::max(std::atoi(frames), 1));
+      Profiler::BeginCapture(pProfileFrames, pProfilePath);
+    }
+
+    pInitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pStartTime).count();
+
     pLoadGameObjects();
+
+    // The first frame renders with the essential assets, the rest stream in while running
+    pAssetLoader.WaitEssential();
+
+    if (const char* budget = std::getenv("SVKE_RESIDENCY_BUDGET_MB")) {
+      constexpr VkDeviceSize MEGABYTE = 1024 * 1024;
+
+      char*              end       = nullptr;
+      unsigned long long megabytes = std::strtoull(budget, &end, 10);
+
+      // strtoull skips leading whitespace and wraps negative values around, neither is a budget
+      if (!std::isdigit(static_cast<unsigned char>(*budget)) || *end != '\0' ||
+          megabytes > std::numeric_limits<VkDeviceSize>::max() / MEGABYTE) {
+        throw std::runtime_error(std::string("Invalid value for SVKE_RESIDENCY_BUDGET_MB: ") + budget);
+      }
+
+      pResidencyManager.SetBudget(static_cast<VkDeviceSize>(megabytes) * MEGABYTE);
+    }
+
+    if (const char* resize_test = std::getenv("SVKE_RESIZE_TEST")) {
+      pRenderer.SetWaitIdleOnRecreate(std::string(resize_test) == "idle");
+      pResizeTest = std::make_unique<ResizeTest>(pWindow);
+    }
   }
 
   Application::~Application() {}
@@ -62,32 +100,244 @@ namespace svke {
   void Application::Run() {
     pCamera.SetViewDirection(glm::vec3(0.0f), glm::vec3(0.5f, 0.0f, 1.0f));
 
+#if defined(SVKE_VERBOSE_RENDER_STATS) || defined(SVKE_VERBOSE_LATENCY) || defined(SVKE_VERBOSE_MEMORY)
+    auto last_stats_time = std::chrono::steady_clock::now();
+#endif
+
+    auto  previous_time = std::chrono::steady_clock::now();
+    float accumulator   = 0.0f;
+
     while (!pWindow.ShouldClose()) {
       glfwPollEvents();
+      pRenderer.MarkInputSampled();
+
+      auto  frame_start = std::chrono::steady_clock::now();
+      float frame_time  = std::chrono::duration<float>(frame_start - previous_time).count();
+
+      previous_time = frame_start;
+      accumulator += std::min(frame_time, MAX_FRAME_TIME);
+
+      pPollProfileCapture();
+      pPollAssets();
+
+      while (accumulator >= FIXED_TIMESTEP) {
+        SVKE_PROFILE_SCOPE("Application::Update");
+        pUpdate(FIXED_TIMESTEP);
+        accumulator -= FIXED_TIMESTEP;
+      }
+
+      const float alpha = accumulator / FIXED_TIMESTEP;
 
       pCamera.UsePerspectiveProjection(glm::radians(50.f), pRenderer.getAspectRatio(), 0.1f, 10.f);
 
+      {
+        SVKE_PROFILE_SCOPE("ResidencyManager::Update");
+        pResidencyManager.Update();
+      }
+
+      pModelRegistry.Collect();
+
+      {
+        SVKE_PROFILE_SCOPE("SceneGraph::Update");
+        pSceneGraph.Update();
+      }
+
       if (auto command_buffer = pRenderer.BeginFrame()) {
         pRenderer.BeginSwapChainRenderPass(command_buffer);
-        pSimpleRenderSystem.RenderGameObjects(command_buffer, pGameObjects, pCamera);
+        pSimpleRenderSystem.RenderGameObjects(
+            command_buffer, pGameObjects, pModelRegistry, pCamera, pJobSystem, alpha, &pSceneGraph);
         pRenderer.EndSwapChainRenderPass(command_buffer);
         pRenderer.EndFrame();
+
+#ifdef SVKE_VERBOSE_STARTUP
+        if (!pFirstFrameDone) {
+          std::cout << "Startup: first frame submitted after "
+                    << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pStartTime).count()
+                    << " ms" << std::endl;
+        }
+#endif
+
+        pFirstFrameDone = true;
+      }
+
+      if (pResizeTest != nullptr && pResizeTest->Step(frame_time)) {
+        break;
       }
+
+      if (pFrameRateLimit > 0.0f) {
+        SVKE_PROFILE_SCOPE("Frame rate limit");
+
+        auto frame_duration = std::chrono::duration<float>(1.0f / pFrameRateLimit);
+        std::this_thread::sleep_until(frame_start +
+                                      std::chrono::duration_cast<std::chrono::steady_clock::duration>(frame_duration));
+      }
+
+#if defined(SVKE_VERBOSE_RENDER_STATS) || defined(SVKE_VERBOSE_LATENCY) || defined(SVKE_VERBOSE_MEMORY)
+      auto now = std::chrono::steady_clock::now();
+
+      if (now - last_stats_time >= std::chrono::seconds(1)) {
+#  ifdef SVKE_VERBOSE_RENDER_STATS
+        const RenderStats& stats = pSimpleRenderSystem.getStats();
+
+        std::cout << "Draws: " << stats.draw_calls << ", pipeline binds: " << stats.pipeline_binds << " (unsorted "
+                  << stats.unsorted_pipeline_binds << "), buffer binds: " << stats.buffer_binds << " (unsorted "
+                  << stats.unsorted_buffer_binds << "), occlusion culled: "
+                  << (stats.occlusion_tested > 0 ? 100.0f * stats.occlusion_culled / stats.occlusion_tested : 0.0f)
+                  << "%" << std::endl;
+
+        const ResidencyStats residency = pResidencyManager.getStats();
+
+        std::cout << "Residency: " << residency.resident_count << " resident ("
+                  << residency.resident_bytes / 1024 / 1024 << " MiB), budget " << residency.budget_bytes / 1024 / 1024
+                  << " MiB"
+                  << (residency.budget_from_device ? " (device)" : "") << ", headroom "
+                  << residency.headroom_bytes / 1024 / 1024 << " MiB, " << residency.stream_ins << " stream ins ("
+                  << residency.reduced_stream_ins << " reduced), " << residency.evictions << " evictions, "
+                  << residency.pending_count << " pending" << std::endl;
+
+        for (const auto& scope : pRenderer.getGpuProfiler().getResults()) {
+          std::cout << "GPU " << scope.name << ": " << scope.gpu_ms << " ms";
+
+          if (scope.has_pipeline_statistics) {
+            std::cout << ", " << scope.vertex_invocations << " vertex invocations, " << scope.primitives
+                      << " primitives (" << scope.clipped_primitives << " after clipping), "
+                      << scope.fragment_invocations << " fragment invocations";
+          }
+
+          std::cout << std::endl;
+        }
+#  endif
+
+#  ifdef SVKE_VERBOSE_LATENCY
+        const LatencyStats latency = pRenderer.getLatencyProbe().Collect();
+
+        std::cout << "Latency over " << latency.frames << " frames, input to present: " << latency.average_present_ms
+                  << " ms (max " << latency.max_present_ms << "), input to GPU done: " << latency.average_gpu_ms
+                  << " ms (max " << latency.max_gpu_ms << ")" << std::endl;
+#  endif
+
+#  ifdef SVKE_VERBOSE_MEMORY
+        const MemoryReport memory = pDevice.QueryMemoryReport();
+
+        std::cout << "Device memory: " << memory.total.current / 1024 / 1024 << " MiB (peak "
+                  << memory.total.peak / 1024 / 1024 << " MiB)";
+
+        for (uint32_t category = 0; category < memory.categories.size(); category++) {
+          std::cout << ", " << MemoryCategoryName(static_cast<MemoryCategory>(category)) << " "
+                    << memory.categories[category].current / 1024 << " KiB";
+        }
+
+        for (uint32_t heap = 0; heap < memory.heaps.size(); heap++) {
+          if (memory.from_extension && memory.heaps[heap].device_local) {
+            std::cout << ", heap " << heap << " " << memory.heaps[heap].process_usage / 1024 / 1024 << " of "
+                      << memory.heaps[heap].budget / 1024 / 1024 << " MiB budget";
+          }
+        }
+
+        std::cout << std::endl;
+#  endif
+
+        last_stats_time = now;
+      }
+#endif
+
+      Profiler::MarkFrame();
     }
 
-    vkDeviceWaitIdle(pDevice.getDevice());
+    pDevice.WaitIdle();
   }
 
   void Application::pLoadGameObjects() {
-    std::shared_ptr<Model> cube_model = CreateCubeModel(pDevice, {0.0f, 0.0f, 0.0f});
+    // A scene file replaces the built in cube, its model references are OBJ paths relative to the file
+    if (const char* scene_path = std::getenv("SVKE_SCENE")) {
+      SceneLoadStats stats = SceneFile::Load(scene_path, pJobSystem, pAssetLoader, 0, pSceneGraph, pGameObjects);
+
+#ifdef SVKE_VERBOSE_RENDER_STATS
+      std::cout << "Loaded " << scene_path << ": " << stats.object_count << " objects, " << stats.node_count
+                << " nodes, " << stats.model_count << " models in " << stats.total_ms << " ms" << std::endl;
+#else
+      UNUSED(stats);
+#endif
+
+      return;
+    }
+
+    pAssetLoader.CreateModel(
+        [this]() { return CreateCubeModel(pDevice, {0.0f, 0.0f, 0.0f}); },
+        [this](ModelHandle cube_model) {
+          auto& cube_object = pGameObjects.Create();
+
+          cube_object.ObjectModel           = cube_model;
+          cube_object.Transform.translation = {0.0f, 0.0f, 2.5f};
+          cube_object.Transform.scale       = {0.5f, 0.5f, 0.5f};
+          cube_object.Transform.rotation    = {0.0f, 0.0f, 0.0f};
+
+          cube_object.PreviousTransform = cube_object.Transform;
+          cube_object.Node              = pSceneGraph.Create(cube_object.Transform);
+        },
+        true);
+  }
+
+  void Application::pPollAssets() {
+    pAssetLoader.Poll();
 
-    auto cube_object = GameObject::CreateGameObject();
+    if (pAssetsDone || !pAssetLoader.IsIdle()) {
+      return;
+    }
+
+    pAssetsDone = true;
+
+#ifdef SVKE_VERBOSE_STARTUP
+    const AssetLoaderStats stats = pAssetLoader.getStats();
+
+    std::cout << "Startup: init " << pInitMs << " ms, essential assets " << stats.essential_ms << " ms, all assets "
+              << stats.all_ms << " ms (" << stats.loaded << " loaded, " << stats.failed << " failed)";
+
+    for (uint32_t stage = 0; stage < stats.stage_ms.size(); stage++) {
+      std::cout << ", " << LoadStageName(static_cast<LoadStage>(stage)) << " " << stats.stage_ms[stage] << " ms";
+    }
+
+    std::cout << std::endl;
+#endif
+  }
+
+  void Application::pPollProfileCapture() {
+    bool key_down = pWindow.IsKeyDown(PROFILE_CAPTURE_KEY);
+
+    if (key_down && !pProfileKeyDown) {
+      Profiler::BeginCapture(pProfileFrames, pProfilePath);
+    }
+
+    pProfileKeyDown = key_down;
+  }
+
+  void Application::pUpdate(float delta_time) {
+    const glm::vec3 ROTATION_SPEED {0.03f, 0.06f, 0.0f};  // Radians per second around x, y and z
+
+    JobCounter update_counter;
 
-    cube_object.ObjectModel           = cube_model;
-    cube_object.Transform.translation = {0.0f, 0.0f, 2.5f};
-    cube_object.Transform.scale       = {0.5f, 0.5f, 0.5f};
-    cube_object.Transform.rotation    = {0.0f, 0.0f, 0.0f};
+    pJobSystem.ParallelFor(
+        0,
+        pGameObjects.getSize(),
+        DrawListBuilder::GRAIN,
+        [&](uint32_t begin, uint32_t end) {
+          for (uint32_t i = begin; i < end; i++) {
+            auto& transform = pGameObjects[i].Transform;
 
-    pGameObjects.push_back(std::move(cube_object));
+            pGameObjects[i].PreviousTransform = transform;
+
+            transform.rotation = glm::mod(transform.rotation + ROTATION_SPEED * delta_time, glm::two_pi<float>());
+          }
+        },
+        update_counter);
+
+    pJobSystem.Wait(update_counter);
+
+    // Only marks the nodes, world matrices are recomputed once per frame before rendering
+    for (const auto& object : pGameObjects) {
+      if (object.Node != NO_SCENE_NODE) {
+        pSceneGraph.SetLocal(object.Node, object.Transform);
+      }
+    }
   }
 }
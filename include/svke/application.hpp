@@ -1,12 +1,21 @@
 #ifndef SVKE_APPLICATION_HPP
 #define SVKE_APPLICATION_HPP
 
+#include "asset_loader.hpp"
 #include "camera.hpp"
 #include "defines.hpp"
 #include "device.hpp"
 #include "game_object.hpp"
+#include "game_object_pool.hpp"
+#include "job_system.hpp"
+#include "model_registry.hpp"
 #include "pch.hpp"
+#include "pipeline_library.hpp"
 #include "renderer.hpp"
+#include "residency_manager.hpp"
+#include "resize_test.hpp"
+#include "scene_file.hpp"
+#include "scene_graph.hpp"
 #include "simple_render_system.hpp"
 #include "window.hpp"
 
@@ -19,24 +28,56 @@ namespace svke {
     Application(const Application &other) = delete;
     Application &operator=(const Application &other) = delete;
 
+   public:
+    static constexpr float FIXED_TIMESTEP = 1.0f / 60.0f;
+    static constexpr float MAX_FRAME_TIME = 0.25f;  // Longer frames drop simulation time instead of spiraling
+
+    static constexpr uint32_t DEFAULT_PROFILE_FRAMES = 120;
+    static constexpr int32_t  PROFILE_CAPTURE_KEY    = GLFW_KEY_F9;
+
    public:
     void Run();
 
+    // Caps how often frames are rendered, 0 renders as fast as the swap chain allows. Does not affect simulation.
+    void SetFrameRateLimit(float frames_per_second) { pFrameRateLimit = frames_per_second; }
+
    private:
     void pLoadGameObjects();
+    void pUpdate(float delta_time);
+    void pPollProfileCapture();
+    void pPollAssets();
 
    private:
     uint32_t    pWidth;
     uint32_t    pHeight;
     std::string pWindowName;
+    float       pFrameRateLimit {0.0f};
+    uint32_t    pProfileFrames {DEFAULT_PROFILE_FRAMES};
+    std::string pProfilePath {"svke_trace.json"};
+    bool        pProfileKeyDown {false};
+
+    // Declared before the window so that startup times include creating it
+    std::chrono::steady_clock::time_point pStartTime {std::chrono::steady_clock::now()};
+    double                                pInitMs {0.0};
+    bool                                  pFirstFrameDone {false};
+    bool                                  pAssetsDone {false};
 
    private:
     Window                  pWindow {pWidth, pHeight, pWindowName};
     Device                  pDevice {pWindow};
-    Renderer                pRenderer {pWindow, pDevice};
-    SimpleRenderSystem      pSimpleRenderSystem {pDevice, pRenderer.getSwapChainRenderPass()};
+    Renderer                pRenderer {pWindow, pDevice, SwapChainConfig::FromEnvironment()};
+    PipelineLibrary         pPipelineLibrary {pDevice};
+    ResidencyManager        pResidencyManager {pDevice};
+    SimpleRenderSystem      pSimpleRenderSystem {pDevice, pPipelineLibrary, pRenderer};
     Camera                  pCamera {};
-    std::vector<GameObject> pGameObjects;
+    JobSystem               pJobSystem {};
+    AssetCache              pAssetCache;
+    ModelRegistry           pModelRegistry {pDevice, &pResidencyManager};
+    AssetLoader             pAssetLoader {pDevice, pJobSystem, pModelRegistry, &pAssetCache};
+    SceneGraph              pSceneGraph;
+    GameObjectPool          pGameObjects;
+
+    std::unique_ptr<ResizeTest> pResizeTest;
   };
 }
 
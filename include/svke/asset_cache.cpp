@@ -0,0 +1,298 @@
+#include "asset_cache.hpp"
+
+#include "defines.hpp"
+#include "hash.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  // Every entry starts with this header, an entry with a different magic or a short payload is treated as a miss
+  struct AssetEntryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+  };
+
+  static constexpr uint32_t ASSET_ENTRY_MAGIC = 0x434b5653;  // "SVKC"
+
+  AssetBlob::~AssetBlob() { pRelease(); }
+
+  AssetBlob::AssetBlob(AssetBlob&& other) noexcept { *this = std::move(other); }
+
+  AssetBlob& AssetBlob::operator=(AssetBlob&& other) noexcept {
+    if (this != &other) {
+      pRelease();
+
+      pData        = other.pData;
+      pSize        = other.pSize;
+      pMapping     = other.pMapping;
+      pMappingSize = other.pMappingSize;
+      pBytes       = std::move(other.pBytes);
+
+      other.pData    = nullptr;
+      other.pSize    = 0;
+      other.pMapping = nullptr;
+    }
+
+    return *this;
+  }
+
+  AssetBlob AssetBlob::FromBytes(std::vector<uint8_t> bytes) {
+    AssetBlob blob;
+    blob.pBytes = std::move(bytes);
+    blob.pData  = blob.pBytes.data();
+    blob.pSize  = blob.pBytes.size();
+
+    return blob;
+  }
+
+  AssetBlob AssetBlob::FromFile(const std::filesystem::path& path) {
+    AssetBlob blob;
+
+#ifndef _WIN32
+    int file = open(path.c_str(), O_RDONLY);
+
+    if (file >= 0) {
+      struct stat file_stat;
+
+      if (fstat(file, &file_stat) == 0 && file_stat.st_size > 0) {
+        void* mapping = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+        if (mapping != MAP_FAILED) {
+          blob.pMapping     = mapping;
+          blob.pMappingSize = static_cast<size_t>(file_stat.st_size);
+          blob.pData        = static_cast<const uint8_t*>(mapping);
+          blob.pSize        = blob.pMappingSize;
+        }
+      }
+
+      close(file);
+    }
+#else
+    std::ifstream file {path, std::ios::ate | std::ios::binary};
+
+    if (file.is_open() && file.tellg() > 0) {
+      std::vector<uint8_t> bytes(static_cast<size_t>(file.tellg()));
+
+      file.seekg(0);
+      file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+      blob = FromBytes(std::move(bytes));
+    }
+#endif
+
+    return blob;
+  }
+
+  void AssetBlob::pRelease() {
+#ifndef _WIN32
+    if (pMapping != nullptr) {
+      munmap(pMapping, pMappingSize);
+    }
+#endif
+
+    pMapping = nullptr;
+    pData    = nullptr;
+    pSize    = 0;
+    pBytes.clear();
+  }
+
+  AssetCache::AssetCache(const std::string& directory, uint64_t max_size)
+      : pDirectory {directory}, pMaxSize {max_size} {
+    std::error_code error;
+    std::filesystem::create_directories(pDirectory, error);
+
+    for (const auto& entry : std::filesystem::directory_iterator(pDirectory, error)) {
+      if (entry.path().extension() == ".blob") {
+        pSize += entry.file_size(error);
+      } else if (entry.path().extension() == ".tmp") {
+        // Left behind by a process that died while writing
+        std::filesystem::remove(entry.path(), error);
+      }
+    }
+  }
+
+  AssetCache::~AssetCache() {
+#ifdef SVKE_VERBOSE_ASSET_CACHE
+    std::cout << "Asset cache: " << pStats.hits << " hits, " << pStats.misses << " misses ("
+              << pStats.HitRate() * 100.0f << "% hit rate), " << pStats.writes << " writes, " << pStats.evictions
+              << " evictions, " << pSize / 1024 << " KiB on disk" << std::endl;
+#endif
+  }
+
+  uint64_t AssetCache::MakeKey(const void* source, size_t size, const std::string& parameters) {
+    uint64_t key = HashValue(static_cast<uint32_t>(SVKE_ASSET_VERSION));
+    key          = HashString(parameters, key);
+    key          = HashBytes(source, size, key);
+
+    return key;
+  }
+
+  std::string AssetCache::DefaultDirectory() {
+    const char* directory = std::getenv("SVKE_ASSET_CACHE_DIR");
+    return directory != nullptr ? directory : "asset_cache";
+  }
+
+  AssetBlob AssetCache::Load(uint64_t key) {
+    std::filesystem::path path = pEntryPath(key);
+    AssetBlob             blob = AssetBlob::FromFile(path);
+
+    if (blob.getSize() < sizeof(AssetEntryHeader)) {
+      blob = AssetBlob {};
+    } else {
+      blob.pData += sizeof(AssetEntryHeader);
+      blob.pSize -= sizeof(AssetEntryHeader);
+    }
+
+    if (blob.IsValid()) {
+      AssetEntryHeader header;
+      memcpy(&header, blob.pData - sizeof(AssetEntryHeader), sizeof(header));
+
+      if (header.magic != ASSET_ENTRY_MAGIC || header.version != SVKE_ASSET_VERSION || header.size != blob.pSize) {
+        blob = AssetBlob {};
+      }
+    }
+
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    if (!blob.IsValid()) {
+      pStats.misses++;
+      return blob;
+    }
+
+    // The modification time doubles as the last use time for trimming
+    std::error_code error;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+    pStats.hits++;
+    return blob;
+  }
+
+  void AssetCache::Store(uint64_t key, const void* data, size_t size) {
+    std::filesystem::path path = pEntryPath(key);
+
+    // Unique per writer, renaming it over the entry is atomic so readers see either nothing or the complete entry
+    std::random_device    random;
+    std::filesystem::path temporary_path = path;
+    temporary_path += "." + std::to_string(random()) + ".tmp";
+
+    AssetEntryHeader header {ASSET_ENTRY_MAGIC, SVKE_ASSET_VERSION, size};
+
+    {
+      std::ofstream file {temporary_path, std::ios::binary | std::ios::trunc};
+
+      if (!file.is_open()) {
+        return;
+      }
+
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+
+      if (!file.good()) {
+        file.close();
+
+        std::error_code error;
+        std::filesystem::remove(temporary_path, error);
+        return;
+      }
+    }
+
+    // The rename replaces an entry that another thread or a racing process stored meanwhile, which was already counted
+    std::error_code error;
+    uintmax_t       replaced_size = std::filesystem::file_size(path, error);
+
+    if (error) {
+      replaced_size = 0;
+    }
+
+    std::filesystem::rename(temporary_path, path, error);
+
+    if (error) {
+      std::filesystem::remove(temporary_path, error);
+      return;
+    }
+
+    bool over_budget;
+
+    {
+      std::lock_guard<std::mutex> lock {pMutex};
+
+      pSize -= std::min<uint64_t>(pSize, replaced_size);
+      pSize += sizeof(header) + size;
+      pStats.writes++;
+
+      over_budget = pSize > pMaxSize;
+    }
+
+    if (over_budget) {
+      Trim();
+    }
+  }
+
+  AssetBlob AssetCache::GetOrProcess(uint64_t key, const std::function<std::vector<uint8_t>()>& process) {
+    AssetBlob blob = Load(key);
+
+    if (blob.IsValid()) {
+      return blob;
+    }
+
+    std::vector<uint8_t> bytes = process();
+    Store(key, bytes.data(), bytes.size());
+
+    return AssetBlob::FromBytes(std::move(bytes));
+  }
+
+  void AssetCache::Trim() {
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    struct CachedFile {
+      std::filesystem::path           path;
+      uint64_t                        size;
+      std::filesystem::file_time_type last_used;
+    };
+
+    std::vector<CachedFile> files;
+    std::error_code         error;
+
+    pSize = 0;
+
+    for (const auto& entry : std::filesystem::directory_iterator(pDirectory, error)) {
+      if (entry.path().extension() == ".blob") {
+        files.push_back({entry.path(), entry.file_size(error), entry.last_write_time(error)});
+        pSize += files.back().size;
+      }
+    }
+
+    std::sort(files.begin(), files.end(), [](const CachedFile& a, const CachedFile& b) {
+      return a.last_used < b.last_used;
+    });
+
+    // Mapped entries stay readable after removal, the file only goes away once unmapped
+    for (const auto& file : files) {
+      if (pSize <= pMaxSize) {
+        break;
+      }
+
+      if (std::filesystem::remove(file.path, error)) {
+        pSize -= file.size;
+        pStats.evictions++;
+      }
+    }
+  }
+
+  AssetCacheStats AssetCache::getStats() {
+    std::lock_guard<std::mutex> lock {pMutex};
+    return pStats;
+  }
+
+  uint64_t AssetCache::getSize() {
+    std::lock_guard<std::mutex> lock {pMutex};
+    return pSize;
+  }
+
+  std::filesystem::path AssetCache::pEntryPath(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.blob", static_cast<unsigned long long>(key));
+
+    return pDirectory / name;
+  }
+}
@@ -0,0 +1,95 @@
+#ifndef SVKE_ASSET_CACHE_HPP
+#define SVKE_ASSET_CACHE_HPP
+
+#include "defines.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  struct AssetCacheStats {
+    uint64_t hits      = 0;
+    uint64_t misses    = 0;
+    uint64_t writes    = 0;
+    uint64_t evictions = 0;
+
+    float HitRate() const { return hits + misses > 0 ? static_cast<float>(hits) / (hits + misses) : 0.0f; }
+  };
+
+  // Read only view of a cached blob or file. Memory mapped where the platform allows it, read into memory otherwise.
+  class AssetBlob {
+   public:
+    AssetBlob() = default;
+    ~AssetBlob();
+
+    AssetBlob(const AssetBlob& other) = delete;
+    AssetBlob& operator=(const AssetBlob& other) = delete;
+    AssetBlob(AssetBlob&& other) noexcept;
+    AssetBlob& operator=(AssetBlob&& other) noexcept;
+
+   public:
+    static AssetBlob FromBytes(std::vector<uint8_t> bytes);
+
+    // Invalid blob when the file cannot be opened
+    static AssetBlob FromFile(const std::filesystem::path& path);
+
+    const uint8_t* getData() const { return pData; }
+    size_t         getSize() const { return pSize; }
+    bool           IsValid() const { return pData != nullptr; }
+
+   private:
+    friend class AssetCache;
+
+    void pRelease();
+
+   private:
+    const uint8_t*       pData {nullptr};
+    size_t               pSize {0};
+    void*                pMapping {nullptr};
+    size_t               pMappingSize {0};
+    std::vector<uint8_t> pBytes;
+  };
+
+  // Content addressed cache of processed assets on disk. Keys hash the source bytes together with the processing
+  // parameters and SVKE_ASSET_VERSION, so a changed source, setting or processing step simply misses. Entries are
+  // written to a temporary file and renamed into place, so a crash never leaves a partial entry behind. Loading touches
+  // the entry, and once the directory grows past its size cap the least recently used entries are removed.
+  class AssetCache {
+   public:
+    static constexpr uint64_t DEFAULT_MAX_SIZE = 512ull * 1024 * 1024;
+
+   public:
+    AssetCache(const std::string& directory = DefaultDirectory(), uint64_t max_size = DEFAULT_MAX_SIZE);
+    ~AssetCache();
+
+    AssetCache(const AssetCache& other) = delete;
+    AssetCache& operator=(const AssetCache& other) = delete;
+
+   public:
+    static uint64_t    MakeKey(const void* source, size_t size, const std::string& parameters);
+    static std::string DefaultDirectory();
+
+    // Invalid blob on a miss
+    AssetBlob Load(uint64_t key);
+    void      Store(uint64_t key, const void* data, size_t size);
+
+    // Loads the entry, or runs process and stores its output when there is none
+    AssetBlob GetOrProcess(uint64_t key, const std::function<std::vector<uint8_t>()>& process);
+
+    void Trim();
+
+    AssetCacheStats getStats();
+    uint64_t        getSize();
+
+   private:
+    std::filesystem::path pEntryPath(uint64_t key) const;
+
+   private:
+    std::filesystem::path pDirectory;
+    uint64_t              pMaxSize;
+
+    std::mutex      pMutex;
+    uint64_t        pSize {0};
+    AssetCacheStats pStats {};
+  };
+}
+
+#endif
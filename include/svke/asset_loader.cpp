@@ -0,0 +1,285 @@
+#include "asset_loader.hpp"
+
+#include "defines.hpp"
+#include "pch.hpp"
+#include "profiler.hpp"
+
+namespace svke {
+  const char* LoadStageName(LoadStage stage) {
+    switch (stage) {
+      case LoadStage::Read:
+        return "read";
+      case LoadStage::Decode:
+        return "decode";
+      case LoadStage::Create:
+        return "create";
+      default:
+        return "unknown";
+    }
+  }
+
+  // Adds the time since the previous lap to the stage
+  static void Lap(std::array<double, static_cast<size_t>(LoadStage::Count)>& stage_ms,
+                  LoadStage                                                  stage,
+                  std::chrono::steady_clock::time_point&                     last) {
+    auto now = std::chrono::steady_clock::now();
+
+    stage_ms[static_cast<size_t>(stage)] += std::chrono::duration<double, std::milli>(now - last).count();
+    last = now;
+  }
+
+  AssetLoader::AssetLoader(Device& device, JobSystem& job_system, ModelRegistry& models, AssetCache* cache)
+      : pDevice {device},
+        pJobSystem {job_system},
+        pModels {models},
+        pCache {cache},
+        pMaxStreaming {std::max(job_system.getThreadCount() / 2, 1u)} {}
+
+  AssetLoader::~AssetLoader() {
+    {
+      std::lock_guard<std::mutex> lock {pMutex};
+
+      pStopping = true;
+      pEssentialQueue.clear();
+      pStreamingQueue.clear();
+    }
+
+    // Jobs that already started still reference the loader
+    pJobSystem.Wait(pEssentialCounter);
+    pJobSystem.Wait(pStreamingCounter);
+  }
+
+  void AssetLoader::LoadModel(const std::string& path, ModelReadyCallback on_ready, bool essential) {
+    auto load = [this, path, on_ready = std::move(on_ready)](StageTimes& stage_ms) {
+      auto last = std::chrono::steady_clock::now();
+
+      AssetBlob file = AssetBlob::FromFile(path);
+
+      if (!file.IsValid()) {
+        throw std::runtime_error("Failed to open file: " + path);
+      }
+
+      Lap(stage_ms, LoadStage::Read, last);
+
+      // Kept by the model, which restores its buffers from it after an eviction
+      auto mesh = std::make_shared<const AssetBlob>(
+          Model::ProcessObj(std::string {reinterpret_cast<const char*>(file.getData()), file.getSize()}, pCache));
+
+      Lap(stage_ms, LoadStage::Decode, last);
+
+      auto model = std::make_shared<std::unique_ptr<Model>>(Model::FromProcessedMesh(pDevice, mesh, path));
+
+      Lap(stage_ms, LoadStage::Create, last);
+
+      return std::function<void()> {[this, on_ready, model]() { on_ready(pModels.Add(std::move(*model))); }};
+    };
+
+    pSubmit({std::move(load), essential});
+  }
+
+  void AssetLoader::LoadTexture(const std::string&   path,
+                                TextureReadyCallback on_ready,
+                                bool                 essential,
+                                bool                 generate_mips) {
+    auto load = [this, path, on_ready = std::move(on_ready), generate_mips](StageTimes& stage_ms) {
+      auto last = std::chrono::steady_clock::now();
+
+      AssetBlob file = AssetBlob::FromFile(path);
+
+      if (!file.IsValid()) {
+        throw std::runtime_error("Failed to open file: " + path);
+      }
+
+      Lap(stage_ms, LoadStage::Read, last);
+
+      std::vector<uint8_t> bytes {file.getData(), file.getData() + file.getSize()};
+      TextureData          data = TextureData::FromMemory(bytes);
+
+      Lap(stage_ms, LoadStage::Decode, last);
+
+      std::shared_ptr<Texture> texture = std::make_shared<Texture>(pDevice, data, generate_mips);
+
+      Lap(stage_ms, LoadStage::Create, last);
+
+      return std::function<void()> {[on_ready, texture]() { on_ready(texture); }};
+    };
+
+    pSubmit({std::move(load), essential});
+  }
+
+  void AssetLoader::CreateModel(std::function<std::unique_ptr<Model>()> create,
+                                ModelReadyCallback                      on_ready,
+                                bool                                    essential) {
+    auto load = [this, create = std::move(create), on_ready = std::move(on_ready)](StageTimes& stage_ms) {
+      auto last = std::chrono::steady_clock::now();
+
+      // Shared so that the hand out stays copyable, it moves the model into the registry
+      auto model = std::make_shared<std::unique_ptr<Model>>(create());
+
+      Lap(stage_ms, LoadStage::Create, last);
+
+      return std::function<void()> {[this, on_ready, model]() { on_ready(pModels.Add(std::move(*model))); }};
+    };
+
+    pSubmit({std::move(load), essential});
+  }
+
+  void AssetLoader::Poll() {
+    std::vector<Finished> finished;
+
+    {
+      std::lock_guard<std::mutex> lock {pMutex};
+      finished.swap(pFinished);
+    }
+
+    std::exception_ptr error;
+
+    for (auto& item : finished) {
+      // Callbacks may request more assets, so they run without the lock
+      try {
+        item.hand_out();
+      } catch (...) {
+        if (error == nullptr) {
+          error = std::current_exception();
+        }
+      }
+
+      std::lock_guard<std::mutex> lock {pMutex};
+
+      double elapsed_ms =
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pFirstRequest).count();
+
+      pPending--;
+
+      if (item.essential && --pEssentialPending == 0) {
+        pStats.essential_ms = elapsed_ms;
+      }
+
+      if (pPending == 0) {
+        pStats.all_ms = elapsed_ms;
+      }
+    }
+
+    if (error != nullptr) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  void AssetLoader::WaitEssential() {
+    SVKE_PROFILE_SCOPE("AssetLoader::WaitEssential");
+
+    // Essential requests are dispatched as soon as they are made, so the counter covers all of them
+    pJobSystem.Wait(pEssentialCounter);
+    Poll();
+  }
+
+  void AssetLoader::WaitAll() {
+    SVKE_PROFILE_SCOPE("AssetLoader::WaitAll");
+
+    while (!IsIdle()) {
+      pJobSystem.Wait(pEssentialCounter);
+      pJobSystem.Wait(pStreamingCounter);
+      Poll();
+    }
+  }
+
+  bool AssetLoader::IsIdle() {
+    std::lock_guard<std::mutex> lock {pMutex};
+    return pPending == 0;
+  }
+
+  AssetLoaderStats AssetLoader::getStats() {
+    std::lock_guard<std::mutex> lock {pMutex};
+    return pStats;
+  }
+
+  void AssetLoader::pSubmit(Request request) {
+    {
+      std::lock_guard<std::mutex> lock {pMutex};
+
+      if (pStats.requested == 0) {
+        pFirstRequest = std::chrono::steady_clock::now();
+      }
+
+      pStats.requested++;
+      pPending++;
+
+      if (request.essential) {
+        pEssentialPending++;
+        pEssentialQueue.push_back(std::move(request));
+      } else {
+        pStreamingQueue.push_back(std::move(request));
+      }
+    }
+
+    pDispatch();
+  }
+
+  void AssetLoader::pDispatch() {
+    std::vector<Request> ready;
+
+    {
+      std::lock_guard<std::mutex> lock {pMutex};
+
+      if (pStopping) {
+        return;
+      }
+
+      while (!pEssentialQueue.empty()) {
+        ready.push_back(std::move(pEssentialQueue.front()));
+        pEssentialQueue.pop_front();
+        pEssentialRunning++;
+      }
+
+      // Streaming waits for the essential assets and then keeps only a few workers busy
+      while (pEssentialRunning == 0 && pStreamingRunning < pMaxStreaming && !pStreamingQueue.empty()) {
+        ready.push_back(std::move(pStreamingQueue.front()));
+        pStreamingQueue.pop_front();
+        pStreamingRunning++;
+      }
+    }
+
+    // Outside the lock, a full job queue runs the job right here
+    for (auto& request : ready) {
+      JobCounter& counter = request.essential ? pEssentialCounter : pStreamingCounter;
+      pJobSystem.Run([this, request = std::move(request)]() { pRun(request); }, counter);
+    }
+  }
+
+  void AssetLoader::pRun(const Request& request) {
+    SVKE_PROFILE_SCOPE("AssetLoader::Load");
+
+    StageTimes            stage_ms {};
+    std::function<void()> hand_out;
+    bool                  failed = false;
+
+    try {
+      hand_out = request.load(stage_ms);
+    } catch (...) {
+      std::exception_ptr error = std::current_exception();
+
+      hand_out = [error]() { std::rethrow_exception(error); };
+      failed   = true;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock {pMutex};
+
+      for (size_t stage = 0; stage < stage_ms.size(); stage++) {
+        pStats.stage_ms[stage] += stage_ms[stage];
+      }
+
+      if (failed) {
+        pStats.failed++;
+      } else {
+        pStats.loaded++;
+      }
+
+      pFinished.push_back({std::move(hand_out), request.essential});
+      (request.essential ? pEssentialRunning : pStreamingRunning)--;
+    }
+
+    // Finishing the last essential asset or any streamed one makes room for more
+    pDispatch();
+  }
+}
@@ -0,0 +1,121 @@
+#ifndef SVKE_ASSET_LOADER_HPP
+#define SVKE_ASSET_LOADER_HPP
+
+#include "asset_cache.hpp"
+#include "defines.hpp"
+#include "device.hpp"
+#include "job_system.hpp"
+#include "model.hpp"
+#include "model_registry.hpp"
+#include "pch.hpp"
+#include "texture.hpp"
+
+namespace svke {
+  // Steps every asset goes through on the workers
+  enum class LoadStage : uint32_t {
+    Read,    // File I/O
+    Decode,  // Parsing and processing, or fetching the processed asset from the cache
+    Create,  // Allocating device memory and recording the staging copies
+    Count,
+  };
+
+  const char* LoadStageName(LoadStage stage);
+
+  // Stage times are summed over the workers, so together they can exceed the wall clock times
+  struct AssetLoaderStats {
+    std::array<double, static_cast<size_t>(LoadStage::Count)> stage_ms {};
+
+    uint32_t requested    = 0;
+    uint32_t loaded       = 0;
+    uint32_t failed       = 0;
+    double   essential_ms = 0.0;  // From the first request until the last essential asset was handed out
+    double   all_ms       = 0.0;  // From the first request until the last asset so far was handed out
+  };
+
+  // Loads models and textures on the job system, reading, decoding and creating each one on a worker. Creating records
+  // the staging copies on the device's upload contexts, which batch them into fenced submissions, so nothing waits on
+  // the GPU here and the frame that first uses an asset waits on its uploads instead. A worker that fills a batch
+  // submits it itself, which relies on every submit and present holding the device's lock on its queue.
+  //
+  // Essential assets go first, and WaitEssential blocks until they are ready so the first frame can render with them.
+  // The rest only start once no essential asset is left and stream in afterwards, a few at a time so that they leave
+  // the workers to the frame's own jobs. Finished assets are handed to their callbacks by Poll or the waits, always on
+  // the calling thread, and a failed load rethrows its error there. Models are added to the registry right before
+  // their callback gets the handle.
+  class AssetLoader {
+   public:
+    using ModelReadyCallback   = std::function<void(ModelHandle)>;
+    using TextureReadyCallback = std::function<void(std::shared_ptr<Texture>)>;
+
+   public:
+    AssetLoader(Device& device, JobSystem& job_system, ModelRegistry& models, AssetCache* cache = nullptr);
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader& other) = delete;
+    AssetLoader& operator=(const AssetLoader& other) = delete;
+
+   public:
+    void LoadModel(const std::string& path, ModelReadyCallback on_ready, bool essential = false);
+    void LoadTexture(const std::string&   path,
+                     TextureReadyCallback on_ready,
+                     bool                 essential     = false,
+                     bool                 generate_mips = true);
+
+    // For models built in code, create runs on a worker and counts towards the create stage
+    void CreateModel(std::function<std::unique_ptr<Model>()> create,
+                     ModelReadyCallback                      on_ready,
+                     bool                                    essential = false);
+
+    // Hands out the assets finished since the last call, once per frame
+    void Poll();
+
+    void WaitEssential();
+    void WaitAll();
+
+    bool             IsIdle();
+    AssetLoaderStats getStats();
+
+   private:
+    using StageTimes = std::array<double, static_cast<size_t>(LoadStage::Count)>;
+
+    // Runs on a worker, adds the time of each stage and returns what hands the asset out
+    struct Request {
+      std::function<std::function<void()>(StageTimes&)> load;
+      bool                                              essential;
+    };
+
+    struct Finished {
+      std::function<void()> hand_out;
+      bool                  essential;
+    };
+
+    void pSubmit(Request request);
+    void pDispatch();
+    void pRun(const Request& request);
+
+   private:
+    Device&        pDevice;
+    JobSystem&     pJobSystem;
+    ModelRegistry& pModels;
+    AssetCache*    pCache;
+    uint32_t       pMaxStreaming;
+
+    std::mutex            pMutex;
+    std::deque<Request>   pEssentialQueue;
+    std::deque<Request>   pStreamingQueue;
+    std::vector<Finished> pFinished;
+    uint32_t              pEssentialRunning {0};
+    uint32_t              pStreamingRunning {0};
+    uint32_t              pEssentialPending {0};  // Requested and not handed out yet
+    uint32_t              pPending {0};
+    bool                  pStopping {false};
+
+    JobCounter pEssentialCounter;
+    JobCounter pStreamingCounter;
+
+    std::chrono::steady_clock::time_point pFirstRequest {};
+    AssetLoaderStats                      pStats {};
+  };
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef SVKE_BOUNDS_HPP
+#define SVKE_BOUNDS_HPP
+
+#include "defines.hpp"
+#include "pch_core.hpp"
+
+namespace svke {
+  struct AABB {
+    glm::vec3 min {std::numeric_limits<float>::max()};
+    glm::vec3 max {std::numeric_limits<float>::lowest()};
+
+    bool      IsValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+    glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+    glm::vec3 getExtent() const { return (max - min) * 0.5f; }
+
+    float getSurfaceArea() const {
+      glm::vec3 size = max - min;
+      return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    void Expand(const glm::vec3& point) {
+      min = glm::min(min, point);
+      max = glm::max(max, point);
+    }
+
+    void Expand(const AABB& other) {
+      min = glm::min(min, other.min);
+      max = glm::max(max, other.max);
+    }
+
+    // Bounds of this box after being transformed by an affine matrix (Arvo's method)
+    AABB Transform(const glm::mat4& matrix) const {
+      glm::vec3 center = glm::vec3(matrix * glm::vec4(getCenter(), 1.0f));
+      glm::vec3 extent = getExtent();
+      glm::vec3 new_extent {};
+
+      for (int i = 0; i < 3; i++) {
+        new_extent[i] = glm::abs(matrix[0][i]) * extent.x + glm::abs(matrix[1][i]) * extent.y +
+                        glm::abs(matrix[2][i]) * extent.z;
+      }
+
+      return {center - new_extent, center + new_extent};
+    }
+  };
+
+  struct Sphere {
+    glm::vec3 center {};
+    float     radius {0.0f};
+
+    bool Intersects(const AABB& box) const {
+      glm::vec3 delta = glm::clamp(center, box.min, box.max) - center;
+      return glm::dot(delta, delta) <= radius * radius;
+    }
+  };
+
+  struct Ray {
+    glm::vec3 origin {};
+    glm::vec3 direction {0.0f, 0.0f, 1.0f};
+  };
+
+  // View frustum as six inward facing planes (xyz normal, w distance), extracted from a projection * view matrix that
+  // maps depth to [0, 1]
+  struct Frustum {
+    std::array<glm::vec4, 6> planes;
+
+    static Frustum FromMatrix(const glm::mat4& projection_view) {
+      auto row = [&](int i) {
+        return glm::vec4 {projection_view[0][i], projection_view[1][i], projection_view[2][i], projection_view[3][i]};
+      };
+
+      Frustum frustum;
+
+      frustum.planes[0] = row(3) + row(0);  // left
+      frustum.planes[1] = row(3) - row(0);  // right
+      frustum.planes[2] = row(3) + row(1);  // bottom
+      frustum.planes[3] = row(3) - row(1);  // top
+      frustum.planes[4] = row(2);           // near
+      frustum.planes[5] = row(3) - row(2);  // far
+
+      for (auto& plane : frustum.planes) {
+        plane = plane / glm::length(glm::vec3(plane));
+      }
+
+      return frustum;
+    }
+
+    bool Intersects(const Sphere& sphere) const {
+      for (const auto& plane : planes) {
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    bool Intersects(const AABB& box) const {
+      const glm::vec3 center = box.getCenter();
+      const glm::vec3 extent = box.getExtent();
+
+      for (const auto& plane : planes) {
+        float radius = extent.x * glm::abs(plane.x) + extent.y * glm::abs(plane.y) + extent.z * glm::abs(plane.z);
+
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    // True when the box lies entirely inside every plane
+    bool Contains(const AABB& box) const {
+      const glm::vec3 center = box.getCenter();
+      const glm::vec3 extent = box.getExtent();
+
+      for (const auto& plane : planes) {
+        float radius = extent.x * glm::abs(plane.x) + extent.y * glm::abs(plane.y) + extent.z * glm::abs(plane.z);
+
+        if (glm::dot(glm::vec3(plane), center) + plane.w < radius) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+  };
+}
+
+#endif
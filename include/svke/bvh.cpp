@@ -0,0 +1,429 @@
+#include "bvh.hpp"
+
+#include "defines.hpp"
+#include "pch.hpp"
+#include "profiler.hpp"
+
+namespace svke {
+  namespace {
+    // The build caps the depth so that traversal can use a fixed stack
+    constexpr uint32_t MAX_DEPTH   = 64;
+    constexpr uint32_t INSIDE_FLAG = 1u << 31;  // Set on stacked nodes whose whole subtree is inside the frustum
+
+    // Entry distance of a ray into a box, infinity when it misses or only enters past max_distance
+    float RayEntry(const glm::vec3& origin, const glm::vec3& inverse_direction, const AABB& box, float max_distance) {
+      glm::vec3 t0 = (box.min - origin) * inverse_direction;
+      glm::vec3 t1 = (box.max - origin) * inverse_direction;
+
+      glm::vec3 near = glm::min(t0, t1);
+      glm::vec3 far  = glm::max(t0, t1);
+
+      float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+      float exit  = std::min(std::min(far.x, far.y), std::min(far.z, max_distance));
+
+      return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+    }
+  }
+
+  Bvh::~Bvh() {
+    if (pRebuilding) {
+      pRebuildJobSystem->Wait(pRebuildCounter);
+    }
+  }
+
+  void Bvh::Build(JobSystem& job_system, const std::vector<AABB>& bounds) {
+    SVKE_PROFILE_SCOPE("Bvh::Build");
+
+    // A rebuild in flight refers to the old items, let it finish and drop it
+    if (pRebuilding) {
+      pRebuildJobSystem->Wait(pRebuildCounter);
+      pRebuilding = false;
+    }
+
+    pItemBounds = bounds;
+    pBuildTree(job_system, pItemBounds, pTree);
+
+    pDirtyLeaves.clear();
+    pDirtyNodes.assign(pTree.nodes.size(), 0);
+  }
+
+  void Bvh::Update(uint32_t item, const AABB& bounds) {
+    pItemBounds[item] = bounds;
+    pDirtyLeaves.push_back(pTree.leaves[item]);
+  }
+
+  void Bvh::Refit(JobSystem& job_system) {
+    SVKE_PROFILE_SCOPE("Bvh::Refit");
+
+    if (pRebuilding && pRebuildCounter.IsDone()) {
+      pFinishRebuild();
+    }
+
+    if (!pDirtyLeaves.empty()) {
+      std::vector<uint32_t> nodes;
+
+      for (uint32_t leaf : pDirtyLeaves) {
+        for (uint32_t node = leaf; node != NO_NODE && !pDirtyNodes[node]; node = pTree.parents[node]) {
+          pDirtyNodes[node] = 1;
+          nodes.push_back(node);
+        }
+      }
+
+      pDirtyLeaves.clear();
+
+      // Children always come after their parent, so going backwards refits every child before its parent
+      std::sort(nodes.begin(), nodes.end(), std::greater<uint32_t>());
+
+      for (uint32_t index : nodes) {
+        Node& node = pTree.nodes[index];
+
+        pTree.area_sum -= node.bounds.getSurfaceArea();
+
+        if (node.IsLeaf()) {
+          node.bounds = pLeafBounds(pTree, pItemBounds, node);
+        } else {
+          node.bounds = pTree.nodes[node.first].bounds;
+          node.bounds.Expand(pTree.nodes[node.first + 1].bounds);
+        }
+
+        pTree.area_sum += node.bounds.getSurfaceArea();
+        pDirtyNodes[index] = 0;
+      }
+    }
+
+    if (!pRebuilding && pTree.node_count > 1 && getCost() > REBUILD_RATIO * pTree.build_cost) {
+      pStartRebuild(job_system);
+    }
+  }
+
+  void Bvh::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& items) const {
+    if (pTree.node_count == 0) {
+      return;
+    }
+
+    std::array<uint32_t, MAX_DEPTH + 1> stack;
+    uint32_t                            size = 0;
+
+    stack[size++] = 0;
+
+    while (size > 0) {
+      uint32_t    entry  = stack[--size];
+      bool        inside = (entry & INSIDE_FLAG) != 0;
+      const Node& node   = pTree.nodes[entry & ~INSIDE_FLAG];
+
+      if (!inside) {
+        if (!frustum.Intersects(node.bounds)) {
+          continue;
+        }
+
+        inside = frustum.Contains(node.bounds);
+      }
+
+      if (!node.IsLeaf()) {
+        stack[size++] = node.first | (inside ? INSIDE_FLAG : 0);
+        stack[size++] = (node.first + 1) | (inside ? INSIDE_FLAG : 0);
+        continue;
+      }
+
+      for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        uint32_t item = pTree.items[i];
+
+        if (inside || frustum.Intersects(pItemBounds[item])) {
+          items.push_back(item);
+        }
+      }
+    }
+  }
+
+  void Bvh::QuerySphere(const Sphere& sphere, std::vector<uint32_t>& items) const {
+    if (pTree.node_count == 0) {
+      return;
+    }
+
+    std::array<uint32_t, MAX_DEPTH + 1> stack;
+    uint32_t                            size = 0;
+
+    stack[size++] = 0;
+
+    while (size > 0) {
+      const Node& node = pTree.nodes[stack[--size]];
+
+      if (!sphere.Intersects(node.bounds)) {
+        continue;
+      }
+
+      if (!node.IsLeaf()) {
+        stack[size++] = node.first;
+        stack[size++] = node.first + 1;
+        continue;
+      }
+
+      for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        if (sphere.Intersects(pItemBounds[pTree.items[i]])) {
+          items.push_back(pTree.items[i]);
+        }
+      }
+    }
+  }
+
+  RayHit Bvh::Raycast(const Ray& ray, float max_distance) const {
+    RayHit hit {};
+    hit.distance = max_distance;
+
+    if (pTree.node_count == 0) {
+      return hit;
+    }
+
+    const glm::vec3 inverse_direction = 1.0f / ray.direction;
+
+    // Entry distances are kept next to the stacked nodes, a closer hit found meanwhile skips them without a retest
+    std::array<uint32_t, MAX_DEPTH + 1> stack;
+    std::array<float, MAX_DEPTH + 1>    entries;
+    uint32_t                            size = 0;
+
+    entries[size] = RayEntry(ray.origin, inverse_direction, pTree.nodes[0].bounds, hit.distance);
+    stack[size++] = 0;
+
+    while (size > 0) {
+      size--;
+
+      if (entries[size] >= hit.distance) {
+        continue;
+      }
+
+      const Node& node = pTree.nodes[stack[size]];
+
+      if (node.IsLeaf()) {
+        for (uint32_t i = node.first; i < node.first + node.count; i++) {
+          uint32_t item     = pTree.items[i];
+          float    distance = RayEntry(ray.origin, inverse_direction, pItemBounds[item], hit.distance);
+
+          if (distance < hit.distance) {
+            hit = {item, distance};
+          }
+        }
+
+        continue;
+      }
+
+      float left  = RayEntry(ray.origin, inverse_direction, pTree.nodes[node.first].bounds, hit.distance);
+      float right = RayEntry(ray.origin, inverse_direction, pTree.nodes[node.first + 1].bounds, hit.distance);
+
+      // Push the farther child first so the nearer one is visited first and tightens the distance for the other
+      uint32_t near_child = left <= right ? node.first : node.first + 1;
+      uint32_t far_child  = left <= right ? node.first + 1 : node.first;
+      float    near_entry = std::min(left, right);
+      float    far_entry  = std::max(left, right);
+
+      if (far_entry < hit.distance) {
+        entries[size] = far_entry;
+        stack[size++] = far_child;
+      }
+
+      if (near_entry < hit.distance) {
+        entries[size] = near_entry;
+        stack[size++] = near_child;
+      }
+    }
+
+    return hit;
+  }
+
+  float Bvh::getCost() const {
+    if (pTree.node_count == 0) {
+      return 0.0f;
+    }
+
+    float root_area = pTree.nodes[0].bounds.getSurfaceArea();
+    return root_area > 0.0f ? static_cast<float>(pTree.area_sum / root_area) : 0.0f;
+  }
+
+  void Bvh::pBuildTree(JobSystem& job_system, const std::vector<AABB>& bounds, Tree& tree) {
+    const uint32_t count = static_cast<uint32_t>(bounds.size());
+
+    tree.items.resize(count);
+    tree.leaves.resize(count);
+    tree.nodes.resize(std::max(2 * count, 2u) - 1);
+    tree.parents.resize(tree.nodes.size());
+    tree.node_count = 0;
+    tree.area_sum   = 0.0;
+    tree.build_cost = 0.0f;
+
+    if (count == 0) {
+      return;
+    }
+
+    JobCounter   counter;
+    BuildContext context {tree, bounds, std::vector<glm::vec3>(count), {1}, job_system, counter};
+
+    for (uint32_t i = 0; i < count; i++) {
+      tree.items[i]        = i;
+      context.centroids[i] = bounds[i].getCenter();
+    }
+
+    tree.parents[0] = NO_NODE;
+
+    pBuildNode(context, 0, 0, count, 0);
+    job_system.Wait(counter);
+
+    tree.node_count = context.node_count.load();
+
+    for (uint32_t i = 0; i < tree.node_count; i++) {
+      tree.area_sum += tree.nodes[i].bounds.getSurfaceArea();
+    }
+
+    float root_area = tree.nodes[0].bounds.getSurfaceArea();
+    tree.build_cost = root_area > 0.0f ? static_cast<float>(tree.area_sum / root_area) : 0.0f;
+  }
+
+  // Binned SAH: centroids are sorted into BINS slices along the axis where they spread the most and the split between
+  // two slices with the lowest area * count on both sides wins
+  void Bvh::pBuildNode(BuildContext& context, uint32_t node, uint32_t first, uint32_t count, uint32_t depth) {
+    Tree& tree = context.tree;
+
+    AABB bounds {}, centroid_bounds {};
+
+    for (uint32_t i = first; i < first + count; i++) {
+      bounds.Expand(context.bounds[tree.items[i]]);
+      centroid_bounds.Expand(context.centroids[tree.items[i]]);
+    }
+
+    glm::vec3 extent = centroid_bounds.max - centroid_bounds.min;
+    uint32_t  axis   = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    // Identical centroids cannot be told apart, and the depth limit keeps traversal stacks bounded. A tiny or NaN
+    // extent would make the bin scale below infinite.
+    if (count <= MAX_LEAF_ITEMS || !(extent[axis] > MIN_SPLIT_EXTENT) || depth + 1 >= MAX_DEPTH) {
+      tree.nodes[node] = {bounds, first, count};
+
+      for (uint32_t i = first; i < first + count; i++) {
+        tree.leaves[tree.items[i]] = node;
+      }
+
+      return;
+    }
+
+    const float scale = BINS / extent[axis];
+
+    auto bin_of = [&](uint32_t item) {
+      float offset = (context.centroids[item][axis] - centroid_bounds.min[axis]) * scale;
+
+      // Clamped before converting, a float outside the range of uint32_t, or NaN, has no defined conversion
+      return offset > 0.0f ? static_cast<uint32_t>(std::min(offset, static_cast<float>(BINS - 1))) : 0u;
+    };
+
+    std::array<AABB, BINS>     bin_bounds {};
+    std::array<uint32_t, BINS> bin_counts {};
+
+    for (uint32_t i = first; i < first + count; i++) {
+      uint32_t bin = bin_of(tree.items[i]);
+
+      bin_bounds[bin].Expand(context.bounds[tree.items[i]]);
+      bin_counts[bin]++;
+    }
+
+    // Sweep from the right to get the cost of every right side, then from the left to find the best split
+    std::array<float, BINS> right_costs {};
+    AABB                    side {};
+    uint32_t                side_count = 0;
+
+    for (uint32_t bin = BINS - 1; bin > 0; bin--) {
+      side.Expand(bin_bounds[bin]);
+      side_count += bin_counts[bin];
+      right_costs[bin] = side_count > 0 ? side.getSurfaceArea() * side_count : 0.0f;
+    }
+
+    float    best_cost = std::numeric_limits<float>::infinity();
+    uint32_t best_bin  = 1;
+
+    side       = {};
+    side_count = 0;
+
+    for (uint32_t bin = 1; bin < BINS; bin++) {
+      side.Expand(bin_bounds[bin - 1]);
+      side_count += bin_counts[bin - 1];
+
+      float cost = (side_count > 0 ? side.getSurfaceArea() * side_count : 0.0f) + right_costs[bin];
+
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_bin  = bin;
+      }
+    }
+
+    // Both the lowest and the highest bin hold a centroid, so every split leaves items on both sides
+    auto begin  = tree.items.begin() + first;
+    auto middle = std::partition(begin, begin + count, [&](uint32_t item) { return bin_of(item) < best_bin; });
+
+    uint32_t left_count = static_cast<uint32_t>(middle - begin);
+
+    uint32_t left = context.node_count.fetch_add(2, std::memory_order_relaxed);
+
+    tree.nodes[node]       = {bounds, left, 0};
+    tree.parents[left]     = node;
+    tree.parents[left + 1] = node;
+
+    if (count > PARALLEL_THRESHOLD) {
+      context.job_system.Run(
+          [&context, left, first, left_count, depth]() { pBuildNode(context, left, first, left_count, depth + 1); },
+          context.counter);
+    } else {
+      pBuildNode(context, left, first, left_count, depth + 1);
+    }
+
+    pBuildNode(context, left + 1, first + left_count, count - left_count, depth + 1);
+  }
+
+  void Bvh::pRefitAll(Tree& tree, const std::vector<AABB>& bounds) {
+    tree.area_sum = 0.0;
+
+    for (uint32_t index = tree.node_count; index-- > 0;) {
+      Node& node = tree.nodes[index];
+
+      if (node.IsLeaf()) {
+        node.bounds = pLeafBounds(tree, bounds, node);
+      } else {
+        node.bounds = tree.nodes[node.first].bounds;
+        node.bounds.Expand(tree.nodes[node.first + 1].bounds);
+      }
+
+      tree.area_sum += node.bounds.getSurfaceArea();
+    }
+  }
+
+  AABB Bvh::pLeafBounds(const Tree& tree, const std::vector<AABB>& bounds, const Node& node) {
+    AABB result {};
+
+    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+      result.Expand(bounds[tree.items[i]]);
+    }
+
+    return result;
+  }
+
+  // The build runs as a job, but a thread waiting on other work may pick it up and run its serial top levels inline
+  void Bvh::pStartRebuild(JobSystem& job_system) {
+    pPendingBounds    = pItemBounds;
+    pRebuilding       = true;
+    pRebuildJobSystem = &job_system;
+
+    job_system.Run(
+        [this]() {
+          SVKE_PROFILE_SCOPE("Bvh::Rebuild");
+          pBuildTree(*pRebuildJobSystem, pPendingBounds, pPendingTree);
+        },
+        pRebuildCounter);
+  }
+
+  void Bvh::pFinishRebuild() {
+    std::swap(pTree, pPendingTree);
+
+    // Items may have moved while the new tree was being built from the snapshot. The build cost stays the one of the
+    // snapshot, so a tree that is already stale starts another rebuild right away.
+    pRefitAll(pTree, pItemBounds);
+
+    pDirtyLeaves.clear();
+    pDirtyNodes.assign(pTree.nodes.size(), 0);
+    pRebuilding = false;
+  }
+}
@@ -0,0 +1,120 @@
+#ifndef SVKE_BVH_HPP
+#define SVKE_BVH_HPP
+
+#include "bounds.hpp"
+#include "defines.hpp"
+#include "job_system.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  struct RayHit {
+    uint32_t item     = std::numeric_limits<uint32_t>::max();
+    float    distance = std::numeric_limits<float>::infinity();
+
+    bool IsHit() const { return item != std::numeric_limits<uint32_t>::max(); }
+  };
+
+  // Bounding volume hierarchy over the world bounds of a dense set of items, such as the game objects of a scene,
+  // answering frustum, sphere and ray queries in logarithmic time. Build makes a binned SAH tree, splitting the top
+  // levels over the job system. Moving items only update their bounds and the affected nodes are refitted, which keeps
+  // queries correct but slowly degrades the tree, so once its cost grows past REBUILD_RATIO times the cost it was built
+  // with a fresh tree is built in the background and swapped in by a later Refit.
+  class Bvh {
+   public:
+    static constexpr uint32_t BINS               = 16;
+    static constexpr uint32_t MAX_LEAF_ITEMS     = 4;
+    static constexpr uint32_t PARALLEL_THRESHOLD = 8192;  // Subtrees with more items than this become separate jobs
+    static constexpr float    REBUILD_RATIO      = 1.5f;
+    static constexpr float    MIN_SPLIT_EXTENT   = 1e-6f;  // Centroids spread less than this are treated as identical
+
+   public:
+    Bvh() = default;
+    ~Bvh();
+
+    Bvh(const Bvh& other) = delete;
+    Bvh& operator=(const Bvh& other) = delete;
+
+   public:
+    // Builds from scratch over items 0 to bounds.size() - 1, waiting for the result
+    void Build(JobSystem& job_system, const std::vector<AABB>& bounds);
+
+    // Marks an item as moved, nothing changes in the tree until the next Refit
+    void Update(uint32_t item, const AABB& bounds);
+
+    // Refits the nodes above moved items, swaps in a finished background rebuild and starts a new one once the tree
+    // got too slow. Queries are valid after this returns.
+    void Refit(JobSystem& job_system);
+
+    // Items whose bounds intersect the volume are appended to items
+    void QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& items) const;
+    void QuerySphere(const Sphere& sphere, std::vector<uint32_t>& items) const;
+
+    // Closest item whose bounds the ray enters within max_distance. Only tests bounds, callers wanting exact hits
+    // should test the returned item's geometry themselves.
+    RayHit Raycast(const Ray& ray, float max_distance = std::numeric_limits<float>::infinity()) const;
+
+    const AABB& getBounds(uint32_t item) const { return pItemBounds[item]; }
+    uint32_t    getSize() const { return static_cast<uint32_t>(pItemBounds.size()); }
+    uint32_t    getNodeCount() const { return pTree.node_count; }
+    bool        IsRebuilding() const { return pRebuilding; }
+
+    // Sum of the node surface areas relative to the root, the SAH estimate of the traversal cost of a random query
+    float getCost() const;
+    float getBuildCost() const { return pTree.build_cost; }
+
+   private:
+    static constexpr uint32_t NO_NODE = std::numeric_limits<uint32_t>::max();
+
+    // Leaves have count items starting at first in the tree's item order, interior nodes have their children at
+    // first and first + 1
+    struct Node {
+      AABB     bounds;
+      uint32_t first;
+      uint32_t count;
+
+      bool IsLeaf() const { return count > 0; }
+    };
+
+    struct Tree {
+      std::vector<Node>     nodes;
+      std::vector<uint32_t> parents;
+      std::vector<uint32_t> items;   // Item order, every leaf refers to a contiguous range of it
+      std::vector<uint32_t> leaves;  // Leaf holding each item
+      uint32_t              node_count {0};
+      double                area_sum {0.0};  // Surface area of all nodes, kept up to date by refits
+      float                 build_cost {0.0f};
+    };
+
+    struct BuildContext {
+      Tree&                    tree;
+      const std::vector<AABB>& bounds;
+      std::vector<glm::vec3>   centroids;
+      std::atomic<uint32_t>    node_count {1};
+      JobSystem&               job_system;
+      JobCounter&              counter;
+    };
+
+    static void pBuildTree(JobSystem& job_system, const std::vector<AABB>& bounds, Tree& tree);
+    static void pBuildNode(BuildContext& context, uint32_t node, uint32_t first, uint32_t count, uint32_t depth);
+    static void pRefitAll(Tree& tree, const std::vector<AABB>& bounds);
+    static AABB pLeafBounds(const Tree& tree, const std::vector<AABB>& bounds, const Node& node);
+
+    void pStartRebuild(JobSystem& job_system);
+    void pFinishRebuild();
+
+   private:
+    Tree                  pTree;
+    std::vector<AABB>     pItemBounds;
+    std::vector<uint32_t> pDirtyLeaves;
+    std::vector<uint8_t>  pDirtyNodes;  // Per node of pTree, set while the node waits for a refit
+
+    // Background rebuild over a snapshot of the bounds, items moved since are caught by refitting the new tree
+    Tree              pPendingTree;
+    std::vector<AABB> pPendingBounds;
+    JobCounter        pRebuildCounter;
+    JobSystem*        pRebuildJobSystem {nullptr};
+    bool              pRebuilding {false};
+  };
+}
+
+#endif
@@ -2,7 +2,7 @@
 #define SVKE_CAMERA_HPP
 
 #include "defines.hpp"
-#include "pch.hpp"
+#include "pch_core.hpp"
 
 namespace svke {
   class Camera {
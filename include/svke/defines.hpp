@@ -3,8 +3,17 @@
 #  define SVKE_VERBOSE_PRESENT_MODE
 #  define SVKE_VERBOSE_DEVICE_INFO
 #  define SVKE_VERBOSE_VALIDATION_LAYER
+#  define SVKE_VERBOSE_PIPELINE_LIBRARY
+#  define SVKE_VERBOSE_RENDER_STATS
+#  define SVKE_VERBOSE_LATENCY
+#  define SVKE_VERBOSE_ASSET_CACHE
+#  define SVKE_VERBOSE_MEMORY
+#  define SVKE_VERBOSE_STARTUP
 #endif
 
+// Bump whenever asset processing changes its output, invalidating every entry of the asset cache
+#define SVKE_ASSET_VERSION 2
+
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
 #  ifdef _WIN64
 #    define SVKE_TARGET_WIN64
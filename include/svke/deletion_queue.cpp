@@ -0,0 +1,35 @@
+#include "defines.hpp"
+#include "deletion_queue.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  void DeletionQueue::Push(uint64_t frame_value, std::function<void()> destroy) {
+    std::lock_guard<std::mutex> lock {pMutex};
+    pEntries.push_back({frame_value, std::move(destroy)});
+  }
+
+  void DeletionQueue::Collect(uint64_t completed_frame_value) {
+    std::vector<Entry> ready;
+
+    {
+      std::lock_guard<std::mutex> lock {pMutex};
+
+      while (!pEntries.empty() && pEntries.front().frame_value <= completed_frame_value) {
+        ready.push_back(std::move(pEntries.front()));
+        pEntries.pop_front();
+      }
+    }
+
+    // Run outside the lock, destroying a resource may queue the destruction of another
+    for (auto& entry : ready) {
+      entry.destroy();
+    }
+  }
+
+  void DeletionQueue::Flush() { Collect(std::numeric_limits<uint64_t>::max()); }
+
+  uint64_t DeletionQueue::getSize() const {
+    std::lock_guard<std::mutex> lock {pMutex};
+    return pEntries.size();
+  }
+}
@@ -0,0 +1,36 @@
+#ifndef SVKE_DELETION_QUEUE_HPP
+#define SVKE_DELETION_QUEUE_HPP
+
+#include "defines.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  // Destruction callbacks tagged with the frame value of the last GPU work that may use the resource. Collect runs
+  // every callback whose value has completed. Entries are collected in order, so an entry with a lower value queued
+  // after one with a higher value waits for it, which is later than needed but never too early.
+  class DeletionQueue {
+   public:
+    DeletionQueue() = default;
+
+    DeletionQueue(const DeletionQueue& other) = delete;
+    DeletionQueue& operator=(const DeletionQueue& other) = delete;
+
+   public:
+    void Push(uint64_t frame_value, std::function<void()> destroy);
+    void Collect(uint64_t completed_frame_value);
+    void Flush();
+
+    uint64_t getSize() const;
+
+   private:
+    struct Entry {
+      uint64_t              frame_value;
+      std::function<void()> destroy;
+    };
+
+    mutable std::mutex pMutex;
+    std::deque<Entry>  pEntries;
+  };
+}
+
+#endif
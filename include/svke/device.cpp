@@ -51,9 +51,55 @@ namespace svke {
     pPickPhysicalDevice();
     pCreateLogicalDevice();
     pCreateCommandPool();
+
+    // Waiting on an upload from the graphics queue needs the upload context's timeline semaphore, without one uploads
+    // stay on the graphics queue where submission order is enough
+    if (pQueueFamilies.HasDedicatedTransfer() && SupportsTimelineSemaphores()) {
+      pSharedQueueFamilies = {pQueueFamilies.graphics_family, pQueueFamilies.transfer_family};
+      pUploadContext = std::make_unique<UploadContext>(*this, pTransferQueue, pQueueFamilies.transfer_family, true);
+      pGraphicsUploadContext =
+          std::make_unique<UploadContext>(*this, pGraphicsQueue, pQueueFamilies.graphics_family, false);
+    } else {
+      pUploadContext = std::make_unique<UploadContext>(*this, pGraphicsQueue, pQueueFamilies.graphics_family, false);
+    }
+
+#ifdef SVKE_VERBOSE_DEVICE_INFO
+    std::cout << "Queue families: graphics " << pQueueFamilies.graphics_family << ", present "
+              << pQueueFamilies.present_family << ", transfer " << pQueueFamilies.transfer_family
+              << (HasAsyncUploads() ? " (async uploads)" : "") << std::endl;
+#endif
   }
 
   Device::~Device() {
+    pGraphicsUploadContext.reset();
+    pUploadContext.reset();
+
+    // Everything still queued belongs to work the owner already waited for before tearing down
+    pDeletionQueue.Flush();
+
+    if (pFrameTimeline != VK_NULL_HANDLE) {
+      vkDestroySemaphore(pDevice, pFrameTimeline, nullptr);
+    }
+
+#ifdef SVKE_VERBOSE_MEMORY
+    MemoryReport report = QueryMemoryReport();
+
+    std::cout << "Device memory high water mark: " << report.total.peak / 1024 << " KiB total";
+
+    for (uint32_t category = 0; category < report.categories.size(); category++) {
+      std::cout << ", " << MemoryCategoryName(static_cast<MemoryCategory>(category)) << " "
+                << report.categories[category].peak / 1024 << " KiB";
+    }
+
+    std::cout << std::endl;
+
+    for (uint32_t heap = 0; heap < report.heaps.size(); heap++) {
+      std::cout << "  Heap " << heap << (report.heaps[heap].device_local ? " (device local)" : "") << ": peak "
+                << report.heaps[heap].usage.peak / 1024 << " KiB of " << report.heaps[heap].size / 1024 / 1024
+                << " MiB, " << report.heaps[heap].usage.allocations << " allocations still live" << std::endl;
+    }
+#endif
+
     vkDestroyCommandPool(pDevice, pCommandPool, nullptr);
     vkDestroyDevice(pDevice, nullptr);
 
@@ -65,6 +111,54 @@ namespace svke {
     vkDestroyInstance(pInstance, nullptr);
   }
 
+  void Device::RetireFrameValue(uint64_t completed_frame_value) {
+    uint64_t previous = pCompletedFrameValue.load(std::memory_order_relaxed);
+
+    while (previous < completed_frame_value &&
+           !pCompletedFrameValue.compare_exchange_weak(previous, completed_frame_value, std::memory_order_acq_rel)) {
+    }
+
+    pDeletionQueue.Collect(getCompletedFrameValue());
+  }
+
+  uint64_t Device::QueryCompletedFrameValue() {
+    if (!SupportsTimelineSemaphores()) {
+      return getCompletedFrameValue();
+    }
+
+    uint64_t value = 0;
+    vkGetSemaphoreCounterValue(pDevice, pFrameTimeline, &value);
+
+    return value;
+  }
+
+  void Device::WaitFrameValue(uint64_t frame_value) {
+    assert(SupportsTimelineSemaphores() && "Waiting on frame values needs timeline semaphores");
+
+    VkSemaphoreWaitInfo wait_info = {};
+    wait_info.sType               = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    wait_info.semaphoreCount      = 1;
+    wait_info.pSemaphores         = &pFrameTimeline;
+    wait_info.pValues             = &frame_value;
+
+    if (vkWaitSemaphores(pDevice, &wait_info, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to wait for frame timeline");
+    }
+  }
+
+  void Device::RetireCompletedFrames(uint64_t known_completed_value) {
+    RetireFrameValue(std::max(known_completed_value, QueryCompletedFrameValue()));
+  }
+
+  void Device::DeferDestroy(uint64_t frame_value, std::function<void()> destroy) {
+    if (frame_value <= getCompletedFrameValue()) {
+      destroy();
+      return;
+    }
+
+    pDeletionQueue.Push(frame_value, std::move(destroy));
+  }
+
   void Device::pCreateInstance() {
 #ifdef SVKE_DEBUG
     if (!pCheckValidationLayerSupport()) {
@@ -80,6 +174,21 @@ namespace svke {
     app_info.engineVersion      = VK_MAKE_VERSION(1, 0, 0);
     app_info.apiVersion         = VK_API_VERSION_1_0;
 
+    // Vulkan 1.0 loaders do not export vkEnumerateInstanceVersion
+    auto enumerate_instance_version = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+        vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion"));
+
+    if (enumerate_instance_version != nullptr) {
+      uint32_t instance_version = VK_API_VERSION_1_0;
+      enumerate_instance_version(&instance_version);
+
+      if (instance_version >= VK_API_VERSION_1_2) {
+        app_info.apiVersion = VK_API_VERSION_1_2;
+      }
+    }
+
+    pApiVersion = app_info.apiVersion;
+
     VkInstanceCreateInfo create_info = {};
     create_info.sType                = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     create_info.pApplicationInfo     = &app_info;
@@ -125,7 +234,19 @@ namespace svke {
 
     vkEnumeratePhysicalDevices(pInstance, &device_count, devices.data());
 
+    // Picks a device by name, such as llvmpipe to run on lavapipe
+    const char *requested_name = std::getenv("SVKE_DEVICE");
+
     for (const auto &device : devices) {
+      if (requested_name != nullptr) {
+        VkPhysicalDeviceProperties device_properties;
+        vkGetPhysicalDeviceProperties(device, &device_properties);
+
+        if (std::strstr(device_properties.deviceName, requested_name) == nullptr) {
+          continue;
+        }
+      }
+
       if (pDeviceSuitable(device)) {
         pPhysicalDevice = device;
         break;
@@ -133,10 +254,13 @@ namespace svke {
     }
 
     if (pPhysicalDevice == VK_NULL_HANDLE) {
-      throw std::runtime_error("Failed to find a suitable GPU");
+      throw std::runtime_error(requested_name != nullptr ? "Failed to find a suitable GPU named " +
+                                                               std::string(requested_name)
+                                                         : "Failed to find a suitable GPU");
     }
 
     vkGetPhysicalDeviceProperties(pPhysicalDevice, &properties);
+    vkGetPhysicalDeviceMemoryProperties(pPhysicalDevice, &pMemoryProperties);
 
 #ifdef SVKE_VERBOSE_DEVICE_INFO
     std::cout << "Physical device: " << properties.deviceName << std::endl;
@@ -147,7 +271,8 @@ namespace svke {
     QueueFamilyIndices indices = pFindQueueFamilies(pPhysicalDevice);
 
     std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
-    std::set<uint32_t>                   unique_queue_families = {indices.graphics_family, indices.present_family};
+    std::set<uint32_t>                   unique_queue_families = {
+        indices.graphics_family, indices.present_family, indices.transfer_family};
 
     float queue_priority = 1.0f;
 
@@ -160,18 +285,39 @@ namespace svke {
       queue_create_infos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(pPhysicalDevice, &supported_features);
+
     VkPhysicalDeviceFeatures device_features = {};
     device_features.samplerAnisotropy        = VK_TRUE;
+    device_features.textureCompressionBC     = supported_features.textureCompressionBC;
+    device_features.pipelineStatisticsQuery  = supported_features.pipelineStatisticsQuery;
+
+    pPipelineStatisticsSupported = supported_features.pipelineStatisticsQuery;
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures timeline_features = {};
+    timeline_features.sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timeline_features.timelineSemaphore = VK_TRUE;
+
+    bool use_timeline = pTimelineSemaphoresSupported();
 
     VkDeviceCreateInfo create_info = {};
     create_info.sType              = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    create_info.pNext              = use_timeline ? &timeline_features : nullptr;
 
     create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
     create_info.pQueueCreateInfos    = queue_create_infos.data();
 
     create_info.pEnabledFeatures        = &device_features;
-    create_info.enabledExtensionCount   = static_cast<uint32_t>(pDeviceExtensions.size());
-    create_info.ppEnabledExtensionNames = pDeviceExtensions.data();
+    std::vector<const char *> extensions = pDeviceExtensions;
+
+    if (pMemoryBudgetAvailable()) {
+      extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+      pMemoryBudgetSupported = true;
+    }
+
+    create_info.enabledExtensionCount   = static_cast<uint32_t>(extensions.size());
+    create_info.ppEnabledExtensionNames = extensions.data();
 
 #ifdef SVKE_DEBUG
     create_info.enabledLayerCount   = static_cast<uint32_t>(pValidationLayers.size());
@@ -186,6 +332,93 @@ namespace svke {
 
     vkGetDeviceQueue(pDevice, indices.graphics_family, 0, &pGraphicsQueue);
     vkGetDeviceQueue(pDevice, indices.present_family, 0, &pPresentQueue);
+    vkGetDeviceQueue(pDevice, indices.transfer_family, 0, &pTransferQueue);
+
+    for (VkQueue queue : {pGraphicsQueue, pPresentQueue, pTransferQueue}) {
+      auto known = std::find_if(pQueueLocks.begin(), pQueueLocks.end(), [&](const auto &lock) {
+        return lock.first == queue;
+      });
+
+      if (known == pQueueLocks.end()) {
+        pQueueLocks.emplace_back(queue, std::make_unique<std::mutex>());
+      }
+    }
+
+    pQueueFamilies = indices;
+
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(pPhysicalDevice, &family_count, nullptr);
+    std::vector<VkQueueFamilyProperties> families(family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(pPhysicalDevice, &family_count, families.data());
+
+    pTimestampValidBits = families[indices.graphics_family].timestampValidBits;
+
+    if (use_timeline) {
+      pCreateFrameTimeline();
+    }
+
+#ifdef SVKE_VERBOSE_DEVICE_INFO
+    std::cout << "Frame synchronization: " << (use_timeline ? "timeline semaphore" : "fences") << std::endl;
+#endif
+  }
+
+  bool Device::pTimelineSemaphoresSupported() {
+    const char *disable = std::getenv("SVKE_DISABLE_TIMELINE");
+
+    if (disable != nullptr && std::string(disable) != "0") {
+      return false;
+    }
+
+    if (pApiVersion < VK_API_VERSION_1_2 || properties.apiVersion < VK_API_VERSION_1_2) {
+      return false;
+    }
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures timeline_features = {};
+    timeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType                     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext                     = &timeline_features;
+
+    vkGetPhysicalDeviceFeatures2(pPhysicalDevice, &features);
+
+    return timeline_features.timelineSemaphore == VK_TRUE;
+  }
+
+  bool Device::pMemoryBudgetAvailable() {
+    // Querying the budget goes through vkGetPhysicalDeviceMemoryProperties2
+    if (pApiVersion < VK_API_VERSION_1_1 || properties.apiVersion < VK_API_VERSION_1_1) {
+      return false;
+    }
+
+    uint32_t extension_count;
+    vkEnumerateDeviceExtensionProperties(pPhysicalDevice, nullptr, &extension_count, nullptr);
+
+    std::vector<VkExtensionProperties> available_extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(pPhysicalDevice, nullptr, &extension_count, available_extensions.data());
+
+    for (const auto &extension : available_extensions) {
+      if (strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void Device::pCreateFrameTimeline() {
+    VkSemaphoreTypeCreateInfo type_info = {};
+    type_info.sType                     = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    type_info.semaphoreType             = VK_SEMAPHORE_TYPE_TIMELINE;
+    type_info.initialValue              = 0;
+
+    VkSemaphoreCreateInfo semaphore_info = {};
+    semaphore_info.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_info.pNext                 = &type_info;
+
+    if (vkCreateSemaphore(pDevice, &semaphore_info, nullptr, &pFrameTimeline) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create frame timeline semaphore");
+    }
   }
 
   void Device::pCreateCommandPool() {
@@ -351,6 +584,10 @@ namespace svke {
 
     int i = 0;
     for (const auto &queue_family : queue_families) {
+      if (indices.IsComplete()) {
+        break;
+      }
+
       if (queue_family.queueCount > 0 && queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
         indices.graphics_family           = i;
         indices.graphics_family_has_value = true;
@@ -361,13 +598,38 @@ namespace svke {
         indices.present_family           = i;
         indices.present_family_has_value = true;
       }
-      if (indices.IsComplete()) {
-        break;
-      }
 
       i++;
     }
 
+    if (!indices.graphics_family_has_value) {
+      return indices;
+    }
+
+    indices.transfer_family = indices.graphics_family;
+
+    const char *disable = std::getenv("SVKE_DISABLE_ASYNC_QUEUES");
+
+    if (disable != nullptr && std::string(disable) != "0") {
+      return indices;
+    }
+
+    // Transfer only families are usually backed by the copy engines
+    for (uint32_t family = 0; family < queue_family_count; family++) {
+      const VkQueueFamilyProperties &properties = queue_families[family];
+
+      if (properties.queueCount == 0 || properties.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        continue;
+      }
+
+      bool compute  = properties.queueFlags & VK_QUEUE_COMPUTE_BIT;
+      bool transfer = properties.queueFlags & VK_QUEUE_TRANSFER_BIT;
+
+      if (transfer && !compute && !indices.HasDedicatedTransfer()) {
+        indices.transfer_family = family;
+      }
+    }
+
     return indices;
   }
 
@@ -393,6 +655,64 @@ namespace svke {
     return details;
   }
 
+  VkFormatProperties Device::getFormatProperties(VkFormat format) {
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties(pPhysicalDevice, format, &format_properties);
+
+    return format_properties;
+  }
+
+  MemoryBudget Device::QueryMemoryBudget() {
+    MemoryReport report = QueryMemoryReport();
+    MemoryBudget budget {0, 0, report.from_extension};
+
+    for (const auto &heap : report.heaps) {
+      if (!heap.device_local) {
+        continue;
+      }
+
+      // Without the extension only what the engine allocated itself is known
+      budget.budget += report.from_extension ? heap.budget : heap.size;
+      budget.usage += report.from_extension ? heap.process_usage : heap.usage.current;
+    }
+
+    return budget;
+  }
+
+  MemoryReport Device::QueryMemoryReport() {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties = {};
+    budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 memory_properties = {};
+    memory_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+
+    if (pMemoryBudgetSupported) {
+      memory_properties.pNext = &budget_properties;
+      vkGetPhysicalDeviceMemoryProperties2(pPhysicalDevice, &memory_properties);
+    } else {
+      memory_properties.memoryProperties = pMemoryProperties;
+    }
+
+    const uint32_t heap_count = memory_properties.memoryProperties.memoryHeapCount;
+
+    MemoryReport report   = pMemoryTracker.getReport(heap_count);
+    report.from_extension = pMemoryBudgetSupported;
+
+    for (uint32_t heap = 0; heap < heap_count; heap++) {
+      const VkMemoryHeap &memory_heap = memory_properties.memoryProperties.memoryHeaps[heap];
+
+      report.heaps[heap].size         = memory_heap.size;
+      report.heaps[heap].device_local = memory_heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+
+      if (pMemoryBudgetSupported) {
+        report.heaps[heap].budget        = budget_properties.heapBudget[heap];
+        report.heaps[heap].process_usage = budget_properties.heapUsage[heap];
+      }
+    }
+
+    return report;
+  }
+
   VkFormat Device::FindSupportedFormat(const std::vector<VkFormat> &candidates,
                                        VkImageTiling                tiling,
                                        VkFormatFeatureFlags         features) {
@@ -425,13 +745,21 @@ namespace svke {
                             VkBufferUsageFlags    usage,
                             VkMemoryPropertyFlags properties,
                             VkBuffer &            buffer,
-                            VkDeviceMemory &      bufferMemory) {
+                            VkDeviceMemory &      bufferMemory,
+                            MemoryCategory        category) {
     VkBufferCreateInfo bufferInfo {};
     bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size        = size;
     bufferInfo.usage       = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+    // Filled by the transfer queue and read by the graphics queue without an ownership transfer
+    if (HasAsyncUploads() && (usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT)) {
+      bufferInfo.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+      bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(pSharedQueueFamilies.size());
+      bufferInfo.pQueueFamilyIndices   = pSharedQueueFamilies.data();
+    }
+
     if (vkCreateBuffer(pDevice, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
       throw std::runtime_error("Failed to create vertex buffer");
     }
@@ -448,82 +776,90 @@ namespace svke {
       throw std::runtime_error("Failed to allocate vertex buffer memory");
     }
 
+    const uint32_t heap = pMemoryProperties.memoryTypes[alloc_info.memoryTypeIndex].heapIndex;
+    pMemoryTracker.Track(bufferMemory, alloc_info.allocationSize, heap, category);
+
     vkBindBufferMemory(pDevice, buffer, bufferMemory, 0);
   }
 
-  VkCommandBuffer Device::BeginSingleTimeCommands() {
-    VkCommandBufferAllocateInfo alloc_info {};
-    alloc_info.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    alloc_info.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    alloc_info.commandPool        = pCommandPool;
-    alloc_info.commandBufferCount = 1;
+  void Device::FreeMemory(VkDeviceMemory memory) {
+    pMemoryTracker.Untrack(memory);
+    vkFreeMemory(pDevice, memory, nullptr);
+  }
 
-    VkCommandBuffer command_buffer;
-    vkAllocateCommandBuffers(pDevice, &alloc_info, &command_buffer);
+  std::vector<TimelineWait> Device::SubmitUploads(VkPipelineStageFlags wait_stages) {
+    std::vector<TimelineWait> waits;
 
-    VkCommandBufferBeginInfo begin_info {};
-    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (pGraphicsUploadContext != nullptr) {
+      pGraphicsUploadContext->Submit();
+    }
 
-    vkBeginCommandBuffer(command_buffer, &begin_info);
-    return command_buffer;
-  }
+    UploadTicket ticket = pUploadContext->Submit();
 
-  void Device::EndSingleTimeCommands(VkCommandBuffer command_buffer) {
-    vkEndCommandBuffer(command_buffer);
+    if (pUploadContext->getTimeline() != VK_NULL_HANDLE && ticket > 0) {
+      waits.push_back({pUploadContext->getTimeline(), ticket, wait_stages});
+    }
 
-    VkSubmitInfo submit_info {};
-    submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers    = &command_buffer;
+    return waits;
+  }
 
-    vkQueueSubmit(pGraphicsQueue, 1, &submit_info, VK_NULL_HANDLE);
-    vkQueueWaitIdle(pGraphicsQueue);
+  void Device::PollUploads() {
+    if (pGraphicsUploadContext != nullptr) {
+      pGraphicsUploadContext->Poll();
+    }
 
-    vkFreeCommandBuffers(pDevice, pCommandPool, 1, &command_buffer);
+    pUploadContext->Poll();
   }
 
-  void Device::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-    VkCommandBuffer command_buffer = BeginSingleTimeCommands();
-
-    VkBufferCopy copy_region {};
-    copy_region.srcOffset = 0;  // Optional
-    copy_region.dstOffset = 0;  // Optional
-    copy_region.size      = size;
-    vkCmdCopyBuffer(command_buffer, srcBuffer, dstBuffer, 1, &copy_region);
+  std::unique_lock<std::mutex> Device::LockQueue(VkQueue queue) {
+    for (auto &lock : pQueueLocks) {
+      if (lock.first == queue) {
+        return std::unique_lock<std::mutex> {*lock.second};
+      }
+    }
 
-    EndSingleTimeCommands(command_buffer);
+    assert(false && "Queue does not belong to this device");
+    return {};
   }
 
-  void Device::CopyBufferToImage(VkBuffer buffer,
-                                 VkImage  image,
-                                 uint32_t width,
-                                 uint32_t height,
-                                 uint32_t layer_count) {
-    VkCommandBuffer command_buffer = BeginSingleTimeCommands();
+  void Device::WaitIdle() {
+    std::vector<std::unique_lock<std::mutex>> locks;
 
-    VkBufferImageCopy region {};
-    region.bufferOffset      = 0;
-    region.bufferRowLength   = 0;
-    region.bufferImageHeight = 0;
+    // Always taken in the same order, nothing else holds more than one queue lock at a time
+    for (auto &lock : pQueueLocks) {
+      locks.emplace_back(*lock.second);
+    }
 
-    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel       = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount     = layer_count;
+    vkDeviceWaitIdle(pDevice);
+  }
 
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {width, height, 1};
+  UploadTicket Device::CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size) {
+    return pUploadContext->CopyBuffer(src_buffer, dst_buffer, size);
+  }
 
-    vkCmdCopyBufferToImage(command_buffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-    EndSingleTimeCommands(command_buffer);
+  UploadTicket Device::CopyBufferToImage(VkBuffer buffer,
+                                         VkImage  image,
+                                         uint32_t width,
+                                         uint32_t height,
+                                         uint32_t layers) {
+    return pUploadContext->CopyBufferToImage(buffer, image, width, height, layers);
   }
 
   void Device::CreateImageWithInfo(const VkImageCreateInfo &imageInfo,
                                    VkMemoryPropertyFlags    properties,
                                    VkImage &                image,
-                                   VkDeviceMemory &         imageMemory) {
-    if (vkCreateImage(pDevice, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+                                   VkDeviceMemory &         imageMemory,
+                                   MemoryCategory           category) {
+    VkImageCreateInfo create_info = imageInfo;
+
+    if (HasAsyncUploads() && create_info.sharingMode == VK_SHARING_MODE_EXCLUSIVE &&
+        (create_info.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+      create_info.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+      create_info.queueFamilyIndexCount = static_cast<uint32_t>(pSharedQueueFamilies.size());
+      create_info.pQueueFamilyIndices   = pSharedQueueFamilies.data();
+    }
+
+    if (vkCreateImage(pDevice, &create_info, nullptr, &image) != VK_SUCCESS) {
       throw std::runtime_error("Failed to create image");
     }
 
@@ -539,6 +875,9 @@ namespace svke {
       throw std::runtime_error("Failed to allocate image memory");
     }
 
+    const uint32_t heap = pMemoryProperties.memoryTypes[alloc_info.memoryTypeIndex].heapIndex;
+    pMemoryTracker.Track(imageMemory, alloc_info.allocationSize, heap, category);
+
     if (vkBindImageMemory(pDevice, image, imageMemory, 0) != VK_SUCCESS) {
       throw std::runtime_error("Failed to bind image memory");
     }
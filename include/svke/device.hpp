@@ -2,7 +2,10 @@
 #define SVKE_DEVICE_HPP
 
 #include "defines.hpp"
+#include "deletion_queue.hpp"
+#include "memory_tracker.hpp"
 #include "pch.hpp"
+#include "upload_context.hpp"
 #include "window.hpp"
 
 namespace svke {
@@ -12,12 +15,30 @@ namespace svke {
     std::vector<VkPresentModeKHR>   present_modes;
   };
 
+  // The transfer family falls back to the graphics family on devices without a dedicated one
   struct QueueFamilyIndices {
     uint32_t graphics_family;
     uint32_t present_family;
+    uint32_t transfer_family;
     bool     graphics_family_has_value = false;
     bool     present_family_has_value  = false;
     bool     IsComplete() { return graphics_family_has_value && present_family_has_value; }
+    bool     HasDedicatedTransfer() const { return transfer_family != graphics_family; }
+  };
+
+  // Device local memory over all heaps. Without VK_EXT_memory_budget the budget is the heap size and usage only counts
+  // allocations made through the device.
+  struct MemoryBudget {
+    VkDeviceSize budget;
+    VkDeviceSize usage;
+    bool         from_extension;
+  };
+
+  // A timeline semaphore value a queue submission waits for before running the given stages
+  struct TimelineWait {
+    VkSemaphore          semaphore;
+    uint64_t             value;
+    VkPipelineStageFlags stages;
   };
 
   class Device {
@@ -36,33 +57,83 @@ namespace svke {
     VkSurfaceKHR  getSurface() { return pSurface; }
     VkQueue       getGraphicsQueue() { return pGraphicsQueue; }
     VkQueue       getPresentQueue() { return pPresentQueue; }
+    VkQueue       getTransferQueue() { return pTransferQueue; }
+
+    // Vulkan requires submits and presents on a queue to be externally synchronized, and uploads may submit from
+    // worker threads, so every one of them holds the queue's lock. Queues that alias one another share a lock.
+    // WaitIdle holds all of them.
+    std::unique_lock<std::mutex> LockQueue(VkQueue queue);
+    void                         WaitIdle();
+
+    const QueueFamilyIndices &getQueueFamilies() const { return pQueueFamilies; }
 
    public:
     SwapChainSupportDetails getSwapChainSupport() { return pQuerySwapChainSupport(pPhysicalDevice); }
     uint32_t                FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
     QueueFamilyIndices      FindPhysicalQueueFamilies() { return pFindQueueFamilies(pPhysicalDevice); }
+    VkFormatProperties      getFormatProperties(VkFormat format);
+    MemoryBudget            QueryMemoryBudget();
+    MemoryReport            QueryMemoryReport();
+    bool                    SupportsMemoryBudget() const { return pMemoryBudgetSupported; }
+    bool                    SupportsPipelineStatistics() const { return pPipelineStatisticsSupported; }
+    uint32_t                getTimestampValidBits() const { return pTimestampValidBits; }  // Graphics queue, 0 if none
     VkFormat                FindSupportedFormat(const std::vector<VkFormat> &candidates,
                                                 VkImageTiling                tiling,
                                                 VkFormatFeatureFlags         features);
 
    public:
-    void            CreateBuffer(VkDeviceSize          size,
-                                 VkBufferUsageFlags    usage,
-                                 VkMemoryPropertyFlags properties,
-                                 VkBuffer &            buffer,
-                                 VkDeviceMemory &      buffer_memory);
-    VkCommandBuffer BeginSingleTimeCommands();
-    void            EndSingleTimeCommands(VkCommandBuffer command_buffer);
-    void            CopyBuffer(VkBuffer src_buffer, VkBuffer dst_uffer, VkDeviceSize size);
-    void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layer_count);
+    // Allocations are tracked per category and heap, memory allocated here has to be released through FreeMemory
+    void CreateBuffer(VkDeviceSize          size,
+                      VkBufferUsageFlags    usage,
+                      VkMemoryPropertyFlags properties,
+                      VkBuffer &            buffer,
+                      VkDeviceMemory &      buffer_memory,
+                      MemoryCategory        category);
+    void FreeMemory(VkDeviceMemory memory);
+
+    // Copies are batched on the upload context, wait on the returned ticket before reading the destination on the CPU.
+    // Uploads run on the dedicated transfer queue when there is one and the device has timeline semaphores, in which
+    // case buffers and images created with a transfer destination usage are shared concurrently with that family.
+    UploadTicket   CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size);
+    UploadTicket   CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layers);
+    UploadContext &getUploadContext() { return *pUploadContext; }
+    bool           HasAsyncUploads() const { return pSharedQueueFamilies.size() > 1; }
+
+    // Upload context on the graphics queue, for uploads that also record graphics only commands such as blits. The
+    // same context as getUploadContext when uploads are not async.
+    UploadContext &getGraphicsUploadContext() { return HasAsyncUploads() ? *pGraphicsUploadContext : *pUploadContext; }
+
+    // Submits the pending uploads of every context, returns what a graphics queue submit has to wait on to see them
+    std::vector<TimelineWait> SubmitUploads(VkPipelineStageFlags wait_stages);
+    void                      PollUploads();
 
     void CreateImageWithInfo(const VkImageCreateInfo &image_info,
                              VkMemoryPropertyFlags    properties,
                              VkImage &                image,
-                             VkDeviceMemory &         image_memory);
+                             VkDeviceMemory &         image_memory,
+                             MemoryCategory           category);
 
     VkPhysicalDeviceProperties properties;
 
+   public:
+    // Every frame submitted to the GPU gets the next frame value. Resources handed to DeferDestroy are destroyed once
+    // the frame value they were last used in has completed, by default the frame currently being recorded.
+    uint64_t getFrameValue() const { return pFrameValue.load(std::memory_order_acquire); }
+    uint64_t getCompletedFrameValue() const { return pCompletedFrameValue.load(std::memory_order_acquire); }
+    void     AdvanceFrameValue() { pFrameValue.fetch_add(1, std::memory_order_acq_rel); }
+    void     RetireFrameValue(uint64_t completed_frame_value);
+
+    // With timeline semaphores every frame submit signals the frame timeline with its frame value, otherwise frames are
+    // tracked with fences by the swap chain and completion is only known through RetireFrameValue
+    bool        SupportsTimelineSemaphores() const { return pFrameTimeline != VK_NULL_HANDLE; }
+    VkSemaphore getFrameTimeline() const { return pFrameTimeline; }
+    uint64_t    QueryCompletedFrameValue();
+    void        WaitFrameValue(uint64_t frame_value);
+    void        RetireCompletedFrames(uint64_t known_completed_value);
+
+    void DeferDestroy(std::function<void()> destroy) { DeferDestroy(getFrameValue(), std::move(destroy)); }
+    void DeferDestroy(uint64_t frame_value, std::function<void()> destroy);
+
    private:
     void pCreateInstance();
     void pSetupDebugMessenger();
@@ -70,9 +141,12 @@ namespace svke {
     void pPickPhysicalDevice();
     void pCreateLogicalDevice();
     void pCreateCommandPool();
+    void pCreateFrameTimeline();
 
    private:
     bool                      pDeviceSuitable(VkPhysicalDevice device);
+    bool                      pTimelineSemaphoresSupported();
+    bool                      pMemoryBudgetAvailable();
     std::vector<const char *> getRequiredExtensions();
     bool                      pCheckValidationLayerSupport();
     QueueFamilyIndices        pFindQueueFamilies(VkPhysicalDevice device);
@@ -87,12 +161,36 @@ namespace svke {
     VkPhysicalDevice         pPhysicalDevice = VK_NULL_HANDLE;
     Window &                 pWindow;
     VkCommandPool            pCommandPool;
+    uint32_t                 pApiVersion = VK_API_VERSION_1_0;
+    bool                     pMemoryBudgetSupported {false};
+    bool                     pPipelineStatisticsSupported {false};
+    uint32_t                 pTimestampValidBits {0};
+
+    VkPhysicalDeviceMemoryProperties pMemoryProperties;
+    MemoryTracker                    pMemoryTracker;
 
    private:
     VkDevice     pDevice;
     VkSurfaceKHR pSurface;
     VkQueue      pGraphicsQueue;
     VkQueue      pPresentQueue;
+    VkQueue      pTransferQueue;
+
+    QueueFamilyIndices    pQueueFamilies;
+    std::vector<uint32_t> pSharedQueueFamilies;
+
+    // Filled once the queues are known and never changed afterwards, so lookups need no lock of their own
+    std::vector<std::pair<VkQueue, std::unique_ptr<std::mutex>>> pQueueLocks;
+
+   private:
+    std::unique_ptr<UploadContext> pUploadContext;
+    std::unique_ptr<UploadContext> pGraphicsUploadContext;
+
+   private:
+    DeletionQueue         pDeletionQueue;
+    std::atomic<uint64_t> pFrameValue {1};
+    std::atomic<uint64_t> pCompletedFrameValue {0};
+    VkSemaphore           pFrameTimeline = VK_NULL_HANDLE;
 
    private:
     const std::vector<const char *> pValidationLayers = {"VK_LAYER_KHRONOS_validation"};
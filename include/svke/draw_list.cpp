@@ -0,0 +1,136 @@
+#include "draw_list.hpp"
+
+#include "defines.hpp"
+#include "pch_core.hpp"
+
+namespace svke {
+  // LSD radix sort over the 8 bytes of the key. All histograms are built in a single pass and passes where every key
+  // shares the same byte are skipped, which is common for the pass and material bytes.
+  void DrawList::Sort() {
+    constexpr uint32_t RADIX_BITS = 8;
+    constexpr uint32_t BUCKETS    = 1 << RADIX_BITS;
+    constexpr uint32_t PASSES     = 64 / RADIX_BITS;
+
+    const uint64_t count = pItems.size();
+
+    if (count < 2) {
+      return;
+    }
+
+    std::array<std::array<uint32_t, BUCKETS>, PASSES> histograms {};
+
+    for (const auto& item : pItems) {
+      for (uint32_t pass = 0; pass < PASSES; pass++) {
+        histograms[pass][(item.sort_key >> (pass * RADIX_BITS)) & (BUCKETS - 1)]++;
+      }
+    }
+
+    pScratch.resize(count);
+
+    for (uint32_t pass = 0; pass < PASSES; pass++) {
+      auto&          histogram = histograms[pass];
+      const uint32_t shift     = pass * RADIX_BITS;
+
+      if (histogram[(pItems[0].sort_key >> shift) & (BUCKETS - 1)] == count) {
+        continue;
+      }
+
+      uint32_t offset = 0;
+
+      for (uint32_t bucket = 0; bucket < BUCKETS; bucket++) {
+        uint32_t bucket_count = histogram[bucket];
+        histogram[bucket]     = offset;
+        offset += bucket_count;
+      }
+
+      for (const auto& item : pItems) {
+        pScratch[histogram[(item.sort_key >> shift) & (BUCKETS - 1)]++] = item;
+      }
+
+      pItems.swap(pScratch);
+    }
+  }
+
+  void DrawListBuilder::Resize(uint32_t count) {
+    pObjects.resize(count);
+    pTransforms.resize(count);
+    pKeys.resize(count);
+    pVisible.resize(count);
+    pOccluded.resize(count);
+    pWasUnhidden.resize(count, 1);
+    pHistoryIds.resize(count, NO_ID);
+  }
+
+  void DrawListBuilder::Build(JobSystem&             job_system,
+                              const glm::mat4&       projection,
+                              const glm::mat4&       view,
+                              DrawList&              draw_list,
+                              const JobCounter*      dependency,
+                              const OcclusionBuffer* occlusion) {
+    const glm::mat4 projection_view = projection * view;
+    const Frustum   frustum         = Frustum::FromMatrix(projection_view);
+    const bool      test_occlusion  = occlusion != nullptr && occlusion->IsValid();
+
+    JobCounter cull_counter;
+
+    job_system.ParallelFor(
+        0,
+        getSize(),
+        GRAIN,
+        [&](uint32_t begin, uint32_t end) {
+          for (uint32_t i = begin; i < end; i++) {
+            const Object& object = pObjects[i];
+            const AABB    bounds = object.local_bounds.Transform(object.world);
+
+            pVisible[i]  = object.local_bounds.IsValid() && frustum.Intersects(bounds);
+            pOccluded[i] = 0;
+
+            // Another object moved into this index, what the last test found belongs to the one that was here
+            if (pHistoryIds[i] != object.id) {
+              pHistoryIds[i]  = object.id;
+              pWasUnhidden[i] = 1;
+            }
+
+            if (!pVisible[i]) {
+              // Drawn untested when it comes back into view, the buffer was rendered without it
+              pWasUnhidden[i] = 1;
+            } else if (test_occlusion) {
+              bool hidden = occlusion->IsOccluded(bounds);
+
+              pOccluded[i]    = hidden && !pWasUnhidden[i];
+              pVisible[i]     = !pOccluded[i];
+              pWasUnhidden[i] = !hidden;
+            }
+
+            if (pVisible[i]) {
+              float view_depth = (view * object.world[3]).z;
+
+              pKeys[i]       = SortKey::Make(0, object.pipeline_id, 0, object.model_id, view_depth);
+              pTransforms[i] = projection_view * object.world;
+            }
+          }
+        },
+        cull_counter,
+        dependency);
+
+    job_system.Wait(cull_counter);
+
+    // Compaction is serial so that the draw list keeps object order before sorting, which keeps the result stable
+    draw_list.Clear();
+    draw_list.Reserve(getSize());
+
+    pOcclusionTested = 0;
+    pOcclusionCulled = 0;
+
+    for (uint32_t i = 0; i < getSize(); i++) {
+      if (pVisible[i]) {
+        draw_list.Add(pKeys[i], i, pObjects[i].model_id);
+      }
+
+      pOcclusionTested += test_occlusion && (pVisible[i] || pOccluded[i]) ? 1 : 0;
+      pOcclusionCulled += pOccluded[i];
+    }
+
+    draw_list.Sort();
+  }
+}
@@ -0,0 +1,152 @@
+#ifndef SVKE_DRAW_LIST_HPP
+#define SVKE_DRAW_LIST_HPP
+
+#include "bounds.hpp"
+#include "defines.hpp"
+#include "job_system.hpp"
+#include "model_handle.hpp"
+#include "occlusion_buffer.hpp"
+#include "pch_core.hpp"
+
+namespace svke {
+  // 64 bit sort key, from most to least significant bits:
+  // pass (4) | pipeline (10) | material (6) | model (20) | depth (24)
+  // Sorting by the key groups draws by the state that is most expensive to change and orders each group front to back.
+  // A model handle is keyed by its slot, which the mask keeps while dropping the generation, so that no two live models
+  // share a key and each model's draws stay together.
+  namespace SortKey {
+    constexpr uint32_t PASS_BITS     = 4;
+    constexpr uint32_t PIPELINE_BITS = 10;
+    constexpr uint32_t MATERIAL_BITS = 6;
+    constexpr uint32_t MODEL_BITS    = MODEL_SLOT_BITS;
+    constexpr uint32_t DEPTH_BITS    = 24;
+
+    constexpr uint32_t DEPTH_SHIFT    = 0;
+    constexpr uint32_t MODEL_SHIFT    = DEPTH_SHIFT + DEPTH_BITS;
+    constexpr uint32_t MATERIAL_SHIFT = MODEL_SHIFT + MODEL_BITS;
+    constexpr uint32_t PIPELINE_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+    constexpr uint32_t PASS_SHIFT     = PIPELINE_SHIFT + PIPELINE_BITS;
+
+    static_assert(PASS_SHIFT + PASS_BITS == 64, "Sort key fields must fill exactly 64 bits");
+
+    constexpr uint64_t Mask(uint32_t bits) { return (uint64_t {1} << bits) - 1; }
+
+    // Positive IEEE 754 floats compare like their bit patterns, so the top bits of the view depth are already an
+    // order preserving quantization. Anything behind the camera is clamped to zero.
+    inline uint64_t QuantizeDepth(float view_depth) {
+      if (!(view_depth > 0.0f)) {
+        return 0;
+      }
+
+      uint32_t bits;
+      memcpy(&bits, &view_depth, sizeof(bits));
+
+      return (bits >> (32 - DEPTH_BITS)) & Mask(DEPTH_BITS);
+    }
+
+    inline uint64_t Make(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t model, float view_depth) {
+      return ((pass & Mask(PASS_BITS)) << PASS_SHIFT) | ((pipeline & Mask(PIPELINE_BITS)) << PIPELINE_SHIFT) |
+             ((material & Mask(MATERIAL_BITS)) << MATERIAL_SHIFT) | ((model & Mask(MODEL_BITS)) << MODEL_SHIFT) |
+             (QuantizeDepth(view_depth) << DEPTH_SHIFT);
+    }
+
+    inline uint32_t getPass(uint64_t key) { return static_cast<uint32_t>((key >> PASS_SHIFT) & Mask(PASS_BITS)); }
+    inline uint32_t getPipeline(uint64_t key) {
+      return static_cast<uint32_t>((key >> PIPELINE_SHIFT) & Mask(PIPELINE_BITS));
+    }
+    inline uint32_t getMaterial(uint64_t key) {
+      return static_cast<uint32_t>((key >> MATERIAL_SHIFT) & Mask(MATERIAL_BITS));
+    }
+    inline uint32_t getModel(uint64_t key) { return static_cast<uint32_t>((key >> MODEL_SHIFT) & Mask(MODEL_BITS)); }
+  }
+
+  // Fills the padding after the key, so carrying the model costs nothing and recording needs no object lookups
+  struct DrawItem {
+    uint64_t sort_key;
+    uint32_t object_index;
+    uint32_t model_id;
+  };
+
+  static_assert(sizeof(DrawItem) == 16, "Draw items must stay two words");
+
+  class DrawList {
+   public:
+    void Clear() { pItems.clear(); }
+    void Reserve(uint64_t count) { pItems.reserve(count); }
+    void Add(uint64_t sort_key, uint32_t object_index, uint32_t model_id) {
+      pItems.push_back({sort_key, object_index, model_id});
+    }
+    void Sort();
+
+    const std::vector<DrawItem>& getItems() const { return pItems; }
+    uint64_t                     getSize() const { return pItems.size(); }
+
+   private:
+    std::vector<DrawItem> pItems;
+    std::vector<DrawItem> pScratch;
+  };
+
+  // Culls objects against the view frustum and builds their sort keys and final transforms on a job system. Objects
+  // are written with SetObject, which may be called concurrently for different indices, then Build fills a sorted
+  // DrawList with the visible ones. Objects with empty bounds are never drawn. Each object also passes a stable id,
+  // such as its pool handle, since indices may be handed to other objects between frames.
+  //
+  // With an occlusion buffer, every object in the frustum is tested once against it. The buffer is as old as the
+  // frame it was read back from, so an object is only culled after being found hidden twice in a row, which hides most
+  // false positives. Nothing is re-tested against newer depth, an object that becomes disoccluded can appear as many
+  // frames late as the buffer is old. That history is kept per index, an index that holds a different id than last
+  // time starts over as never tested.
+  class DrawListBuilder {
+   public:
+    static constexpr uint32_t GRAIN = 1024;
+
+   public:
+    void Resize(uint32_t count);
+    void SetObject(uint32_t         index,
+                   const glm::mat4& world,
+                   const AABB&      local_bounds,
+                   uint32_t         pipeline_id,
+                   uint32_t         model_id,
+                   uint32_t         id) {
+      pObjects[index] = {world, local_bounds, pipeline_id, model_id, id};
+    }
+
+    void Build(JobSystem&             job_system,
+               const glm::mat4&       projection,
+               const glm::mat4&       view,
+               DrawList&              draw_list,
+               const JobCounter*      dependency = nullptr,
+               const OcclusionBuffer* occlusion  = nullptr);
+
+    // Projection * view * world of an object, only valid for objects in the last built draw list
+    const glm::mat4& getTransform(uint32_t index) const { return pTransforms[index]; }
+    uint32_t         getSize() const { return static_cast<uint32_t>(pObjects.size()); }
+
+    // Objects in the view frustum tested against the occlusion buffer by the last Build, and those it culled
+    uint32_t getOcclusionTested() const { return pOcclusionTested; }
+    uint32_t getOcclusionCulled() const { return pOcclusionCulled; }
+
+   private:
+    struct Object {
+      glm::mat4 world;
+      AABB      local_bounds;
+      uint32_t  pipeline_id;
+      uint32_t  model_id;
+      uint32_t  id;
+    };
+
+    static constexpr uint32_t NO_ID = std::numeric_limits<uint32_t>::max();
+
+    std::vector<Object>    pObjects;
+    std::vector<glm::mat4> pTransforms;
+    std::vector<uint64_t>  pKeys;
+    std::vector<uint8_t>   pVisible;
+    std::vector<uint8_t>   pOccluded;     // Culled by the occlusion test in the last Build
+    std::vector<uint8_t>   pWasUnhidden;  // Passed the occlusion test last time, or was never tested
+    std::vector<uint32_t>  pHistoryIds;   // Object whose test result pWasUnhidden holds
+    uint32_t               pOcclusionTested {0};
+    uint32_t               pOcclusionCulled {0};
+  };
+}
+
+#endif
@@ -2,10 +2,14 @@
 #define SVKE_GAME_OBJECT_HPP
 
 #include "defines.hpp"
-#include "model.hpp"
-#include "pch.hpp"
+#include "model_handle.hpp"
+#include "pch_core.hpp"
 
 namespace svke {
+  // Handle of a node in a SceneGraph
+  using SceneNode                   = uint32_t;
+  constexpr SceneNode NO_SCENE_NODE = std::numeric_limits<uint32_t>::max();
+
   struct TransformComponent {
     glm::vec3 translation {};
     glm::vec3 scale {};
@@ -42,17 +46,27 @@ namespace svke {
               },
               {translation.x, translation.y, translation.z, 1.0f}};
     }
+
+    // Blend between two simulation states, rotations take the shortest way around the circle
+    static TransformComponent Interpolate(const TransformComponent &from, const TransformComponent &to, float alpha) {
+      const glm::vec3 rotation_delta =
+          glm::mod(to.rotation - from.rotation + glm::pi<float>(), glm::two_pi<float>()) - glm::pi<float>();
+
+      TransformComponent result {};
+
+      result.translation = glm::mix(from.translation, to.translation, alpha);
+      result.scale       = glm::mix(from.scale, to.scale, alpha);
+      result.rotation    = from.rotation + rotation_delta * alpha;
+
+      return result;
+    }
   };
 
+  // Created and owned by a GameObjectPool, whose handle for it is its id
   class GameObject {
    public:
     using id_t = uint32_t;
 
-    static GameObject CreateGameObject() {
-      static id_t current_id = 0;
-      return GameObject {current_id++};
-    }
-
    public:
     id_t getId() const { return pId; }
 
@@ -63,10 +77,14 @@ namespace svke {
     GameObject &operator=(GameObject &&) = default;
 
    public:
-    std::shared_ptr<Model> ObjectModel {};
-    TransformComponent     Transform {};
+    ModelHandle        ObjectModel {NO_MODEL_HANDLE};  // Not drawn without a valid model
+    TransformComponent Transform {};
+    TransformComponent PreviousTransform {};  // State before the last fixed update, used for interpolation
+    SceneNode          Node {NO_SCENE_NODE};  // Makes Transform relative to the parent of this scene node
 
    private:
+    friend class GameObjectPool;
+
     GameObject(id_t id) : pId {id} {};
 
     id_t pId {};
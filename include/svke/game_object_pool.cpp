@@ -0,0 +1,60 @@
+#include "game_object_pool.hpp"
+
+#include "defines.hpp"
+#include "pch_core.hpp"
+
+namespace svke {
+  GameObject& GameObjectPool::Create() {
+    const uint32_t slot = pHandles.Allocate();
+
+    if (slot == Handles::NO_SLOT) {
+      throw std::runtime_error("Game object pool is full");
+    }
+
+    if (slot == pSlots.size()) {
+      pSlots.push_back(NO_INDEX);
+    }
+
+    pSlots[slot] = static_cast<uint32_t>(pObjects.size());
+    pObjects.push_back(GameObject {pHandles.getHandle(slot)});
+
+    return pObjects.back();
+  }
+
+  void GameObjectPool::Destroy(handle_t handle) {
+    assert(IsValid(handle) && "Cannot destroy a game object twice");
+
+    const uint32_t slot  = Handles::getSlot(handle);
+    const uint32_t index = pSlots[slot];
+
+    if (index != pObjects.size() - 1) {
+      pObjects[index]                                   = std::move(pObjects.back());
+      pSlots[Handles::getSlot(pObjects[index].getId())] = index;
+    }
+
+    pObjects.pop_back();
+    pSlots[slot] = NO_INDEX;
+
+    pHandles.Release(slot);
+    pHandles.Free(slot);
+  }
+
+  void GameObjectPool::Reserve(uint32_t count) {
+    pObjects.reserve(count);
+    pSlots.reserve(count);
+    pHandles.Reserve(count);
+  }
+
+  void GameObjectPool::Clear() {
+    for (const auto& object : pObjects) {
+      const uint32_t slot = Handles::getSlot(object.getId());
+
+      pSlots[slot] = NO_INDEX;
+
+      pHandles.Release(slot);
+      pHandles.Free(slot);
+    }
+
+    pObjects.clear();
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef SVKE_GAME_OBJECT_POOL_HPP
+#define SVKE_GAME_OBJECT_POOL_HPP
+
+#include "defines.hpp"
+#include "game_object.hpp"
+#include "handle_allocator.hpp"
+#include "pch_core.hpp"
+
+namespace svke {
+  // Owns the game objects, packed in a dense array in no particular order so that per frame systems iterate only live
+  // objects. Objects are referred to by handles from a HandleAllocator. Destroying moves the last object into the hole
+  // and frees the handle's slot right away, so both creating and destroying take constant time.
+  //
+  // Dense indices, as used by operator[] and iteration, change whenever an object is destroyed. Handles never do.
+  class GameObjectPool {
+   public:
+    using handle_t = GameObject::id_t;
+
+    using Handles = HandleAllocator<22, 1024>;
+
+    static constexpr uint32_t MAX_OBJECTS = Handles::MAX_SLOTS;
+
+   public:
+    GameObjectPool() = default;
+
+    GameObjectPool(const GameObjectPool& other) = delete;
+    GameObjectPool& operator=(const GameObjectPool& other) = delete;
+
+   public:
+    // The new object is the last one in dense order until something is destroyed
+    GameObject& Create();
+
+    // Leaves the object's scene node, if any, to the caller
+    void Destroy(handle_t handle);
+
+    void Reserve(uint32_t count);
+    void Clear();
+
+    bool IsValid(handle_t handle) const { return pHandles.IsValid(handle); }
+
+    GameObject&       Get(handle_t handle) { return pObjects[pSlots[Handles::getSlot(handle)]]; }
+    const GameObject& Get(handle_t handle) const { return pObjects[pSlots[Handles::getSlot(handle)]]; }
+
+    // Dense access, only valid until the next Destroy
+    GameObject&       operator[](uint32_t index) { return pObjects[index]; }
+    const GameObject& operator[](uint32_t index) const { return pObjects[index]; }
+    uint32_t          getSize() const { return static_cast<uint32_t>(pObjects.size()); }
+    bool              IsEmpty() const { return pObjects.empty(); }
+
+    std::vector<GameObject>::iterator       begin() { return pObjects.begin(); }
+    std::vector<GameObject>::iterator       end() { return pObjects.end(); }
+    std::vector<GameObject>::const_iterator begin() const { return pObjects.begin(); }
+    std::vector<GameObject>::const_iterator end() const { return pObjects.end(); }
+
+   private:
+    static constexpr uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
+
+   private:
+    // Indexed by dense position, each object knows its own handle through getId
+    std::vector<GameObject> pObjects;
+
+    Handles               pHandles;
+    std::vector<uint32_t> pSlots;  // Indexed by slot, dense position of the slot's object, NO_INDEX when free
+  };
+}
+
+#endif
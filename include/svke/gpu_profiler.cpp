@@ -0,0 +1,195 @@
+#include "gpu_profiler.hpp"
+
+#include "defines.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  // Results come back in bit order: assembled primitives, vertex invocations, clipped primitives, fragment invocations
+  static constexpr VkQueryPipelineStatisticFlags PIPELINE_STATISTICS =
+      VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+  static constexpr uint32_t PIPELINE_STATISTICS_COUNT = 4;
+
+  GpuProfiler::GpuProfiler(Device& device, uint32_t frames_in_flight)
+      : pDevice {device},
+        pTimestampsSupported {device.getTimestampValidBits() > 0},
+        pStatisticsSupported {device.SupportsPipelineStatistics()},
+        pTimestampPeriod {device.properties.limits.timestampPeriod},
+        pTimestampMask {device.getTimestampValidBits() >= 64 ? std::numeric_limits<uint64_t>::max()
+                                                             : (uint64_t {1} << device.getTimestampValidBits()) - 1} {
+    pCreateFrames(frames_in_flight);
+  }
+
+  GpuProfiler::~GpuProfiler() { pDestroyFrames(); }
+
+  void GpuProfiler::Resize(uint32_t frames_in_flight) {
+    pDestroyFrames();
+    pCreateFrames(frames_in_flight);
+  }
+
+  void GpuProfiler::BeginFrame(VkCommandBuffer command_buffer, uint32_t frame) {
+    assert(pActiveStatistics == 0 && "A GPU scope was left open in the previous frame");
+
+    pCurrentFrame = frame;
+    Frame& slot   = pFrames[frame];
+
+    pReadBack(slot);
+    slot.scopes.clear();
+
+    if (slot.timestamps != VK_NULL_HANDLE) {
+      vkCmdResetQueryPool(command_buffer, slot.timestamps, 0, MAX_SCOPES * 2);
+    }
+
+    if (slot.statistics != VK_NULL_HANDLE) {
+      vkCmdResetQueryPool(command_buffer, slot.statistics, 0, MAX_SCOPES);
+    }
+  }
+
+  uint32_t GpuProfiler::BeginScope(VkCommandBuffer command_buffer, const char* name, bool pipeline_statistics) {
+    Frame& slot = pFrames[pCurrentFrame];
+
+    if (!IsSupported() || slot.scopes.size() >= MAX_SCOPES) {
+      return NO_SCOPE;
+    }
+
+    uint32_t scope      = static_cast<uint32_t>(slot.scopes.size());
+    bool     statistics = pipeline_statistics && pStatisticsSupported && pActiveStatistics == 0;
+
+    slot.scopes.push_back({name, statistics});
+
+    if (pTimestampsSupported) {
+      vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, slot.timestamps, scope * 2);
+    }
+
+    if (statistics) {
+      vkCmdBeginQuery(command_buffer, slot.statistics, scope, 0);
+      pActiveStatistics++;
+    }
+
+    return scope;
+  }
+
+  void GpuProfiler::EndScope(VkCommandBuffer command_buffer, uint32_t scope) {
+    if (scope == NO_SCOPE) {
+      return;
+    }
+
+    Frame& slot = pFrames[pCurrentFrame];
+
+    if (slot.scopes[scope].statistics) {
+      vkCmdEndQuery(command_buffer, slot.statistics, scope);
+      pActiveStatistics--;
+    }
+
+    if (pTimestampsSupported) {
+      vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, slot.timestamps, scope * 2 + 1);
+    }
+  }
+
+  void GpuProfiler::pCreateFrames(uint32_t frames_in_flight) {
+    pFrames.resize(frames_in_flight);
+    pCurrentFrame     = 0;
+    pActiveStatistics = 0;
+
+    for (auto& frame : pFrames) {
+      VkQueryPoolCreateInfo pool_info {};
+      pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+
+      if (pTimestampsSupported) {
+        pool_info.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+        pool_info.queryCount = MAX_SCOPES * 2;
+
+        if (vkCreateQueryPool(pDevice.getDevice(), &pool_info, nullptr, &frame.timestamps) != VK_SUCCESS) {
+          throw std::runtime_error("Failed to create timestamp query pool");
+        }
+      }
+
+      if (pStatisticsSupported) {
+        pool_info.queryType          = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        pool_info.queryCount         = MAX_SCOPES;
+        pool_info.pipelineStatistics = PIPELINE_STATISTICS;
+
+        if (vkCreateQueryPool(pDevice.getDevice(), &pool_info, nullptr, &frame.statistics) != VK_SUCCESS) {
+          throw std::runtime_error("Failed to create pipeline statistics query pool");
+        }
+      }
+    }
+  }
+
+  void GpuProfiler::pDestroyFrames() {
+    for (auto& frame : pFrames) {
+      // Frames in flight may still write to the pools
+      pDevice.DeferDestroy(
+          [device = pDevice.getDevice(), timestamps = frame.timestamps, statistics = frame.statistics]() {
+            if (timestamps != VK_NULL_HANDLE) {
+              vkDestroyQueryPool(device, timestamps, nullptr);
+            }
+
+            if (statistics != VK_NULL_HANDLE) {
+              vkDestroyQueryPool(device, statistics, nullptr);
+            }
+          });
+    }
+
+    pFrames.clear();
+  }
+
+  void GpuProfiler::pReadBack(Frame& frame) {
+    if (frame.scopes.empty()) {
+      return;
+    }
+
+    std::vector<GpuScopeResult> results(frame.scopes.size());
+    std::vector<uint64_t>       timestamps(frame.scopes.size() * 2);
+
+    // Never waits, a frame whose results are somehow not ready yet is skipped and the previous results stay
+    if (pTimestampsSupported && vkGetQueryPoolResults(pDevice.getDevice(),
+                                                      frame.timestamps,
+                                                      0,
+                                                      static_cast<uint32_t>(timestamps.size()),
+                                                      timestamps.size() * sizeof(uint64_t),
+                                                      timestamps.data(),
+                                                      sizeof(uint64_t),
+                                                      VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+      return;
+    }
+
+    for (size_t scope = 0; scope < frame.scopes.size(); scope++) {
+      GpuScopeResult& result = results[scope];
+      result.name            = frame.scopes[scope].name;
+
+      if (pTimestampsSupported) {
+        uint64_t ticks = ((timestamps[scope * 2 + 1] - timestamps[scope * 2]) & pTimestampMask);
+
+        result.gpu_ms         = static_cast<double>(ticks) * pTimestampPeriod / 1e6;
+        result.has_timestamps = true;
+      }
+
+      if (!frame.scopes[scope].statistics) {
+        continue;
+      }
+
+      uint64_t statistics[PIPELINE_STATISTICS_COUNT];
+
+      if (vkGetQueryPoolResults(pDevice.getDevice(),
+                                frame.statistics,
+                                static_cast<uint32_t>(scope),
+                                1,
+                                sizeof(statistics),
+                                statistics,
+                                sizeof(statistics),
+                                VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+        return;
+      }
+
+      result.primitives              = statistics[0];
+      result.vertex_invocations      = statistics[1];
+      result.clipped_primitives      = statistics[2];
+      result.fragment_invocations    = statistics[3];
+      result.has_pipeline_statistics = true;
+    }
+
+    pResults = std::move(results);
+  }
+}
@@ -0,0 +1,99 @@
+#ifndef SVKE_GPU_PROFILER_HPP
+#define SVKE_GPU_PROFILER_HPP
+
+#include "defines.hpp"
+#include "device.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  struct GpuScopeResult {
+    const char* name;
+    double      gpu_ms                  = 0.0;
+    uint64_t    vertex_invocations      = 0;
+    uint64_t    primitives              = 0;  // Assembled from the input
+    uint64_t    clipped_primitives      = 0;  // Left after clipping, passed on to rasterization
+    uint64_t    fragment_invocations    = 0;
+    bool        has_timestamps          = false;
+    bool        has_pipeline_statistics = false;
+  };
+
+  // Named GPU scopes measured with timestamp and pipeline statistics queries. Every frame in flight has its own query
+  // pools, read back without waiting when the frame slot comes around again, by which point the GPU has finished it.
+  // Pipeline statistics queries of one pool cannot nest, a scope inside another one with statistics only gets
+  // timestamps.
+  class GpuProfiler {
+   public:
+    static constexpr uint32_t MAX_SCOPES = 64;
+    static constexpr uint32_t NO_SCOPE   = std::numeric_limits<uint32_t>::max();
+
+   public:
+    GpuProfiler(Device& device, uint32_t frames_in_flight);
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler& other) = delete;
+    GpuProfiler& operator=(const GpuProfiler& other) = delete;
+
+   public:
+    // Drops whatever has not been read back yet, the GPU has to be done with every frame
+    void Resize(uint32_t frames_in_flight);
+
+    // Reads back the results the frame slot holds and resets its queries, outside of any render pass
+    void BeginFrame(VkCommandBuffer command_buffer, uint32_t frame);
+
+    uint32_t BeginScope(VkCommandBuffer command_buffer, const char* name, bool pipeline_statistics = true);
+    void     EndScope(VkCommandBuffer command_buffer, uint32_t scope);
+
+    bool IsSupported() const { return pTimestampsSupported || pStatisticsSupported; }
+
+    // Scopes of the most recent frame that has been read back, in the order they began
+    const std::vector<GpuScopeResult>& getResults() const { return pResults; }
+
+   private:
+    struct Scope {
+      const char* name;
+      bool        statistics;
+    };
+
+    struct Frame {
+      VkQueryPool        timestamps {VK_NULL_HANDLE};
+      VkQueryPool        statistics {VK_NULL_HANDLE};
+      std::vector<Scope> scopes;
+    };
+
+    void pCreateFrames(uint32_t frames_in_flight);
+    void pDestroyFrames();
+    void pReadBack(Frame& frame);
+
+   private:
+    Device&            pDevice;
+    std::vector<Frame> pFrames;
+    uint32_t           pCurrentFrame {0};
+    uint32_t           pActiveStatistics {0};
+
+    bool     pTimestampsSupported;
+    bool     pStatisticsSupported;
+    double   pTimestampPeriod;
+    uint64_t pTimestampMask;
+
+    std::vector<GpuScopeResult> pResults;
+  };
+
+  class GpuScope {
+   public:
+    GpuScope(GpuProfiler& profiler, VkCommandBuffer command_buffer, const char* name, bool pipeline_statistics = true)
+        : pProfiler {profiler},
+          pCommandBuffer {command_buffer},
+          pScope {profiler.BeginScope(command_buffer, name, pipeline_statistics)} {}
+    ~GpuScope() { pProfiler.EndScope(pCommandBuffer, pScope); }
+
+    GpuScope(const GpuScope& other) = delete;
+    GpuScope& operator=(const GpuScope& other) = delete;
+
+   private:
+    GpuProfiler&    pProfiler;
+    VkCommandBuffer pCommandBuffer;
+    uint32_t        pScope;
+  };
+}
+
+#endif
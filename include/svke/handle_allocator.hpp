@@ -0,0 +1,101 @@
+#ifndef SVKE_HANDLE_ALLOCATOR_HPP
+#define SVKE_HANDLE_ALLOCATOR_HPP
+
+#include "defines.hpp"
+#include "pch_core.hpp"
+
+namespace svke {
+  // Hands out 32 bit generational handles, a slot in the low INDEX_BITS and the slot's generation in the high ones, for
+  // containers that keep their own arrays indexed by slot. Releasing a handle bumps its slot's generation, so a stale
+  // handle is recognized instead of reaching whatever takes the slot next. A slot whose generation runs out is retired
+  // rather than risk a stale handle matching again.
+  //
+  // Freed slots queue up first in first out and are only reused once more than MIN_FREE_SLOTS wait, so that churn
+  // spreads over many slots instead of using up the generations of one. A full allocator still reuses whatever is free.
+  //
+  // Releasing and freeing are separate so that a slot can stay unusable for a while after its handle went stale, for
+  // example until the GPU is done with what it held. Allocating, releasing and freeing belong to one thread, IsValid
+  // may be called from any thread while none of those run.
+  template <uint32_t INDEX_BITS_, uint32_t MIN_FREE_SLOTS_>
+  class HandleAllocator {
+   public:
+    static constexpr uint32_t INDEX_BITS      = INDEX_BITS_;
+    static constexpr uint32_t GENERATION_BITS = 32 - INDEX_BITS;
+    static constexpr uint32_t MAX_SLOTS       = 1u << INDEX_BITS;
+    static constexpr uint32_t INDEX_MASK      = MAX_SLOTS - 1;
+    static constexpr uint32_t MIN_FREE_SLOTS  = MIN_FREE_SLOTS_;
+    static constexpr uint32_t NO_SLOT         = std::numeric_limits<uint32_t>::max();
+
+   public:
+    HandleAllocator() = default;
+
+    HandleAllocator(const HandleAllocator& other) = delete;
+    HandleAllocator& operator=(const HandleAllocator& other) = delete;
+
+   public:
+    // A free slot when one is due for reuse, otherwise a new one at getSlotCount() - 1. NO_SLOT when full.
+    uint32_t Allocate() {
+      uint32_t slot;
+
+      if (pFreeSlots.size() > MIN_FREE_SLOTS || (!pFreeSlots.empty() && pGenerations.size() >= MAX_SLOTS)) {
+        slot = pFreeSlots.front();
+        pFreeSlots.pop_front();
+      } else {
+        if (pGenerations.size() >= MAX_SLOTS) {
+          return NO_SLOT;
+        }
+
+        slot = static_cast<uint32_t>(pGenerations.size());
+        pGenerations.push_back(0);
+        pLive.push_back(0);
+      }
+
+      pLive[slot] = 1;
+
+      return slot;
+    }
+
+    // Makes every handle of the slot stale, the slot is not reused before it is freed
+    void Release(uint32_t slot) {
+      assert(pLive[slot] && "Cannot release a slot twice");
+
+      pLive[slot] = 0;
+      pGenerations[slot]++;
+    }
+
+    void Free(uint32_t slot) {
+      assert(!pLive[slot] && "Cannot free a slot that is still in use");
+
+      if (pGenerations[slot] < MAX_GENERATION) {
+        pFreeSlots.push_back(slot);
+      }
+    }
+
+    void Reserve(uint32_t count) {
+      pGenerations.reserve(count);
+      pLive.reserve(count);
+    }
+
+    bool IsValid(uint32_t handle) const {
+      const uint32_t slot = getSlot(handle);
+      return slot < pGenerations.size() && pGenerations[slot] == handle >> INDEX_BITS && pLive[slot];
+    }
+
+    uint32_t getHandle(uint32_t slot) const { return static_cast<uint32_t>(pGenerations[slot]) << INDEX_BITS | slot; }
+    uint32_t getSlotCount() const { return static_cast<uint32_t>(pGenerations.size()); }
+
+    static uint32_t getSlot(uint32_t handle) { return handle & INDEX_MASK; }
+
+   private:
+    static_assert(INDEX_BITS > 0 && GENERATION_BITS > 0 && GENERATION_BITS <= 16, "Generations are stored in 16 bits");
+
+    static constexpr uint32_t MAX_GENERATION = (1u << GENERATION_BITS) - 1;
+
+   private:
+    std::vector<uint16_t> pGenerations;
+    std::vector<uint8_t>  pLive;
+    std::deque<uint32_t>  pFreeSlots;
+  };
+}
+
+#endif
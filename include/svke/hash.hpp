@@ -0,0 +1,35 @@
+#ifndef SVKE_HASH_HPP
+#define SVKE_HASH_HPP
+
+#include "defines.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+  constexpr uint64_t FNV_PRIME        = 1099511628211ull;
+
+  // 64 bit FNV-1a, seed can be used to chain several buffers into the same hash
+  inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = FNV_OFFSET_BASIS) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t       hash  = seed;
+
+    for (size_t i = 0; i < size; i++) {
+      hash ^= bytes[i];
+      hash *= FNV_PRIME;
+    }
+
+    return hash;
+  }
+
+  template <typename T>
+  inline uint64_t HashValue(const T& value, uint64_t seed = FNV_OFFSET_BASIS) {
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be hashed bytewise");
+    return HashBytes(&value, sizeof(T), seed);
+  }
+
+  inline uint64_t HashString(const std::string& value, uint64_t seed = FNV_OFFSET_BASIS) {
+    return HashBytes(value.data(), value.size(), seed);
+  }
+}
+
+#endif
@@ -0,0 +1,472 @@
+#include "hi_z_pyramid.hpp"
+
+#include "defines.hpp"
+#include "pch.hpp"
+#include "pipeline.hpp"
+#include "profiler.hpp"
+
+namespace svke {
+  HiZPyramid::HiZPyramid(Device& device, uint32_t frames_in_flight) : pDevice {device} {
+    pFrames.resize(frames_in_flight);
+    pCreatePipeline();
+  }
+
+  HiZPyramid::~HiZPyramid() {
+    pDestroyResources();
+
+    vkDestroyPipeline(pDevice.getDevice(), pPipeline, nullptr);
+    vkDestroyPipelineLayout(pDevice.getDevice(), pPipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(pDevice.getDevice(), pSetLayout, nullptr);
+    vkDestroySampler(pDevice.getDevice(), pSampler, nullptr);
+  }
+
+  void HiZPyramid::Resize(SwapChain& swap_chain, uint32_t frames_in_flight) {
+    pDestroyResources();
+    pCreateResources(swap_chain, frames_in_flight);
+  }
+
+  void HiZPyramid::BeginFrame(uint32_t frame) {
+    pCurrentFrame = frame;
+    Frame& slot   = pFrames[frame];
+
+    if (slot.pending) {
+      pOcclusionBuffer.Set(pReadbackLevels, slot.depths, pReadbackCount, slot.projection_view);
+      slot.pending = false;
+    }
+  }
+
+  void HiZPyramid::SetEnabled(bool enabled) {
+    pEnabled = enabled;
+
+    if (!enabled) {
+      pOcclusionBuffer.Clear();
+
+      for (auto& frame : pFrames) {
+        frame.pending = false;
+      }
+    }
+  }
+
+  void HiZPyramid::Record(VkCommandBuffer command_buffer, uint32_t image_index) {
+    if (!pEnabled || pImage == VK_NULL_HANDLE) {
+      return;
+    }
+
+    SVKE_PROFILE_SCOPE("HiZPyramid::Record");
+
+    const uint32_t level_count = getLevelCount();
+
+    // Every level gets overwritten, so the previous contents, last read by the copy of an earlier frame, can go
+    VkImageMemoryBarrier barrier {};
+
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask                   = 0;
+    barrier.dstAccessMask                   = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout                       = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                           = pImage;
+    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel   = 0;
+    barrier.subresourceRange.levelCount     = level_count;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = 1;
+
+    vkCmdPipelineBarrier(command_buffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr,
+                         1,
+                         &barrier);
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pPipeline);
+
+    VkExtent2D source_size = pDepthExtent;
+
+    for (uint32_t level = 0; level < level_count; level++) {
+      VkDescriptorSet set  = level == 0 ? pDepthSets[image_index] : pLevelSets[level];
+      VkExtent2D      size = pLevelSizes[level];
+
+      PushData push {};
+
+      push.source_size[0]      = static_cast<int32_t>(source_size.width);
+      push.source_size[1]      = static_cast<int32_t>(source_size.height);
+      push.destination_size[0] = static_cast<int32_t>(size.width);
+      push.destination_size[1] = static_cast<int32_t>(size.height);
+
+      vkCmdBindDescriptorSets(
+          command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pPipelineLayout, 0, 1, &set, 0, nullptr);
+      vkCmdPushConstants(
+          command_buffer, pPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushData), &push);
+      vkCmdDispatch(
+          command_buffer, (size.width + GROUP_SIZE - 1) / GROUP_SIZE, (size.height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+
+      // The next level reads this one, the read back levels are also copied out
+      barrier.srcAccessMask                 = VK_ACCESS_SHADER_WRITE_BIT;
+      barrier.dstAccessMask                 = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+      barrier.oldLayout                     = VK_IMAGE_LAYOUT_GENERAL;
+      barrier.subresourceRange.baseMipLevel = level;
+      barrier.subresourceRange.levelCount   = 1;
+
+      vkCmdPipelineBarrier(command_buffer,
+                           VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           0,
+                           0,
+                           nullptr,
+                           0,
+                           nullptr,
+                           1,
+                           &barrier);
+
+      source_size = size;
+    }
+
+    Frame& slot = pFrames[pCurrentFrame];
+
+    std::vector<VkBufferImageCopy> regions;
+
+    for (uint32_t level = pReadbackLevel; level < level_count; level++) {
+      VkBufferImageCopy region {};
+
+      region.bufferOffset                    = pReadbackLevels[level - pReadbackLevel].offset * sizeof(float);
+      region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+      region.imageSubresource.mipLevel       = level;
+      region.imageSubresource.baseArrayLayer = 0;
+      region.imageSubresource.layerCount     = 1;
+      region.imageExtent                     = {pLevelSizes[level].width, pLevelSizes[level].height, 1};
+
+      regions.push_back(region);
+    }
+
+    vkCmdCopyImageToBuffer(command_buffer,
+                           pImage,
+                           VK_IMAGE_LAYOUT_GENERAL,
+                           slot.buffer,
+                           static_cast<uint32_t>(regions.size()),
+                           regions.data());
+
+    VkBufferMemoryBarrier buffer_barrier {};
+
+    buffer_barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    buffer_barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    buffer_barrier.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+    buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.buffer              = slot.buffer;
+    buffer_barrier.offset              = 0;
+    buffer_barrier.size                = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(command_buffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_HOST_BIT,
+                         0,
+                         0,
+                         nullptr,
+                         1,
+                         &buffer_barrier,
+                         0,
+                         nullptr);
+
+    slot.projection_view = pProjectionView;
+    slot.pending         = true;
+  }
+
+  void HiZPyramid::pCreatePipeline() {
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings {};
+
+    bindings[0].binding         = 0;
+    bindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    bindings[1].binding         = 1;
+    bindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo set_layout_info {};
+
+    set_layout_info.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    set_layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+    set_layout_info.pBindings    = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(pDevice.getDevice(), &set_layout_info, nullptr, &pSetLayout) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create Hi-Z descriptor set layout");
+    }
+
+    VkPushConstantRange push_constant_range {};
+
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset     = 0;
+    push_constant_range.size       = sizeof(PushData);
+
+    VkPipelineLayoutCreateInfo layout_info {};
+
+    layout_info.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layout_info.setLayoutCount         = 1;
+    layout_info.pSetLayouts            = &pSetLayout;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges    = &push_constant_range;
+
+    if (vkCreatePipelineLayout(pDevice.getDevice(), &layout_info, nullptr, &pPipelineLayout) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create Hi-Z pipeline layout");
+    }
+
+    auto code = Pipeline::ReadFile("shaders/hi_z.comp.spv");
+
+    VkShaderModuleCreateInfo module_info {};
+
+    module_info.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    module_info.codeSize = code.size();
+    module_info.pCode    = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule shader_module;
+
+    if (vkCreateShaderModule(pDevice.getDevice(), &module_info, nullptr, &shader_module) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create shader module");
+    }
+
+    VkComputePipelineCreateInfo pipeline_info {};
+
+    pipeline_info.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = shader_module;
+    pipeline_info.stage.pName  = "main";
+    pipeline_info.layout       = pPipelineLayout;
+
+    VkResult result =
+        vkCreateComputePipelines(pDevice.getDevice(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pPipeline);
+
+    vkDestroyShaderModule(pDevice.getDevice(), shader_module, nullptr);
+
+    if (result != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create Hi-Z pipeline");
+    }
+
+    // Texels are fetched directly, the sampler is only there because the descriptor needs one
+    VkSamplerCreateInfo sampler_info {};
+
+    sampler_info.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.magFilter    = VK_FILTER_NEAREST;
+    sampler_info.minFilter    = VK_FILTER_NEAREST;
+    sampler_info.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+    if (vkCreateSampler(pDevice.getDevice(), &sampler_info, nullptr, &pSampler) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create sampler");
+    }
+  }
+
+  void HiZPyramid::pCreateResources(SwapChain& swap_chain, uint32_t frames_in_flight) {
+    pDepthExtent = swap_chain.getSwapChainExtent();
+
+    VkExtent2D size {std::max(pDepthExtent.width / 2, 1u), std::max(pDepthExtent.height / 2, 1u)};
+
+    pLevelSizes.clear();
+
+    while (true) {
+      pLevelSizes.push_back(size);
+
+      if (size.width == 1 && size.height == 1) {
+        break;
+      }
+
+      size = {std::max(size.width / 2, 1u), std::max(size.height / 2, 1u)};
+    }
+
+    const uint32_t level_count = getLevelCount();
+
+    VkImageCreateInfo image_info {};
+
+    image_info.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType     = VK_IMAGE_TYPE_2D;
+    image_info.extent.width  = pLevelSizes[0].width;
+    image_info.extent.height = pLevelSizes[0].height;
+    image_info.extent.depth  = 1;
+    image_info.mipLevels     = level_count;
+    image_info.arrayLayers   = 1;
+    image_info.format        = VK_FORMAT_R32_SFLOAT;
+    image_info.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    image_info.samples     = VK_SAMPLE_COUNT_1_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    pDevice.CreateImageWithInfo(
+        image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pImage, pImageMemory, MemoryCategory::Depth);
+
+    pLevelViews.resize(level_count);
+
+    for (uint32_t level = 0; level < level_count; level++) {
+      VkImageViewCreateInfo view_info {};
+
+      view_info.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+      view_info.image                           = pImage;
+      view_info.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+      view_info.format                          = VK_FORMAT_R32_SFLOAT;
+      view_info.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+      view_info.subresourceRange.baseMipLevel   = level;
+      view_info.subresourceRange.levelCount     = 1;
+      view_info.subresourceRange.baseArrayLayer = 0;
+      view_info.subresourceRange.layerCount     = 1;
+
+      if (vkCreateImageView(pDevice.getDevice(), &view_info, nullptr, &pLevelViews[level]) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Hi-Z level view");
+      }
+    }
+
+    // One set per swap chain image for the first level, one per level for the rest
+    const uint32_t image_count = static_cast<uint32_t>(swap_chain.getImageCount());
+    const uint32_t set_count   = image_count + level_count;
+
+    std::array<VkDescriptorPoolSize, 2> pool_sizes {};
+
+    pool_sizes[0].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pool_sizes[0].descriptorCount = set_count;
+    pool_sizes[1].type            = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    pool_sizes[1].descriptorCount = set_count;
+
+    VkDescriptorPoolCreateInfo pool_info {};
+
+    pool_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.maxSets       = set_count;
+    pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+    pool_info.pPoolSizes    = pool_sizes.data();
+
+    if (vkCreateDescriptorPool(pDevice.getDevice(), &pool_info, nullptr, &pDescriptorPool) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create Hi-Z descriptor pool");
+    }
+
+    std::vector<VkDescriptorSetLayout> set_layouts(set_count, pSetLayout);
+    std::vector<VkDescriptorSet>       sets(set_count);
+
+    VkDescriptorSetAllocateInfo alloc_info {};
+
+    alloc_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool     = pDescriptorPool;
+    alloc_info.descriptorSetCount = set_count;
+    alloc_info.pSetLayouts        = set_layouts.data();
+
+    if (vkAllocateDescriptorSets(pDevice.getDevice(), &alloc_info, sets.data()) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to allocate Hi-Z descriptor sets");
+    }
+
+    pDepthSets.assign(sets.begin(), sets.begin() + image_count);
+    pLevelSets.assign(sets.begin() + image_count, sets.end());
+
+    for (uint32_t image = 0; image < image_count; image++) {
+      pWriteDescriptorSet(pDepthSets[image],
+                          swap_chain.getDepthImageView(image),
+                          VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                          pLevelViews[0]);
+    }
+
+    for (uint32_t level = 1; level < level_count; level++) {
+      pWriteDescriptorSet(pLevelSets[level], pLevelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL, pLevelViews[level]);
+    }
+
+    // Read back every level from the first one narrow enough, packed one after another
+    pReadbackLevel = 0;
+
+    while (pReadbackLevel + 1 < level_count && pLevelSizes[pReadbackLevel].width > READBACK_WIDTH) {
+      pReadbackLevel++;
+    }
+
+    pReadbackLevels.clear();
+    pReadbackCount = 0;
+
+    for (uint32_t level = pReadbackLevel; level < level_count; level++) {
+      pReadbackLevels.push_back({pLevelSizes[level].width, pLevelSizes[level].height, pReadbackCount});
+      pReadbackCount += uint64_t {pLevelSizes[level].width} * pLevelSizes[level].height;
+    }
+
+    pFrames.assign(frames_in_flight, {});
+
+    for (auto& frame : pFrames) {
+      pDevice.CreateBuffer(pReadbackCount * sizeof(float),
+                           VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           frame.buffer,
+                           frame.memory,
+                           MemoryCategory::Other);
+
+      void* mapped;
+      vkMapMemory(pDevice.getDevice(), frame.memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+      frame.depths = static_cast<float*>(mapped);
+    }
+  }
+
+  void HiZPyramid::pDestroyResources() {
+    if (pImage == VK_NULL_HANDLE) {
+      return;
+    }
+
+    // Frames in flight may still build or copy the old pyramid
+    pDevice.DeferDestroy([&device = pDevice,
+                          image   = pImage,
+                          memory  = pImageMemory,
+                          views   = pLevelViews,
+                          pool    = pDescriptorPool,
+                          frames  = pFrames]() {
+      for (auto view : views) {
+        vkDestroyImageView(device.getDevice(), view, nullptr);
+      }
+
+      vkDestroyImage(device.getDevice(), image, nullptr);
+      device.FreeMemory(memory);
+      vkDestroyDescriptorPool(device.getDevice(), pool, nullptr);
+
+      for (const auto& frame : frames) {
+        vkDestroyBuffer(device.getDevice(), frame.buffer, nullptr);
+        device.FreeMemory(frame.memory);
+      }
+    });
+
+    pImage          = VK_NULL_HANDLE;
+    pImageMemory    = VK_NULL_HANDLE;
+    pDescriptorPool = VK_NULL_HANDLE;
+
+    pLevelViews.clear();
+    pDepthSets.clear();
+    pLevelSets.clear();
+
+    for (auto& frame : pFrames) {
+      frame = {};
+    }
+  }
+
+  void HiZPyramid::pWriteDescriptorSet(VkDescriptorSet set,
+                                       VkImageView     source,
+                                       VkImageLayout   source_layout,
+                                       VkImageView     target) {
+    VkDescriptorImageInfo source_info {pSampler, source, source_layout};
+    VkDescriptorImageInfo target_info {VK_NULL_HANDLE, target, VK_IMAGE_LAYOUT_GENERAL};
+
+    std::array<VkWriteDescriptorSet, 2> writes {};
+
+    writes[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].dstSet          = set;
+    writes[0].dstBinding      = 0;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[0].pImageInfo      = &source_info;
+
+    writes[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].dstSet          = set;
+    writes[1].dstBinding      = 1;
+    writes[1].descriptorCount = 1;
+    writes[1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[1].pImageInfo      = &target_info;
+
+    vkUpdateDescriptorSets(pDevice.getDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+  }
+}
@@ -0,0 +1,95 @@
+#ifndef SVKE_HI_Z_PYRAMID_HPP
+#define SVKE_HI_Z_PYRAMID_HPP
+
+#include "defines.hpp"
+#include "device.hpp"
+#include "occlusion_buffer.hpp"
+#include "pch.hpp"
+#include "swap_chain.hpp"
+
+namespace svke {
+  // Hierarchical depth pyramid built by compute from the swap chain's depth attachment after every frame, each level
+  // keeping the farthest depth of the 2x2 (3x3 at odd sizes) texels under it. Levels at most READBACK_WIDTH wide are
+  // copied to a host visible buffer per frame in flight and handed to the occlusion buffer once the frame slot comes
+  // around again, by which point the GPU has finished it. Culling therefore tests against a pyramid frames_in_flight
+  // frames old, in that frame's space.
+  class HiZPyramid {
+   public:
+    static constexpr uint32_t READBACK_WIDTH = 256;
+    static constexpr uint32_t GROUP_SIZE     = 8;
+
+   public:
+    HiZPyramid(Device& device, uint32_t frames_in_flight);
+    ~HiZPyramid();
+
+    HiZPyramid(const HiZPyramid& other) = delete;
+    HiZPyramid& operator=(const HiZPyramid& other) = delete;
+
+   public:
+    // Recreates the pyramid for the swap chain's extent and depth images. Frames still in flight keep the old one.
+    void Resize(SwapChain& swap_chain, uint32_t frames_in_flight);
+
+    // Picks up the pyramid the frame slot read back last time around
+    void BeginFrame(uint32_t frame);
+
+    // Projection * view the depth of the current frame is rendered with, set before Record
+    void SetProjectionView(const glm::mat4& projection_view) { pProjectionView = projection_view; }
+
+    // After the swap chain render pass, which leaves the depth attachment readable by compute
+    void Record(VkCommandBuffer command_buffer, uint32_t image_index);
+
+    // Disabled pyramids are neither built nor tested against
+    void SetEnabled(bool enabled);
+    bool IsEnabled() const { return pEnabled; }
+
+    const OcclusionBuffer& getOcclusionBuffer() const { return pOcclusionBuffer; }
+    uint32_t               getLevelCount() const { return static_cast<uint32_t>(pLevelSizes.size()); }
+
+   private:
+    struct PushData {
+      int32_t source_size[2];
+      int32_t destination_size[2];
+    };
+
+    struct Frame {
+      VkBuffer       buffer {VK_NULL_HANDLE};
+      VkDeviceMemory memory {VK_NULL_HANDLE};
+      float*         depths {nullptr};
+      glm::mat4      projection_view {1.0f};
+      bool           pending {false};
+    };
+
+    void pCreatePipeline();
+    void pCreateResources(SwapChain& swap_chain, uint32_t frames_in_flight);
+    void pDestroyResources();
+    void pWriteDescriptorSet(VkDescriptorSet set, VkImageView source, VkImageLayout source_layout, VkImageView target);
+
+   private:
+    Device&               pDevice;
+    VkDescriptorSetLayout pSetLayout {VK_NULL_HANDLE};
+    VkPipelineLayout      pPipelineLayout {VK_NULL_HANDLE};
+    VkPipeline            pPipeline {VK_NULL_HANDLE};
+    VkSampler             pSampler {VK_NULL_HANDLE};
+
+    VkImage                      pImage {VK_NULL_HANDLE};
+    VkDeviceMemory               pImageMemory {VK_NULL_HANDLE};
+    std::vector<VkImageView>     pLevelViews;
+    std::vector<VkExtent2D>      pLevelSizes;
+    VkExtent2D                   pDepthExtent {};
+    VkDescriptorPool             pDescriptorPool {VK_NULL_HANDLE};
+    std::vector<VkDescriptorSet> pDepthSets;  // Level 0 from each swap chain image's depth
+    std::vector<VkDescriptorSet> pLevelSets;  // Level i from level i - 1, unused at 0
+
+    uint32_t                            pReadbackLevel {0};
+    std::vector<OcclusionBuffer::Level> pReadbackLevels;
+    uint64_t                            pReadbackCount {0};  // Depths per frame
+    std::vector<Frame>                  pFrames;
+    uint32_t                            pCurrentFrame {0};
+
+    glm::mat4       pProjectionView {1.0f};
+    OcclusionBuffer pOcclusionBuffer;
+    bool            pEnabled {true};
+  };
+}
+
+#endif
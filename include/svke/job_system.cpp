@@ -0,0 +1,211 @@
+#include "job_system.hpp"
+
+#include "defines.hpp"
+#include "pch_core.hpp"
+#include "profiler.hpp"
+
+namespace svke {
+  // Queue 0 belongs to the thread that created the job system, workers own the queues after it
+  static thread_local const JobSystem* tCurrentJobSystem = nullptr;
+  static thread_local uint32_t         tCurrentQueue     = 0;
+
+  bool WorkStealingQueue::Push(Job* job) {
+    int64_t bottom = pBottom.load(std::memory_order_relaxed);
+    int64_t top    = pTop.load(std::memory_order_acquire);
+
+    if (bottom - top >= CAPACITY) {
+      return false;
+    }
+
+    pJobs[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    pBottom.store(bottom + 1, std::memory_order_relaxed);
+
+    return true;
+  }
+
+  Job* WorkStealingQueue::Pop() {
+    int64_t bottom = pBottom.load(std::memory_order_relaxed) - 1;
+    pBottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = pTop.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+      pBottom.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    Job* job = pJobs[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+
+    if (top == bottom) {
+      // Last job in the queue, race against thieves for it
+      if (!pTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        job = nullptr;
+      }
+
+      pBottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+  }
+
+  Job* WorkStealingQueue::Steal() {
+    int64_t top = pTop.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = pBottom.load(std::memory_order_acquire);
+
+    if (top >= bottom) {
+      return nullptr;
+    }
+
+    Job* job = pJobs[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+
+    if (!pTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return nullptr;
+    }
+
+    return job;
+  }
+
+  uint32_t JobSystem::DefaultWorkerCount() {
+    uint32_t hardware_threads = std::thread::hardware_concurrency();
+    return hardware_threads > 1 ? hardware_threads - 1 : 0;
+  }
+
+  JobSystem::JobSystem(uint32_t worker_count) : pOwnerThread {std::this_thread::get_id()} {
+    for (uint32_t i = 0; i < worker_count + 1; i++) {
+      pQueues.push_back(std::make_unique<WorkStealingQueue>());
+    }
+
+    for (uint32_t i = 1; i < worker_count + 1; i++) {
+      pWorkers.emplace_back(&JobSystem::pWorkerLoop, this, i);
+    }
+  }
+
+  JobSystem::~JobSystem() {
+    {
+      std::lock_guard<std::mutex> lock {pSleepMutex};
+      pStop = true;
+    }
+
+    pSleepCondition.notify_all();
+
+    for (auto& worker : pWorkers) {
+      worker.join();
+    }
+
+    // Jobs nobody got to are still owned by the queues
+    for (auto& queue : pQueues) {
+      while (Job* job = queue->Pop()) {
+        delete job;
+      }
+    }
+  }
+
+  void JobSystem::Run(std::function<void()> function, JobCounter& counter, const JobCounter* dependency) {
+    uint32_t queue = pCurrentQueue();
+
+    counter.Add(1);
+
+    Job* job = new Job {std::move(function), &counter, dependency};
+
+    if (!pQueues[queue]->Push(job)) {
+      pExecute(job);
+      return;
+    }
+
+    pQueuedJobs.fetch_add(1, std::memory_order_release);
+
+    if (!pWorkers.empty()) {
+      // Taking the lock orders this wake up after any worker that is between checking for work and going to sleep
+      { std::lock_guard<std::mutex> lock {pSleepMutex}; }
+      pSleepCondition.notify_one();
+    }
+  }
+
+  void JobSystem::ParallelFor(uint32_t                                begin,
+                              uint32_t                                end,
+                              uint32_t                                grain,
+                              std::function<void(uint32_t, uint32_t)> function,
+                              JobCounter&                             counter,
+                              const JobCounter*                       dependency) {
+    grain = std::max(grain, 1u);
+
+    for (uint32_t chunk_begin = begin; chunk_begin < end; chunk_begin += std::min(grain, end - chunk_begin)) {
+      uint32_t chunk_end = chunk_begin + std::min(grain, end - chunk_begin);
+      Run([function, chunk_begin, chunk_end]() { function(chunk_begin, chunk_end); }, counter, dependency);
+    }
+  }
+
+  void JobSystem::Wait(const JobCounter& counter) {
+    uint32_t queue = pCurrentQueue();
+
+    while (!counter.IsDone()) {
+      if (Job* job = pFindJob(queue)) {
+        pExecute(job);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void JobSystem::pWorkerLoop(uint32_t index) {
+    tCurrentJobSystem = this;
+    tCurrentQueue     = index;
+
+    Profiler::SetThreadName("Worker " + std::to_string(index));
+
+    while (true) {
+      if (Job* job = pFindJob(index)) {
+        pExecute(job);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock {pSleepMutex};
+      pSleepCondition.wait(lock, [this]() { return pStop || pQueuedJobs.load(std::memory_order_acquire) > 0; });
+
+      if (pStop) {
+        return;
+      }
+    }
+  }
+
+  Job* JobSystem::pFindJob(uint32_t index) {
+    Job* job = pQueues[index]->Pop();
+
+    // Steal round robin starting after our own queue so that workers spread over different victims
+    for (uint32_t i = 1; job == nullptr && i < pQueues.size(); i++) {
+      job = pQueues[(index + i) % pQueues.size()]->Steal();
+    }
+
+    if (job != nullptr) {
+      pQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    return job;
+  }
+
+  void JobSystem::pExecute(Job* job) {
+    if (job->dependency != nullptr) {
+      Wait(*job->dependency);
+    }
+
+    job->function();
+    job->counter->Done();
+
+    delete job;
+  }
+
+  uint32_t JobSystem::pCurrentQueue() const {
+    if (tCurrentJobSystem == this) {
+      return tCurrentQueue;
+    }
+
+    // Queue 0 has a single owner, pushing or popping on it from any other thread corrupts it
+    if (std::this_thread::get_id() != pOwnerThread) {
+      throw std::runtime_error("Jobs can only be run and waited on from the job system's own threads");
+    }
+
+    return 0;
+  }
+}
@@ -0,0 +1,97 @@
+#ifndef SVKE_JOB_SYSTEM_HPP
+#define SVKE_JOB_SYSTEM_HPP
+
+#include "defines.hpp"
+#include "pch_core.hpp"
+
+namespace svke {
+  // Counts outstanding jobs. A job that depends on others waits on their counter, which runs other jobs meanwhile.
+  class JobCounter {
+   public:
+    JobCounter() = default;
+
+    JobCounter(const JobCounter& other) = delete;
+    JobCounter& operator=(const JobCounter& other) = delete;
+
+   public:
+    void Add(uint32_t count) { pPending.fetch_add(count, std::memory_order_relaxed); }
+    void Done() { pPending.fetch_sub(1, std::memory_order_release); }
+    bool IsDone() const { return pPending.load(std::memory_order_acquire) == 0; }
+
+   private:
+    std::atomic<uint32_t> pPending {0};
+  };
+
+  struct Job {
+    std::function<void()> function;
+    JobCounter*           counter;
+    const JobCounter*     dependency;
+  };
+
+  // Chase-Lev work stealing deque. The owning thread pushes and pops at the bottom, any other thread steals from the
+  // top. Fixed capacity, Push fails when full and the caller runs the job inline instead.
+  class WorkStealingQueue {
+   public:
+    static constexpr int64_t CAPACITY = 4096;
+
+   public:
+    WorkStealingQueue() = default;
+
+    WorkStealingQueue(const WorkStealingQueue& other) = delete;
+    WorkStealingQueue& operator=(const WorkStealingQueue& other) = delete;
+
+   public:
+    bool Push(Job* job);
+    Job* Pop();
+    Job* Steal();
+
+   private:
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Queue capacity must be a power of two");
+
+    alignas(64) std::atomic<int64_t> pTop {0};
+    alignas(64) std::atomic<int64_t> pBottom {0};
+    std::array<std::atomic<Job*>, CAPACITY> pJobs {};
+  };
+
+  class JobSystem {
+   public:
+    // worker_count does not include the calling thread, which also executes jobs while it waits. Only that thread and
+    // the workers may run jobs and wait on them, Run and Wait throw when called from any other thread.
+    JobSystem(uint32_t worker_count = DefaultWorkerCount());
+    ~JobSystem();
+
+    JobSystem(const JobSystem& other) = delete;
+    JobSystem& operator=(const JobSystem& other) = delete;
+
+   public:
+    void Run(std::function<void()> function, JobCounter& counter, const JobCounter* dependency = nullptr);
+    void ParallelFor(uint32_t                                 begin,
+                     uint32_t                                 end,
+                     uint32_t                                 grain,
+                     std::function<void(uint32_t, uint32_t)> function,
+                     JobCounter&                              counter,
+                     const JobCounter*                        dependency = nullptr);
+    void Wait(const JobCounter& counter);
+
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(pQueues.size()); }
+
+    static uint32_t DefaultWorkerCount();
+
+   private:
+    void     pWorkerLoop(uint32_t index);
+    Job*     pFindJob(uint32_t index);
+    void     pExecute(Job* job);
+    uint32_t pCurrentQueue() const;
+
+   private:
+    std::vector<std::unique_ptr<WorkStealingQueue>> pQueues;
+    std::vector<std::thread>                        pWorkers;
+    std::thread::id                                 pOwnerThread;
+    std::atomic<bool>                               pStop {false};
+    std::atomic<int64_t>                            pQueuedJobs {0};
+    std::mutex                                      pSleepMutex;
+    std::condition_variable                         pSleepCondition;
+  };
+}
+
+#endif
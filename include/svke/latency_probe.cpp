@@ -0,0 +1,56 @@
+#include "defines.hpp"
+#include "latency_probe.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  static double Milliseconds(LatencyProbe::clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  }
+
+  void LatencyProbe::Resize(uint32_t frames_in_flight) {
+    pFrames.assign(frames_in_flight, Frame {});
+  }
+
+  void LatencyProbe::MarkPresented(uint32_t frame) {
+    if (pInputTime == clock::time_point {}) {
+      return;
+    }
+
+    pFrames[frame].input_time = pInputTime;
+    pFrames[frame].present_ms = Milliseconds(clock::now() - pInputTime);
+    pFrames[frame].pending    = true;
+
+    pInputTime = {};
+  }
+
+  void LatencyProbe::MarkGpuComplete(uint32_t frame) {
+    Frame &slot = pFrames[frame];
+
+    if (!slot.pending) {
+      return;
+    }
+
+    double gpu_ms = Milliseconds(clock::now() - slot.input_time);
+
+    pStats.frames++;
+    pStats.average_present_ms += slot.present_ms;
+    pStats.max_present_ms = std::max(pStats.max_present_ms, slot.present_ms);
+    pStats.average_gpu_ms += gpu_ms;
+    pStats.max_gpu_ms = std::max(pStats.max_gpu_ms, gpu_ms);
+
+    slot.pending = false;
+  }
+
+  LatencyStats LatencyProbe::Collect() {
+    LatencyStats stats = pStats;
+
+    if (stats.frames > 0) {
+      stats.average_present_ms /= stats.frames;
+      stats.average_gpu_ms /= stats.frames;
+    }
+
+    pStats = {};
+
+    return stats;
+  }
+}
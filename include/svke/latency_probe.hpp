@@ -0,0 +1,53 @@
+#ifndef SVKE_LATENCY_PROBE_HPP
+#define SVKE_LATENCY_PROBE_HPP
+
+#include "defines.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  // Latencies of the frames completed since the last Collect, in milliseconds
+  struct LatencyStats {
+    uint32_t frames             = 0;
+    double   average_present_ms = 0.0;  // Input sampled -> present queued
+    double   max_present_ms     = 0.0;
+    double   average_gpu_ms     = 0.0;  // Input sampled -> frame fence observed signaled
+    double   max_gpu_ms         = 0.0;
+  };
+
+  // Tracks how long input sampled for a frame takes to reach the screen. The input time is taken when the application
+  // marks it and carried with the frame slot until the GPU finishes it. GPU completion is observed by polling the frame
+  // fences, so it is an upper bound with a resolution of one frame.
+  class LatencyProbe {
+   public:
+    using clock = std::chrono::steady_clock;
+
+   public:
+    LatencyProbe() = default;
+
+    LatencyProbe(const LatencyProbe &other) = delete;
+    LatencyProbe &operator=(const LatencyProbe &other) = delete;
+
+   public:
+    void Resize(uint32_t frames_in_flight);
+
+    void MarkInputSampled() { pInputTime = clock::now(); }
+    void MarkPresented(uint32_t frame);
+    void MarkGpuComplete(uint32_t frame);
+    bool IsPending(uint32_t frame) const { return pFrames[frame].pending; }
+
+    LatencyStats Collect();
+
+   private:
+    struct Frame {
+      clock::time_point input_time {};
+      double            present_ms {0.0};
+      bool              pending {false};
+    };
+
+    std::vector<Frame> pFrames;
+    clock::time_point  pInputTime {};
+    LatencyStats       pStats {};
+  };
+}
+
+#endif
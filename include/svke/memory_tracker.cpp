@@ -0,0 +1,77 @@
+#include "memory_tracker.hpp"
+
+#include "defines.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  const char* MemoryCategoryName(MemoryCategory category) {
+    switch (category) {
+      case MemoryCategory::Geometry:
+        return "geometry";
+      case MemoryCategory::Depth:
+        return "depth";
+      case MemoryCategory::Staging:
+        return "staging";
+      case MemoryCategory::Uniform:
+        return "uniform";
+      case MemoryCategory::Texture:
+        return "texture";
+      default:
+        return "other";
+    }
+  }
+
+  void MemoryTracker::Track(VkDeviceMemory memory, VkDeviceSize size, uint32_t heap, MemoryCategory category) {
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    pAllocations[memory] = {size, heap, category};
+
+    pAdd(pTotal, size);
+    pAdd(pCategories[static_cast<size_t>(category)], size);
+    pAdd(pHeaps[heap], size);
+  }
+
+  void MemoryTracker::Untrack(VkDeviceMemory memory) {
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    auto found = pAllocations.find(memory);
+
+    if (found == pAllocations.end()) {
+      return;
+    }
+
+    const Allocation& allocation = found->second;
+
+    pRemove(pTotal, allocation.size);
+    pRemove(pCategories[static_cast<size_t>(allocation.category)], allocation.size);
+    pRemove(pHeaps[allocation.heap], allocation.size);
+
+    pAllocations.erase(found);
+  }
+
+  MemoryReport MemoryTracker::getReport(uint32_t heap_count) {
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    MemoryReport report;
+    report.total      = pTotal;
+    report.categories = pCategories;
+    report.heaps.resize(heap_count);
+
+    for (uint32_t heap = 0; heap < heap_count; heap++) {
+      report.heaps[heap].usage = pHeaps[heap];
+    }
+
+    return report;
+  }
+
+  void MemoryTracker::pAdd(MemoryUsage& usage, VkDeviceSize size) {
+    usage.current += size;
+    usage.peak = std::max(usage.peak, usage.current);
+    usage.allocations++;
+  }
+
+  void MemoryTracker::pRemove(MemoryUsage& usage, VkDeviceSize size) {
+    usage.current -= size;
+    usage.allocations--;
+  }
+}
@@ -0,0 +1,75 @@
+#ifndef SVKE_MEMORY_TRACKER_HPP
+#define SVKE_MEMORY_TRACKER_HPP
+
+#include "defines.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  enum class MemoryCategory : uint32_t {
+    Geometry,
+    Depth,
+    Staging,
+    Uniform,
+    Texture,
+    Other,
+    Count,
+  };
+
+  const char* MemoryCategoryName(MemoryCategory category);
+
+  struct MemoryUsage {
+    VkDeviceSize current     = 0;
+    VkDeviceSize peak        = 0;
+    uint64_t     allocations = 0;  // Live allocations
+  };
+
+  struct HeapReport {
+    MemoryUsage  usage;
+    VkDeviceSize size          = 0;
+    bool         device_local  = false;
+    VkDeviceSize budget        = 0;  // VK_EXT_memory_budget only, zero without it
+    VkDeviceSize process_usage = 0;  // VK_EXT_memory_budget only, everything this process allocated from the heap
+  };
+
+  struct MemoryReport {
+    MemoryUsage                                                         total;
+    std::array<MemoryUsage, static_cast<size_t>(MemoryCategory::Count)> categories;
+    std::vector<HeapReport>                                             heaps;
+    bool                                                                from_extension = false;
+  };
+
+  // Live totals of device memory allocations per category and per heap, along with their high water marks
+  class MemoryTracker {
+   public:
+    MemoryTracker() = default;
+
+    MemoryTracker(const MemoryTracker& other) = delete;
+    MemoryTracker& operator=(const MemoryTracker& other) = delete;
+
+   public:
+    void Track(VkDeviceMemory memory, VkDeviceSize size, uint32_t heap, MemoryCategory category);
+    void Untrack(VkDeviceMemory memory);
+
+    // Heaps are sized to the given count, budgets are left for the device to fill in
+    MemoryReport getReport(uint32_t heap_count);
+
+   private:
+    struct Allocation {
+      VkDeviceSize   size;
+      uint32_t       heap;
+      MemoryCategory category;
+    };
+
+    static void pAdd(MemoryUsage& usage, VkDeviceSize size);
+    static void pRemove(MemoryUsage& usage, VkDeviceSize size);
+
+   private:
+    std::mutex                                                          pMutex;
+    std::unordered_map<VkDeviceMemory, Allocation>                      pAllocations;
+    MemoryUsage                                                         pTotal;
+    std::array<MemoryUsage, static_cast<size_t>(MemoryCategory::Count)> pCategories {};
+    std::array<MemoryUsage, VK_MAX_MEMORY_HEAPS>                        pHeaps {};
+  };
+}
+
+#endif
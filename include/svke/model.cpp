@@ -1,84 +1,488 @@
 #include "defines.hpp"
+#include "hash.hpp"
 #include "model.hpp"
 #include "pch.hpp"
+#include "profiler.hpp"
 
 namespace svke {
+  // Tom Forsyth's linear speed vertex cache optimization. Triangles are emitted greedily by the summed score of their
+  // vertices, which favours vertices that are in a simulated LRU post-transform cache and vertices with few triangles
+  // left, so that each vertex is finished while it is still cached.
+  static void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertex_count) {
+    constexpr uint32_t CACHE_SIZE          = 32;
+    constexpr float    CACHE_DECAY_POWER   = 1.5f;
+    constexpr float    LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float    VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float    VALENCE_BOOST_POWER = 0.5f;
+    constexpr uint32_t NO_TRIANGLE         = std::numeric_limits<uint32_t>::max();
+
+    uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+
+    // Triangles not emitted yet that use vertex v are adjacency[offsets[v], offsets[v] + remaining[v])
+    std::vector<uint32_t> remaining(vertex_count, 0);
+    std::vector<uint32_t> offsets(vertex_count, 0);
+    std::vector<uint32_t> adjacency(triangle_count * 3);
+
+    for (uint32_t i = 0; i < triangle_count * 3; i++) {
+      remaining[indices[i]]++;
+    }
+
+    for (uint32_t vertex = 1; vertex < vertex_count; vertex++) {
+      offsets[vertex] = offsets[vertex - 1] + remaining[vertex - 1];
+    }
+
+    std::vector<uint32_t> filled(vertex_count, 0);
+
+    for (uint32_t i = 0; i < triangle_count * 3; i++) {
+      uint32_t vertex                               = indices[i];
+      adjacency[offsets[vertex] + filled[vertex]++] = i / 3;
+    }
+
+    std::vector<int32_t> cache_positions(vertex_count, -1);
+
+    auto score_vertex = [&](uint32_t vertex) {
+      if (remaining[vertex] == 0) {
+        return -1.0f;
+      }
+
+      float   score    = 0.0f;
+      int32_t position = cache_positions[vertex];
+
+      // The last triangle's vertices get a fixed score so that strips do not simply walk back over themselves
+      if (position >= 0 && position < 3) {
+        score = LAST_TRIANGLE_SCORE;
+      } else if (position >= 3) {
+        float scale = 1.0f - static_cast<float>(position - 3) / static_cast<float>(CACHE_SIZE - 3);
+        score       = std::pow(scale, CACHE_DECAY_POWER);
+      }
+
+      return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining[vertex]), -VALENCE_BOOST_POWER);
+    };
+
+    std::vector<float> vertex_scores(vertex_count);
+    std::vector<float> triangle_scores(triangle_count, 0.0f);
+    std::vector<bool>  emitted(triangle_count, false);
+
+    for (uint32_t vertex = 0; vertex < vertex_count; vertex++) {
+      vertex_scores[vertex] = score_vertex(vertex);
+    }
+
+    for (uint32_t i = 0; i < triangle_count * 3; i++) {
+      triangle_scores[i / 3] += vertex_scores[indices[i]];
+    }
+
+    std::vector<uint32_t> output;
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> next_cache;
+    uint32_t              next_unemitted = 0;
+    uint32_t              best           = NO_TRIANGLE;
+
+    output.reserve(triangle_count * 3);
+
+    while (output.size() < triangle_count * 3) {
+      // Nothing in the cache has triangles left, continue with the next triangle in the original order
+      if (best == NO_TRIANGLE) {
+        while (emitted[next_unemitted]) {
+          next_unemitted++;
+        }
+
+        best = next_unemitted;
+      }
+
+      emitted[best] = true;
+      next_cache.clear();
+
+      for (uint32_t corner = 0; corner < 3; corner++) {
+        uint32_t vertex = indices[best * 3 + corner];
+        output.push_back(vertex);
+
+        uint32_t* begin = adjacency.data() + offsets[vertex];
+        uint32_t* end   = begin + remaining[vertex];
+
+        std::iter_swap(std::find(begin, end, best), end - 1);
+        remaining[vertex]--;
+
+        if (std::find(next_cache.begin(), next_cache.end(), vertex) == next_cache.end()) {
+          next_cache.push_back(vertex);
+        }
+      }
+
+      // The triangle's vertices move to the front, the rest of the cache keeps its order behind them
+      size_t triangle_vertices = next_cache.size();
+
+      for (uint32_t vertex : cache) {
+        auto triangle_end = next_cache.begin() + static_cast<ptrdiff_t>(triangle_vertices);
+
+        if (std::find(next_cache.begin(), triangle_end, vertex) == triangle_end) {
+          next_cache.push_back(vertex);
+        }
+      }
+
+      // Vertices pushed out of the cache are rescored as well, then the best triangle is searched among the cached
+      for (size_t i = 0; i < next_cache.size(); i++) {
+        uint32_t vertex         = next_cache[i];
+        cache_positions[vertex] = i < CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+
+        float score           = score_vertex(vertex);
+        float delta           = score - vertex_scores[vertex];
+        vertex_scores[vertex] = score;
+
+        for (uint32_t j = 0; j < remaining[vertex]; j++) {
+          triangle_scores[adjacency[offsets[vertex] + j]] += delta;
+        }
+      }
+
+      next_cache.resize(std::min<size_t>(next_cache.size(), CACHE_SIZE));
+      std::swap(cache, next_cache);
+
+      best             = NO_TRIANGLE;
+      float best_score = -1.0f;
+
+      for (uint32_t vertex : cache) {
+        for (uint32_t j = 0; j < remaining[vertex]; j++) {
+          uint32_t triangle = adjacency[offsets[vertex] + j];
+
+          if (triangle_scores[triangle] > best_score) {
+            best       = triangle;
+            best_score = triangle_scores[triangle];
+          }
+        }
+      }
+    }
+
+    std::copy(output.begin(), output.end(), indices.begin());
+  }
+
+  // Renumbers vertices in the order the index buffer first uses them, so that vertex fetches walk memory linearly
+  static void OptimizeVertexFetch(std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices) {
+    constexpr uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint32_t>      remap(vertices.size(), NO_VERTEX);
+    std::vector<Model::Vertex> reordered;
+
+    reordered.reserve(vertices.size());
+
+    for (uint32_t& index : indices) {
+      if (remap[index] == NO_VERTEX) {
+        remap[index] = static_cast<uint32_t>(reordered.size());
+        reordered.push_back(vertices[index]);
+      }
+
+      index = remap[index];
+    }
+
+    vertices = std::move(reordered);
+  }
+
   Model::Model(Device& device, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
       : pDevice {device} {
-    pCreateVertexBuffer(vertices);
-    pCreateIndexBuffer(indices);
+    pCreateVertexBuffer(vertices.data(), static_cast<uint32_t>(vertices.size()));
+    pCreateIndexBuffer(indices.data(), static_cast<uint32_t>(indices.size()));
   }
 
   Model::Model(Device& device, const std::vector<Vertex>& vertices) : pDevice {device} {
-    pCreateVertexBuffer(vertices);
+    pCreateVertexBuffer(vertices.data(), static_cast<uint32_t>(vertices.size()));
+  }
+
+  Model::Model(Device&         device,
+               const Vertex*   vertices,
+               uint32_t        vertex_count,
+               const uint32_t* indices,
+               uint32_t        index_count)
+      : pDevice {device} {
+    pCreateBuffers(vertices, vertex_count, indices, index_count);
   }
 
   Model::~Model() {
-    vkDestroyBuffer(pDevice.getDevice(), pVertexBuffer, nullptr);
-    vkFreeMemory(pDevice.getDevice(), pVertexBufferMemory, nullptr);
+    if (IsResident()) {
+      pReleaseBuffers();
+    }
+  }
 
-    if (pUsingIndexBuffer) {
-      vkDestroyBuffer(pDevice.getDevice(), pIndexBuffer, nullptr);
-      vkFreeMemory(pDevice.getDevice(), pIndexBufferMemory, nullptr);
+  // Layout of a processed mesh, the vertices and then the indices follow right after
+  struct MeshBlobHeader {
+    uint32_t vertex_count;
+    uint32_t index_count;
+  };
+
+  struct MeshBlobView {
+    const Model::Vertex* vertices;
+    uint32_t             vertex_count;
+    const uint32_t*      indices;
+    uint32_t             index_count;
+  };
+
+  static MeshBlobView ViewProcessedMesh(const AssetBlob& mesh, const std::string& name) {
+    if (mesh.getSize() < sizeof(MeshBlobHeader)) {
+      throw std::runtime_error("Invalid processed mesh: " + name);
+    }
+
+    MeshBlobHeader header;
+    memcpy(&header, mesh.getData(), sizeof(header));
+
+    size_t expected_size = sizeof(header) + header.vertex_count * sizeof(Model::Vertex) +
+                           header.index_count * sizeof(uint32_t);
+
+    if (mesh.getSize() != expected_size) {
+      throw std::runtime_error("Invalid processed mesh: " + name);
+    }
+
+    const uint8_t* vertices = mesh.getData() + sizeof(header);
+    const uint8_t* indices  = vertices + header.vertex_count * sizeof(Model::Vertex);
+
+    return {reinterpret_cast<const Model::Vertex*>(vertices),
+            header.vertex_count,
+            reinterpret_cast<const uint32_t*>(indices),
+            header.index_count};
+  }
+
+  std::unique_ptr<Model> Model::FromObjFile(Device& device, const std::string& path, AssetCache* cache) {
+    SVKE_PROFILE_SCOPE("Model::FromObjFile");
+
+    std::ifstream file {path, std::ios::binary};
+
+    if (!file.is_open()) {
+      throw std::runtime_error("Failed to open file: " + path);
+    }
+
+    std::stringstream source;
+    source << file.rdbuf();
+
+    return FromProcessedMesh(device, ProcessObj(source.str(), cache), path);
+  }
+
+  AssetBlob Model::ProcessObj(const std::string& source, AssetCache* cache) {
+    if (cache == nullptr) {
+      return AssetBlob::FromBytes(pProcessObj(source));
+    }
+
+    return cache->GetOrProcess(AssetCache::MakeKey(source.data(), source.size(), "obj"),
+                               [&]() { return pProcessObj(source); });
+  }
+
+  std::unique_ptr<Model> Model::FromProcessedMesh(Device& device, const AssetBlob& mesh, const std::string& name) {
+    MeshBlobView view = ViewProcessedMesh(mesh, name);
+
+    // Uploads copy into staging memory right away, so the blob can be unmapped once the model exists
+    return std::make_unique<Model>(device, view.vertices, view.vertex_count, view.indices, view.index_count);
+  }
+
+  std::unique_ptr<Model> Model::FromProcessedMesh(Device&                          device,
+                                                  std::shared_ptr<const AssetBlob> mesh,
+                                                  const std::string&               name) {
+    std::unique_ptr<Model> model = FromProcessedMesh(device, *mesh, name);
+    model->pSource               = std::move(mesh);
+
+    return model;
+  }
+
+  VkDeviceSize Model::getMemorySize() const {
+    return sizeof(Vertex) * static_cast<VkDeviceSize>(pVertexCount) +
+           sizeof(uint32_t) * static_cast<VkDeviceSize>(pIndexCount);
+  }
+
+  void Model::Release() {
+    assert(CanRelease() && "Only models that keep their processed mesh can be released");
+    assert(IsResident() && "Model is already released");
+
+    pReleaseBuffers();
+  }
+
+  void Model::Restore() {
+    assert(CanRelease() && "Only models that keep their processed mesh can be restored");
+    assert(!IsResident() && "Model is already resident");
+
+    // The mesh was validated when the model was first created from it
+    MeshBlobView view = ViewProcessedMesh(*pSource, "");
+    pCreateBuffers(view.vertices, view.vertex_count, view.indices, view.index_count);
+  }
+
+  std::vector<uint8_t> Model::pProcessObj(const std::string& source) {
+    SVKE_PROFILE_SCOPE("Model::ProcessObj");
+
+    struct VertexHash {
+      size_t operator()(const Vertex& vertex) const { return static_cast<size_t>(HashValue(vertex)); }
+    };
+
+    struct VertexEqual {
+      bool operator()(const Vertex& a, const Vertex& b) const { return memcmp(&a, &b, sizeof(Vertex)) == 0; }
+    };
+
+    std::vector<Vertex>                                           positions;
+    std::vector<Vertex>                                           vertices;
+    std::vector<uint32_t>                                         indices;
+    std::unordered_map<Vertex, uint32_t, VertexHash, VertexEqual> unique_vertices;
+
+    std::istringstream stream {source};
+    std::string        line;
+
+    while (std::getline(stream, line)) {
+      std::istringstream tokens {line};
+      std::string        type;
+      tokens >> type;
+
+      if (type == "v") {
+        Vertex vertex {{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}};
+        tokens >> vertex.position.x >> vertex.position.y >> vertex.position.z;
+
+        // Colors are an optional extension some exporters write after the position
+        if (!(tokens >> vertex.color.x >> vertex.color.y >> vertex.color.z)) {
+          vertex.color = {1.0f, 1.0f, 1.0f};
+        }
+
+        positions.push_back(vertex);
+      } else if (type == "f") {
+        std::vector<uint32_t> face;
+        std::string           corner;
+
+        // Only the position index matters, texture coordinates and normals after a slash are ignored
+        while (tokens >> corner) {
+          long index = std::strtol(corner.c_str(), nullptr, 10);
+          index      = index < 0 ? static_cast<long>(positions.size()) + index : index - 1;
+
+          if (index < 0 || index >= static_cast<long>(positions.size())) {
+            throw std::runtime_error("OBJ face references a missing vertex");
+          }
+
+          const Vertex& vertex = positions[static_cast<size_t>(index)];
+          auto          found  = unique_vertices.find(vertex);
+
+          if (found == unique_vertices.end()) {
+            found = unique_vertices.emplace(vertex, static_cast<uint32_t>(vertices.size())).first;
+            vertices.push_back(vertex);
+          }
+
+          face.push_back(found->second);
+        }
+
+        // Polygons are triangulated as a fan
+        for (size_t i = 2; i < face.size(); i++) {
+          indices.push_back(face[0]);
+          indices.push_back(face[i - 1]);
+          indices.push_back(face[i]);
+        }
+      }
     }
+
+    // Only the order of triangles and vertices changes, the mesh draws the same
+    OptimizeVertexCache(indices, static_cast<uint32_t>(vertices.size()));
+    OptimizeVertexFetch(vertices, indices);
+
+    MeshBlobHeader header {static_cast<uint32_t>(vertices.size()), static_cast<uint32_t>(indices.size())};
+
+    std::vector<uint8_t> blob(sizeof(header) + vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t));
+
+    memcpy(blob.data(), &header, sizeof(header));
+    memcpy(blob.data() + sizeof(header), vertices.data(), vertices.size() * sizeof(Vertex));
+    memcpy(blob.data() + sizeof(header) + vertices.size() * sizeof(Vertex),
+           indices.data(),
+           indices.size() * sizeof(uint32_t));
+
+    return blob;
   }
 
-  void Model::Bind(VkCommandBuffer buffer) {
-    VkBuffer     buffers[] = {pVertexBuffer};
+  void Model::Bind(VkCommandBuffer buffer, const DrawData& draw_data) {
+    VkBuffer     buffers[] = {draw_data.vertex_buffer};
     VkDeviceSize offets[]  = {0};
 
     vkCmdBindVertexBuffers(buffer, 0, 1, buffers, offets);
 
-    if (pUsingIndexBuffer) {
-      vkCmdBindIndexBuffer(buffer, pIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    if (draw_data.index_buffer != VK_NULL_HANDLE) {
+      vkCmdBindIndexBuffer(buffer, draw_data.index_buffer, 0, VK_INDEX_TYPE_UINT32);
     }
   }
 
-  void Model::Draw(VkCommandBuffer buffer) {
-    if (pUsingIndexBuffer) {
-      vkCmdDrawIndexed(buffer, pIndexCount, 1, 0, 0, 0);
+  void Model::Draw(VkCommandBuffer buffer, const DrawData& draw_data) {
+    if (draw_data.index_buffer != VK_NULL_HANDLE) {
+      vkCmdDrawIndexed(buffer, draw_data.count, 1, 0, 0, 0);
     } else {
-      vkCmdDraw(buffer, pVertexCount, 1, 0, 0);
+      vkCmdDraw(buffer, draw_data.count, 1, 0, 0);
     }
   }
 
-  void Model::pCreateVertexBuffer(const std::vector<Vertex>& vertices) {
-    pVertexCount = static_cast<uint32_t>(vertices.size());
+  Model::DrawData Model::getDrawData() const {
+    if (!IsResident()) {
+      return {VK_NULL_HANDLE, VK_NULL_HANDLE, 0};
+    }
+
+    if (pUsingIndexBuffer) {
+      return {pVertexBuffer, pIndexBuffer, pIndexCount};
+    }
+
+    return {pVertexBuffer, VK_NULL_HANDLE, pVertexCount};
+  }
+
+  void Model::pCreateBuffers(const Vertex*   vertices,
+                             uint32_t        vertex_count,
+                             const uint32_t* indices,
+                             uint32_t        index_count) {
+    pCreateVertexBuffer(vertices, vertex_count);
+
+    if (index_count > 0) {
+      pCreateIndexBuffer(indices, index_count);
+    }
+  }
+
+  void Model::pCreateVertexBuffer(const Vertex* vertices, uint32_t vertex_count) {
+    SVKE_PROFILE_SCOPE("Model::CreateVertexBuffer");
+
+    pVertexCount = vertex_count;
 
     if (pVertexCount < 3) {
       throw std::runtime_error("The model cannot contain less than three vertices");
     }
 
-    VkDeviceSize buffer_size = sizeof(vertices[0]) * pVertexCount;
+    for (uint32_t i = 0; i < vertex_count; i++) {
+      pBounds.Expand(vertices[i].position);
+    }
+
+    VkDeviceSize buffer_size = sizeof(Vertex) * pVertexCount;
     pDevice.CreateBuffer(buffer_size,
-                         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                          pVertexBuffer,
-                         pVertexBufferMemory);
-
-    void* data;
+                         pVertexBufferMemory,
+                         MemoryCategory::Geometry);
 
-    vkMapMemory(pDevice.getDevice(), pVertexBufferMemory, 0, buffer_size, 0, &data);
-    memcpy(data, vertices.data(), static_cast<size_t>(buffer_size));
-    vkUnmapMemory(pDevice.getDevice(), pVertexBufferMemory);
+    pDevice.getUploadContext().UploadBuffer(vertices, buffer_size, pVertexBuffer);
   }
 
-  void Model::pCreateIndexBuffer(const std::vector<uint32_t>& indices) {
-    pIndexCount       = static_cast<uint32_t>(indices.size());
+  void Model::pCreateIndexBuffer(const uint32_t* indices, uint32_t index_count) {
+    SVKE_PROFILE_SCOPE("Model::CreateIndexBuffer");
+
+    pIndexCount       = index_count;
     pUsingIndexBuffer = true;
 
-    VkDeviceSize buffer_size = sizeof(indices[0]) * pIndexCount;
+    VkDeviceSize buffer_size = sizeof(uint32_t) * pIndexCount;
     pDevice.CreateBuffer(buffer_size,
-                         VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                          pIndexBuffer,
-                         pIndexBufferMemory);
+                         pIndexBufferMemory,
+                         MemoryCategory::Geometry);
+
+    pDevice.getUploadContext().UploadBuffer(indices, buffer_size, pIndexBuffer);
+  }
+
+  void Model::pReleaseBuffers() {
+    // Frames that are still in flight may draw this model
+    pDevice.DeferDestroy([device        = &pDevice,
+                          vertex_buffer = pVertexBuffer,
+                          vertex_memory = pVertexBufferMemory,
+                          index_buffer  = pUsingIndexBuffer ? pIndexBuffer : VK_NULL_HANDLE,
+                          index_memory  = pUsingIndexBuffer ? pIndexBufferMemory : VK_NULL_HANDLE]() {
+      vkDestroyBuffer(device->getDevice(), vertex_buffer, nullptr);
+      device->FreeMemory(vertex_memory);
 
-    void* data;
+      if (index_buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(device->getDevice(), index_buffer, nullptr);
+        device->FreeMemory(index_memory);
+      }
+    });
 
-    vkMapMemory(pDevice.getDevice(), pIndexBufferMemory, 0, buffer_size, 0, &data);
-    memcpy(data, indices.data(), static_cast<size_t>(buffer_size));
-    vkUnmapMemory(pDevice.getDevice(), pIndexBufferMemory);
+    pVertexBuffer     = VK_NULL_HANDLE;
+    pIndexBuffer      = VK_NULL_HANDLE;
+    pUsingIndexBuffer = false;
   }
 
   std::vector<VkVertexInputBindingDescription> Model::Vertex::getBindings() {
@@ -1,6 +1,8 @@
 #ifndef SVKE_MODEL_HPP
 #define SVKE_MODEL_HPP
 
+#include "asset_cache.hpp"
+#include "bounds.hpp"
 #include "defines.hpp"
 #include "device.hpp"
 #include "pch.hpp"
@@ -16,33 +18,80 @@ namespace svke {
       static std::vector<VkVertexInputAttributeDescription> getAtributes();
     };
 
+    // Everything binding and drawing the model needs, plain data that draw loops can keep in arrays
+    struct DrawData {
+      VkBuffer vertex_buffer;
+      VkBuffer index_buffer;  // VK_NULL_HANDLE when drawing without indices
+      uint32_t count;         // Indices, or vertices without an index buffer
+    };
+
    public:
     Model(Device& device, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
     Model(Device& device, const std::vector<Vertex>& vertices);
+    Model(Device&         device,
+          const Vertex*   vertices,
+          uint32_t        vertex_count,
+          const uint32_t* indices,
+          uint32_t        index_count);
     ~Model();
 
     Model(const Model& other) = delete;
     Model& operator=(const Model& other) = delete;
 
    public:
-    void Bind(VkCommandBuffer buffer);
-    void Draw(VkCommandBuffer buffer);
+    // Loads a Wavefront OBJ file with optional per vertex colors, deduplicating vertices. With a cache, the processed
+    // mesh is stored on the first load and later loads upload straight from the cached entry.
+    static std::unique_ptr<Model> FromObjFile(Device& device, const std::string& path, AssetCache* cache = nullptr);
+
+    // The steps of FromObjFile, for loaders that run and time them separately. ProcessObj deduplicates the OBJ source
+    // into a processed mesh, or fetches it from the cache. name only shows up in errors.
+    static AssetBlob              ProcessObj(const std::string& source, AssetCache* cache = nullptr);
+    static std::unique_ptr<Model> FromProcessedMesh(Device& device, const AssetBlob& mesh, const std::string& name);
+
+    // Keeps the processed mesh, usually a mapped cache entry, so that the model can release its buffers and restore
+    // them from it later. Models created any other way stay resident for as long as they exist.
+    static std::unique_ptr<Model> FromProcessedMesh(Device&                          device,
+                                                    std::shared_ptr<const AssetBlob> mesh,
+                                                    const std::string&               name);
+
+    // A released model keeps its bounds, its draw data has no buffers and a count of 0 until Restore
+    bool         CanRelease() const { return pSource != nullptr; }
+    bool         IsResident() const { return pVertexBuffer != VK_NULL_HANDLE; }
+    VkDeviceSize getMemorySize() const;
+    void         Release();
+    void         Restore();
+
+    void Bind(VkCommandBuffer buffer) { Bind(buffer, getDrawData()); }
+    void Draw(VkCommandBuffer buffer) { Draw(buffer, getDrawData()); }
+
+    static void Bind(VkCommandBuffer buffer, const DrawData& draw_data);
+    static void Draw(VkCommandBuffer buffer, const DrawData& draw_data);
+
+    DrawData    getDrawData() const;
+    const AABB& getBounds() const { return pBounds; }
 
    private:
-    void pCreateVertexBuffer(const std::vector<Vertex>& vertices);
-    void pCreateIndexBuffer(const std::vector<uint32_t>& indices);
+    void pCreateBuffers(const Vertex* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count);
+    void pCreateVertexBuffer(const Vertex* vertices, uint32_t vertex_count);
+    void pCreateIndexBuffer(const uint32_t* indices, uint32_t index_count);
+    void pReleaseBuffers();
+
+    static std::vector<uint8_t> pProcessObj(const std::string& source);
 
    private:
     Device& pDevice;
+    AABB    pBounds;
 
-    VkBuffer       pVertexBuffer;
-    VkDeviceMemory pVertexBufferMemory;
-    uint32_t       pVertexCount;
+    VkBuffer       pVertexBuffer {VK_NULL_HANDLE};
+    VkDeviceMemory pVertexBufferMemory {VK_NULL_HANDLE};
+    uint32_t       pVertexCount {0};
 
     bool           pUsingIndexBuffer {false};
-    VkBuffer       pIndexBuffer;
-    VkDeviceMemory pIndexBufferMemory;
-    uint32_t       pIndexCount;
+    VkBuffer       pIndexBuffer {VK_NULL_HANDLE};
+    VkDeviceMemory pIndexBufferMemory {VK_NULL_HANDLE};
+    uint32_t       pIndexCount {0};
+
+    std::shared_ptr<const AssetBlob> pSource;
   };
 }
 
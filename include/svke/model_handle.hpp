@@ -0,0 +1,15 @@
+#ifndef SVKE_MODEL_HANDLE_HPP
+#define SVKE_MODEL_HANDLE_HPP
+
+#include "defines.hpp"
+#include "pch_core.hpp"
+
+namespace svke {
+  // Handle of a model in a ModelRegistry, kept apart from the registry so that CPU only code can hold one. The low
+  // MODEL_SLOT_BITS are the model's slot, unique among live models, the rest is the slot's generation.
+  using ModelHandle                     = uint32_t;
+  constexpr ModelHandle NO_MODEL_HANDLE = std::numeric_limits<uint32_t>::max();
+  constexpr uint32_t    MODEL_SLOT_BITS = 20;
+}
+
+#endif
@@ -0,0 +1,86 @@
+#include "model_registry.hpp"
+
+#include "defines.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  ModelRegistry::ModelRegistry(Device& device, ResidencyManager* residency)
+      : pDevice {device}, pResidency {residency} {}
+
+  ModelRegistry::~ModelRegistry() {
+    // The manager's callbacks point back into the registry
+    for (auto& handle : pResidencyHandles) {
+      if (handle != NO_RESIDENCY_HANDLE) {
+        pResidency->Unregister(handle);
+      }
+    }
+  }
+
+  ModelHandle ModelRegistry::Add(std::unique_ptr<Model> model) {
+    assert(model != nullptr && "Cannot add a null model");
+
+    const uint32_t slot = pHandles.Allocate();
+
+    if (slot == Handles::NO_SLOT) {
+      throw std::runtime_error("Model registry is full");
+    }
+
+    if (slot == pModels.size()) {
+      pModels.emplace_back();
+      pDrawData.emplace_back();
+      pBounds.emplace_back();
+      pResidencyHandles.push_back(NO_RESIDENCY_HANDLE);
+    }
+
+    pDrawData[slot] = model->getDrawData();
+    pBounds[slot]   = model->getBounds();
+    pModels[slot]   = std::move(model);
+    pSize++;
+
+    if (pResidency != nullptr && pModels[slot]->CanRelease()) {
+      ResidencyDescription description;
+      description.level_sizes = {pModels[slot]->getMemorySize()};
+      description.stream_in   = [this, slot](uint32_t) {
+        pModels[slot]->Restore();
+        pDrawData[slot] = pModels[slot]->getDrawData();
+      };
+      description.evict = [this, slot]() {
+        pModels[slot]->Release();
+        pDrawData[slot] = pModels[slot]->getDrawData();
+      };
+
+      // The model was just created with its buffers, so it starts out resident
+      pResidencyHandles[slot] = pResidency->Register(std::move(description), 0);
+    }
+
+    return pHandles.getHandle(slot);
+  }
+
+  void ModelRegistry::Remove(ModelHandle handle) {
+    assert(IsValid(handle) && "Cannot remove a model twice");
+
+    const uint32_t slot = Handles::getSlot(handle);
+
+    pHandles.Release(slot);
+    pSize--;
+
+    if (pResidencyHandles[slot] != NO_RESIDENCY_HANDLE) {
+      pResidency->Unregister(pResidencyHandles[slot]);
+      pResidencyHandles[slot] = NO_RESIDENCY_HANDLE;
+    }
+
+    pRetired.push_back({pDevice.getFrameValue(), slot});
+  }
+
+  void ModelRegistry::Collect() {
+    const uint64_t completed = pDevice.getCompletedFrameValue();
+
+    while (!pRetired.empty() && pRetired.front().frame_value <= completed) {
+      const uint32_t slot = pRetired.front().slot;
+
+      pModels[slot].reset();
+      pRetired.pop_front();
+      pHandles.Free(slot);
+    }
+  }
+}
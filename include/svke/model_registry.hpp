@@ -0,0 +1,86 @@
+#ifndef SVKE_MODEL_REGISTRY_HPP
+#define SVKE_MODEL_REGISTRY_HPP
+
+#include "bounds.hpp"
+#include "defines.hpp"
+#include "device.hpp"
+#include "handle_allocator.hpp"
+#include "model.hpp"
+#include "model_handle.hpp"
+#include "pch.hpp"
+#include "residency_manager.hpp"
+
+namespace svke {
+  // Owns the models and hands out handles to them from a HandleAllocator, so game objects and draw lists hold plain
+  // integers instead of shared pointers. Each model's draw data and bounds are copied into arrays indexed by slot,
+  // culling and draw recording read those and never reach the model itself.
+  //
+  // Models live until they are removed. Their handle stops being valid right away, but the model is only destroyed and
+  // its slot reused once the frame being recorded has completed on the GPU, which Collect checks once per frame. Models
+  // still registered when the registry goes away defer their buffers to the device like any other model.
+  //
+  // With a residency manager, every added model that can release its buffers is registered with it, and Touch marks it
+  // as drawn. An evicted model keeps its handle and bounds, so it is still culled like any other, but its draw data is
+  // empty until the manager streams it back in. The manager has to outlive the registry.
+  // Adding, removing and collecting belong to one thread, as does the residency manager's Update. Lookups may come
+  // from any thread while none of those run.
+  class ModelRegistry {
+   public:
+    using Handles = HandleAllocator<MODEL_SLOT_BITS, 256>;
+
+    static constexpr uint32_t MAX_MODELS = Handles::MAX_SLOTS;
+
+   public:
+    ModelRegistry(Device& device, ResidencyManager* residency = nullptr);
+    ~ModelRegistry();
+
+    ModelRegistry(const ModelRegistry& other) = delete;
+    ModelRegistry& operator=(const ModelRegistry& other) = delete;
+
+   public:
+    ModelHandle Add(std::unique_ptr<Model> model);
+    void        Remove(ModelHandle handle);
+    void        Collect();
+
+    // Marks the model as used by the frame being recorded, which requests it again if it was evicted
+    void Touch(ModelHandle handle) const {
+      const uint32_t slot = Handles::getSlot(handle);
+
+      if (pResidency != nullptr && pResidencyHandles[slot] != NO_RESIDENCY_HANDLE) {
+        pResidency->Touch(pResidencyHandles[slot]);
+      }
+    }
+
+    bool IsValid(ModelHandle handle) const { return pHandles.IsValid(handle); }
+
+    Model&                 Get(ModelHandle handle) const { return *pModels[Handles::getSlot(handle)]; }
+    const Model::DrawData& getDrawData(ModelHandle handle) const { return pDrawData[Handles::getSlot(handle)]; }
+    const AABB&            getBounds(ModelHandle handle) const { return pBounds[Handles::getSlot(handle)]; }
+
+    uint32_t getSize() const { return pSize; }
+    uint32_t getRetiredCount() const { return static_cast<uint32_t>(pRetired.size()); }
+
+   private:
+    struct Retired {
+      uint64_t frame_value;  // Last frame that may have drawn the model
+      uint32_t slot;
+    };
+
+   private:
+    Device&           pDevice;
+    ResidencyManager* pResidency;
+
+    Handles pHandles;
+
+    // Indexed by slot
+    std::vector<std::unique_ptr<Model>> pModels;
+    std::vector<Model::DrawData>        pDrawData;
+    std::vector<AABB>                   pBounds;
+    std::vector<ResidencyHandle>        pResidencyHandles;  // NO_RESIDENCY_HANDLE unless the model can be evicted
+
+    std::deque<Retired> pRetired;
+    uint32_t            pSize {0};
+  };
+}
+
+#endif
@@ -0,0 +1,76 @@
+#include "occlusion_buffer.hpp"
+
+#include "defines.hpp"
+#include "pch_core.hpp"
+
+namespace svke {
+  void OcclusionBuffer::Set(const std::vector<Level>& levels,
+                            const float*              depths,
+                            uint64_t                  depth_count,
+                            const glm::mat4&          projection_view) {
+    pLevels = levels;
+    pDepths.assign(depths, depths + depth_count);
+    pProjectionView = projection_view;
+    pValid          = !pLevels.empty();
+  }
+
+  bool OcclusionBuffer::IsOccluded(const AABB& bounds) const {
+    if (!pValid) {
+      return false;
+    }
+
+    glm::vec3 min {std::numeric_limits<float>::max()};
+    glm::vec3 max {std::numeric_limits<float>::lowest()};
+
+    for (uint32_t corner = 0; corner < 8; corner++) {
+      glm::vec4 position {corner & 1 ? bounds.max.x : bounds.min.x,
+                          corner & 2 ? bounds.max.y : bounds.min.y,
+                          corner & 4 ? bounds.max.z : bounds.min.z,
+                          1.0f};
+      glm::vec4 clip = pProjectionView * position;
+
+      if (clip.w <= 0.0f) {
+        return false;
+      }
+
+      glm::vec3 ndc = glm::vec3(clip) / clip.w;
+
+      min = glm::min(min, ndc);
+      max = glm::max(max, ndc);
+    }
+
+    if (min.z <= 0.0f || max.x < -1.0f || max.y < -1.0f || min.x > 1.0f || min.y > 1.0f) {
+      return false;
+    }
+
+    // Screen rectangle in [0, 1], y pointing down like the framebuffer rows
+    float left   = std::max(min.x, -1.0f) * 0.5f + 0.5f;
+    float right  = std::min(max.x, 1.0f) * 0.5f + 0.5f;
+    float top    = std::max(min.y, -1.0f) * 0.5f + 0.5f;
+    float bottom = std::min(max.y, 1.0f) * 0.5f + 0.5f;
+
+    // The level where the rectangle spans at most two texels each way, so at most four are read
+    const Level& finest = pLevels.front();
+    float        size   = std::max((right - left) * finest.width, (bottom - top) * finest.height);
+    uint32_t     index  = size > 1.0f ? static_cast<uint32_t>(std::ceil(std::log2(size))) : 0;
+
+    const Level& level = pLevels[std::min(index, static_cast<uint32_t>(pLevels.size()) - 1)];
+
+    uint32_t x0 = std::min(static_cast<uint32_t>(left * level.width), level.width - 1);
+    uint32_t x1 = std::min(static_cast<uint32_t>(right * level.width), level.width - 1);
+    uint32_t y0 = std::min(static_cast<uint32_t>(top * level.height), level.height - 1);
+    uint32_t y1 = std::min(static_cast<uint32_t>(bottom * level.height), level.height - 1);
+
+    const float* depths = pDepths.data() + level.offset;
+
+    for (uint32_t y = y0; y <= y1; y++) {
+      for (uint32_t x = x0; x <= x1; x++) {
+        if (depths[y * level.width + x] >= min.z) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+}
@@ -0,0 +1,41 @@
+#ifndef SVKE_OCCLUSION_BUFFER_HPP
+#define SVKE_OCCLUSION_BUFFER_HPP
+
+#include "bounds.hpp"
+#include "defines.hpp"
+#include "pch_core.hpp"
+
+namespace svke {
+  // CPU copy of the coarse levels of a Hi-Z pyramid, each texel holding the farthest depth rendered over its part of
+  // the screen, together with the projection * view matrix of the frame it was rendered in. Boxes are tested in that
+  // frame's space, so the answer is whether the box was hidden back then.
+  class OcclusionBuffer {
+   public:
+    struct Level {
+      uint32_t width;
+      uint32_t height;
+      uint64_t offset;  // Into the depths, rows are tightly packed
+    };
+
+   public:
+    // Levels go from finest to coarsest and each covers the whole screen
+    void Set(const std::vector<Level>& levels,
+             const float*              depths,
+             uint64_t                  depth_count,
+             const glm::mat4&          projection_view);
+    void Clear() { pValid = false; }
+
+    // Conservative: a box crossing the near plane, off the screen or straddling the camera is never occluded
+    bool IsOccluded(const AABB& bounds) const;
+
+    bool IsValid() const { return pValid; }
+
+   private:
+    std::vector<Level> pLevels;
+    std::vector<float> pDepths;
+    glm::mat4          pProjectionView {1.0f};
+    bool               pValid {false};
+  };
+}
+
+#endif
@@ -3,24 +3,9 @@
 
 #include <vulkan/vulkan.h>
 
-#include <cassert>
-#include <cstring>
-#include <fstream>
-#include <iostream>
-#include <memory>
-#include <set>
-#include <stdexcept>
-#include <string>
-#include <unordered_set>
-#include <vector>
+#include "pch_core.hpp"
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
-#define GLM_FORCE_RADIAN
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#include <glm/glm.hpp>
-#include <glm/gtc/constants.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-
 #endif
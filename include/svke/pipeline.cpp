@@ -3,21 +3,198 @@
 #include "pipeline.hpp"
 
 #include "defines.hpp"
+#include "hash.hpp"
 #include "model.hpp"
 #include "pch.hpp"
+#include "profiler.hpp"
 
 namespace svke {
+  template <typename T>
+  static uint64_t HashArray(const std::vector<T>& values, uint64_t seed) {
+    seed = HashValue(values.size(), seed);
+    return values.empty() ? seed : HashBytes(values.data(), values.size() * sizeof(T), seed);
+  }
+
+  template <typename T>
+  static bool EqualArrays(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+  }
+
+  static Pipeline::id_t NextPipelineId() {
+    static Pipeline::id_t current_id = 0;
+    return current_id++;
+  }
+
+  template <typename T>
+  static std::vector<T> CopyArray(const T* values, uint32_t count) {
+    return values == nullptr ? std::vector<T> {} : std::vector<T>(values, values + count);
+  }
+
+  static bool HasDynamicState(const std::vector<VkDynamicState>& states, VkDynamicState state) {
+    return std::find(states.begin(), states.end(), state) != states.end();
+  }
+
+  PipelineDescription PipelineDescription::FromConfig(const std::string&    vertex_path,
+                                                      const std::string&    fragment_path,
+                                                      const PipelineConfig& config) {
+    const auto& viewport_info      = config.create_info;
+    const auto& assembly_info      = config.input_assembly_info;
+    const auto& rasterization_info = config.rasterization_info;
+    const auto& multisample_info   = config.multisample_info;
+    const auto& colorblend_info    = config.colorblend_info;
+    const auto& depth_stencil_info = config.depth_stencil_info;
+    const auto& dynamic_info       = config.dynamic_state_info;
+
+    // Anything not captured below would make two equal descriptions build different pipelines
+    bool has_extensions = viewport_info.pNext != nullptr || assembly_info.pNext != nullptr ||
+                          rasterization_info.pNext != nullptr || multisample_info.pNext != nullptr ||
+                          colorblend_info.pNext != nullptr || depth_stencil_info.pNext != nullptr ||
+                          dynamic_info.pNext != nullptr;
+    bool has_flags = viewport_info.flags != 0 || assembly_info.flags != 0 || rasterization_info.flags != 0 ||
+                     multisample_info.flags != 0 || colorblend_info.flags != 0 || depth_stencil_info.flags != 0 ||
+                     dynamic_info.flags != 0;
+
+    if (has_extensions || has_flags) {
+      throw std::runtime_error("Pipeline configs with extension structures or create flags cannot be described");
+    }
+
+    PipelineDescription description {};
+
+    description.vertex_path   = vertex_path;
+    description.fragment_path = fragment_path;
+
+    description.binding_descriptions   = config.binding_descriptions;
+    description.attribute_descriptions = config.attribute_descriptions;
+    description.dynamic_states         = CopyArray(dynamic_info.pDynamicStates, dynamic_info.dynamicStateCount);
+    description.blend_attachments      = CopyArray(colorblend_info.pAttachments, colorblend_info.attachmentCount);
+
+    // The sample mask holds one bit per rasterization sample
+    uint32_t sample_mask_words = (static_cast<uint32_t>(multisample_info.rasterizationSamples) + 31) / 32;
+    description.sample_mask    = CopyArray(multisample_info.pSampleMask, sample_mask_words);
+
+    if (!HasDynamicState(description.dynamic_states, VK_DYNAMIC_STATE_VIEWPORT)) {
+      description.viewports = CopyArray(viewport_info.pViewports, viewport_info.viewportCount);
+    }
+    if (!HasDynamicState(description.dynamic_states, VK_DYNAMIC_STATE_SCISSOR)) {
+      description.scissors = CopyArray(viewport_info.pScissors, viewport_info.scissorCount);
+    }
+
+    FixedState& state = description.state;
+
+    state.topology          = assembly_info.topology;
+    state.primitive_restart = assembly_info.primitiveRestartEnable;
+
+    state.viewport_count = viewport_info.viewportCount;
+    state.scissor_count  = viewport_info.scissorCount;
+
+    state.depth_clamp         = rasterization_info.depthClampEnable;
+    state.rasterizer_discard  = rasterization_info.rasterizerDiscardEnable;
+    state.polygon_mode        = rasterization_info.polygonMode;
+    state.cull_mode           = rasterization_info.cullMode;
+    state.front_face          = rasterization_info.frontFace;
+    state.depth_bias          = rasterization_info.depthBiasEnable;
+    state.depth_bias_constant = rasterization_info.depthBiasConstantFactor;
+    state.depth_bias_clamp    = rasterization_info.depthBiasClamp;
+    state.depth_bias_slope    = rasterization_info.depthBiasSlopeFactor;
+    state.line_width          = rasterization_info.lineWidth;
+
+    state.samples            = multisample_info.rasterizationSamples;
+    state.sample_shading     = multisample_info.sampleShadingEnable;
+    state.min_sample_shading = multisample_info.minSampleShading;
+    state.alpha_to_coverage  = multisample_info.alphaToCoverageEnable;
+    state.alpha_to_one       = multisample_info.alphaToOneEnable;
+
+    state.logic_op_enable = colorblend_info.logicOpEnable;
+    state.logic_op        = colorblend_info.logicOp;
+    memcpy(state.blend_constants, colorblend_info.blendConstants, sizeof(state.blend_constants));
+
+    state.depth_test        = depth_stencil_info.depthTestEnable;
+    state.depth_write       = depth_stencil_info.depthWriteEnable;
+    state.depth_compare     = depth_stencil_info.depthCompareOp;
+    state.depth_bounds_test = depth_stencil_info.depthBoundsTestEnable;
+    state.min_depth_bounds  = depth_stencil_info.minDepthBounds;
+    state.max_depth_bounds  = depth_stencil_info.maxDepthBounds;
+    state.stencil_test      = depth_stencil_info.stencilTestEnable;
+    state.stencil_front     = depth_stencil_info.front;
+    state.stencil_back      = depth_stencil_info.back;
+
+    description.pipeline_layout = config.pipeline_layout;
+    description.color_format    = config.color_format;
+    description.depth_format    = config.depth_format;
+    description.subpass         = config.subpass;
+
+    // Render passes with the same attachment formats are compatible, so the handle only matters when the formats
+    // were not provided.
+    bool formats_known      = config.color_format != VK_FORMAT_UNDEFINED;
+    description.render_pass = formats_known ? VK_NULL_HANDLE : config.render_pass;
+
+    return description;
+  }
+
+  uint64_t PipelineDescription::Hash() const {
+    uint64_t hash = HashString(vertex_path);
+
+    hash = HashString(fragment_path, hash);
+    hash = HashArray(binding_descriptions, hash);
+    hash = HashArray(attribute_descriptions, hash);
+    hash = HashArray(dynamic_states, hash);
+    hash = HashArray(blend_attachments, hash);
+    hash = HashArray(sample_mask, hash);
+    hash = HashArray(viewports, hash);
+    hash = HashArray(scissors, hash);
+
+    hash = HashValue(state, hash);
+
+    hash = HashValue(pipeline_layout, hash);
+    hash = HashValue(render_pass, hash);
+    hash = HashValue(color_format, hash);
+    hash = HashValue(depth_format, hash);
+    hash = HashValue(subpass, hash);
+
+    return hash;
+  }
+
+  bool PipelineDescription::operator==(const PipelineDescription& other) const {
+    return vertex_path == other.vertex_path && fragment_path == other.fragment_path &&
+           EqualArrays(binding_descriptions, other.binding_descriptions) &&
+           EqualArrays(attribute_descriptions, other.attribute_descriptions) &&
+           EqualArrays(dynamic_states, other.dynamic_states) &&
+           EqualArrays(blend_attachments, other.blend_attachments) && EqualArrays(sample_mask, other.sample_mask) &&
+           EqualArrays(viewports, other.viewports) && EqualArrays(scissors, other.scissors) &&
+           memcmp(&state, &other.state, sizeof(state)) == 0 && pipeline_layout == other.pipeline_layout &&
+           render_pass == other.render_pass && color_format == other.color_format &&
+           depth_format == other.depth_format && subpass == other.subpass;
+  }
+
   Pipeline::Pipeline(Device&               device,
                      const std::string&    vertex_path,
                      const std::string&    fragment_path,
                      const PipelineConfig& config)
-      : pDevice {device} {
-    auto vert_code = pReadFile(vertex_path);
-    auto frag_code = pReadFile(fragment_path);
+      : pDevice {device}, pId {NextPipelineId()}, pOwnsShaderModules {true} {
+    auto vert_code = ReadFile(vertex_path);
+    auto frag_code = ReadFile(fragment_path);
 
     pCreateShaderModule(vert_code, &pVertShaderModule);
     pCreateShaderModule(frag_code, &pFragShaderModule);
 
+    pCreateGraphicsPipeline(config);
+  }
+
+  Pipeline::Pipeline(Device&               device,
+                     VkShaderModule        vertex_module,
+                     VkShaderModule        fragment_module,
+                     const PipelineConfig& config)
+      : pDevice {device},
+        pId {NextPipelineId()},
+        pVertShaderModule {vertex_module},
+        pFragShaderModule {fragment_module},
+        pOwnsShaderModules {false} {
+    pCreateGraphicsPipeline(config);
+  }
+
+  void Pipeline::pCreateGraphicsPipeline(const PipelineConfig& config) {
+    SVKE_PROFILE_SCOPE("Pipeline::CreateGraphicsPipeline");
+
     VkPipelineShaderStageCreateInfo shader_stages[2];
 
     shader_stages[0].sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -36,8 +213,8 @@ namespace svke {
     shader_stages[1].pNext               = nullptr;
     shader_stages[1].pSpecializationInfo = nullptr;
 
-    auto binding_descriptions   = Model::Vertex::getBindings();
-    auto attribute_descriptions = Model::Vertex::getAtributes();
+    const auto& binding_descriptions   = config.binding_descriptions;
+    const auto& attribute_descriptions = config.attribute_descriptions;
 
     VkPipelineVertexInputStateCreateInfo vertex_input_info {};
 
@@ -68,15 +245,18 @@ namespace svke {
     pipeline_info.basePipelineHandle = VK_NULL_HANDLE;  // Optional
     pipeline_info.basePipelineIndex  = -1;              // Optional
 
-    if (vkCreateGraphicsPipelines(device.getDevice(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pGraphicsPipeline) !=
-        VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(
+            pDevice.getDevice(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pGraphicsPipeline) != VK_SUCCESS) {
       throw std::runtime_error("Pipeline creation failed");
     }
   }
 
   Pipeline::~Pipeline() {
-    vkDestroyShaderModule(pDevice.getDevice(), pVertShaderModule, nullptr);
-    vkDestroyShaderModule(pDevice.getDevice(), pFragShaderModule, nullptr);
+    if (pOwnsShaderModules) {
+      vkDestroyShaderModule(pDevice.getDevice(), pVertShaderModule, nullptr);
+      vkDestroyShaderModule(pDevice.getDevice(), pFragShaderModule, nullptr);
+    }
+
     vkDestroyPipeline(pDevice.getDevice(), pGraphicsPipeline, nullptr);
   }
 
@@ -151,9 +331,12 @@ namespace svke {
     config.dynamic_state_info.pDynamicStates    = config.dynamic_state_enables.data();
     config.dynamic_state_info.dynamicStateCount = static_cast<uint32_t>(config.dynamic_state_enables.size());
     config.dynamic_state_info.flags             = 0;
+
+    config.binding_descriptions   = Model::Vertex::getBindings();
+    config.attribute_descriptions = Model::Vertex::getAtributes();
   }
 
-  std::vector<char> Pipeline::pReadFile(const std::string& path) {
+  std::vector<char> Pipeline::ReadFile(const std::string& path) {
     std::ifstream file {path, std::ios::ate | std::ios::binary};
 
     if (!file.is_open()) {
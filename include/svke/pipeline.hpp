@@ -10,26 +10,120 @@ namespace svke {
     PipelineConfig(const PipelineConfig&) = delete;
     PipelineConfig& operator=(const PipelineConfig&) = delete;
 
-    VkPipelineViewportStateCreateInfo      create_info;
-    VkPipelineInputAssemblyStateCreateInfo input_assembly_info;
-    VkPipelineRasterizationStateCreateInfo rasterization_info;
-    VkPipelineMultisampleStateCreateInfo   multisample_info;
-    VkPipelineColorBlendAttachmentState    colorblend_attachment;
-    VkPipelineColorBlendStateCreateInfo    colorblend_info;
-    VkPipelineDepthStencilStateCreateInfo  depth_stencil_info;
-    VkPipelineLayout                       pipeline_layout = nullptr;
-    VkRenderPass                           render_pass     = nullptr;
-    uint32_t                               subpass         = 0;
-    std::vector<VkDynamicState>            dynamic_state_enables;
-    VkPipelineDynamicStateCreateInfo       dynamic_state_info;
+    VkPipelineViewportStateCreateInfo              create_info;
+    VkPipelineInputAssemblyStateCreateInfo         input_assembly_info;
+    VkPipelineRasterizationStateCreateInfo         rasterization_info;
+    VkPipelineMultisampleStateCreateInfo           multisample_info;
+    VkPipelineColorBlendAttachmentState            colorblend_attachment;
+    VkPipelineColorBlendStateCreateInfo            colorblend_info;
+    VkPipelineDepthStencilStateCreateInfo          depth_stencil_info;
+    std::vector<VkVertexInputBindingDescription>   binding_descriptions;
+    std::vector<VkVertexInputAttributeDescription> attribute_descriptions;
+    VkPipelineLayout                               pipeline_layout = nullptr;
+    VkRenderPass                                   render_pass     = nullptr;
+    uint32_t                                       subpass         = 0;
+    std::vector<VkDynamicState>                    dynamic_state_enables;
+    VkPipelineDynamicStateCreateInfo               dynamic_state_info;
+
+    // Attachment formats of render_pass, used to match compatible render passes. When left undefined pipelines are
+    // only shared between users of the exact same render pass handle.
+    VkFormat color_format = VK_FORMAT_UNDEFINED;
+    VkFormat depth_format = VK_FORMAT_UNDEFINED;
+  };
+
+  // Canonical, copyable description of everything vkCreateGraphicsPipelines reads from a PipelineConfig. Two configs
+  // that produce an equal description produce interchangeable pipelines. Extension chains (pNext) and non zero create
+  // flags are not captured and are rejected by FromConfig.
+  struct PipelineDescription {
+    // Fixed function state. Every member is 32 bits wide so the struct has no padding and is hashed and compared
+    // bytewise, which also keeps float fields consistent between Hash and operator==.
+    struct FixedState {
+      VkPrimitiveTopology topology;
+      VkBool32            primitive_restart;
+
+      uint32_t viewport_count;
+      uint32_t scissor_count;
+
+      VkBool32        depth_clamp;
+      VkBool32        rasterizer_discard;
+      VkPolygonMode   polygon_mode;
+      VkCullModeFlags cull_mode;
+      VkFrontFace     front_face;
+      VkBool32        depth_bias;
+      float           depth_bias_constant;
+      float           depth_bias_clamp;
+      float           depth_bias_slope;
+      float           line_width;
+
+      VkSampleCountFlagBits samples;
+      VkBool32              sample_shading;
+      float                 min_sample_shading;
+      VkBool32              alpha_to_coverage;
+      VkBool32              alpha_to_one;
+
+      VkBool32  logic_op_enable;
+      VkLogicOp logic_op;
+      float     blend_constants[4];
+
+      VkBool32         depth_test;
+      VkBool32         depth_write;
+      VkCompareOp      depth_compare;
+      VkBool32         depth_bounds_test;
+      float            min_depth_bounds;
+      float            max_depth_bounds;
+      VkBool32         stencil_test;
+      VkStencilOpState stencil_front;
+      VkStencilOpState stencil_back;
+    };
+
+    std::string vertex_path;
+    std::string fragment_path;
+
+    std::vector<VkVertexInputBindingDescription>     binding_descriptions;
+    std::vector<VkVertexInputAttributeDescription>   attribute_descriptions;
+    std::vector<VkDynamicState>                      dynamic_states;
+    std::vector<VkPipelineColorBlendAttachmentState> blend_attachments;
+    std::vector<VkSampleMask>                        sample_mask;
+
+    // Only filled when the matching dynamic state is not enabled, otherwise the values are ignored by Vulkan
+    std::vector<VkViewport> viewports;
+    std::vector<VkRect2D>   scissors;
+
+    FixedState state;
+
+    VkPipelineLayout pipeline_layout;
+    VkRenderPass     render_pass;
+    VkFormat         color_format;
+    VkFormat         depth_format;
+    uint32_t         subpass;
+
+    static PipelineDescription FromConfig(const std::string&    vertex_path,
+                                          const std::string&    fragment_path,
+                                          const PipelineConfig& config);
+
+    uint64_t Hash() const;
+    bool     operator==(const PipelineDescription& other) const;
+  };
+
+  struct PipelineDescriptionHash {
+    size_t operator()(const PipelineDescription& description) const {
+      return static_cast<size_t>(description.Hash());
+    }
   };
 
   class Pipeline {
+   public:
+    using id_t = uint32_t;
+
    public:
     Pipeline(Device&               device,
              const std::string&    vertex_path,
              const std::string&    fragment_path,
              const PipelineConfig& config);
+    Pipeline(Device&               device,
+             VkShaderModule        vertex_module,
+             VkShaderModule        fragment_module,
+             const PipelineConfig& config);
     ~Pipeline();
 
     Pipeline(const Pipeline& other) = delete;
@@ -37,18 +131,24 @@ namespace svke {
 
     void Bind(VkCommandBuffer command_buffer);
 
-    static void DefaultPipelineConfig(PipelineConfig& config);
+    VkPipeline getPipeline() const { return pGraphicsPipeline; }
+    id_t       getId() const { return pId; }
+
+    static void              DefaultPipelineConfig(PipelineConfig& config);
+    static std::vector<char> ReadFile(const std::string& path);
 
    private:
-    static std::vector<char> pReadFile(const std::string& path);
-    void                     pCreateShaderModule(const std::vector<char>& code, VkShaderModule* shader_module);
+    void pCreateShaderModule(const std::vector<char>& code, VkShaderModule* shader_module);
+    void pCreateGraphicsPipeline(const PipelineConfig& config);
 
    private:
     Device&        pDevice;
+    id_t           pId;
     VkPipeline     pGraphicsPipeline;
     VkShaderModule pVertShaderModule;
     VkShaderModule pFragShaderModule;
+    bool           pOwnsShaderModules;
   };
 }
 
-#endif
\ No newline at end of file
+#endif
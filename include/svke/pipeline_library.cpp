@@ -0,0 +1,113 @@
+#include "pipeline_library.hpp"
+
+#include "defines.hpp"
+#include "pch.hpp"
+#include "profiler.hpp"
+
+namespace svke {
+  PipelineLibrary::PipelineLibrary(Device& device) : pDevice {device} {}
+
+  PipelineLibrary::~PipelineLibrary() {
+#ifdef SVKE_VERBOSE_PIPELINE_LIBRARY
+    std::cout << "Pipeline library: " << pPipelines.size() << " pipelines (" << pStats.pipeline_hits << " hits, "
+              << pStats.pipeline_misses << " misses), " << pShaderModules.size() << " shader modules ("
+              << pStats.shader_module_hits << " hits, " << pStats.shader_module_misses << " misses)" << std::endl;
+#endif
+
+    pPipelines.clear();
+
+    for (auto& [path, shader_module] : pShaderModules) {
+      vkDestroyShaderModule(pDevice.getDevice(), shader_module, nullptr);
+    }
+
+    for (auto& [key, pipeline_layout] : pPipelineLayouts) {
+      vkDestroyPipelineLayout(pDevice.getDevice(), pipeline_layout, nullptr);
+    }
+  }
+
+  Pipeline* PipelineLibrary::GetPipeline(const std::string&    vertex_path,
+                                         const std::string&    fragment_path,
+                                         const PipelineConfig& config) {
+    PipelineDescription description = PipelineDescription::FromConfig(vertex_path, fragment_path, config);
+
+    auto found = pPipelines.find(description);
+
+    if (found != pPipelines.end()) {
+      pStats.pipeline_hits++;
+      return found->second.get();
+    }
+
+    pStats.pipeline_misses++;
+
+    auto pipeline = std::make_unique<Pipeline>(
+        pDevice, GetShaderModule(vertex_path), GetShaderModule(fragment_path), config);
+
+    return pPipelines.emplace(std::move(description), std::move(pipeline)).first->second.get();
+  }
+
+  VkShaderModule PipelineLibrary::GetShaderModule(const std::string& path) {
+    auto found = pShaderModules.find(path);
+
+    if (found != pShaderModules.end()) {
+      pStats.shader_module_hits++;
+      return found->second;
+    }
+
+    pStats.shader_module_misses++;
+
+    SVKE_PROFILE_SCOPE("PipelineLibrary::LoadShaderModule");
+
+    auto code = Pipeline::ReadFile(path);
+
+    VkShaderModuleCreateInfo create_info {};
+
+    create_info.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    create_info.codeSize = code.size();
+    create_info.pCode    = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule shader_module;
+
+    if (vkCreateShaderModule(pDevice.getDevice(), &create_info, nullptr, &shader_module) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create shader module");
+    }
+
+    pShaderModules.emplace(path, shader_module);
+    return shader_module;
+  }
+
+  VkPipelineLayout PipelineLibrary::GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& set_layouts,
+                                                      const std::vector<VkPushConstantRange>&   push_constant_ranges) {
+    std::string key;
+
+    key.append(reinterpret_cast<const char*>(set_layouts.data()), set_layouts.size() * sizeof(VkDescriptorSetLayout));
+    key.push_back('|');
+    key.append(reinterpret_cast<const char*>(push_constant_ranges.data()),
+               push_constant_ranges.size() * sizeof(VkPushConstantRange));
+
+    auto found = pPipelineLayouts.find(key);
+
+    if (found != pPipelineLayouts.end()) {
+      pStats.pipeline_layout_hits++;
+      return found->second;
+    }
+
+    pStats.pipeline_layout_misses++;
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info {};
+
+    pipeline_layout_info.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount         = static_cast<uint32_t>(set_layouts.size());
+    pipeline_layout_info.pSetLayouts            = set_layouts.data();
+    pipeline_layout_info.pushConstantRangeCount = static_cast<uint32_t>(push_constant_ranges.size());
+    pipeline_layout_info.pPushConstantRanges    = push_constant_ranges.data();
+
+    VkPipelineLayout pipeline_layout;
+
+    if (vkCreatePipelineLayout(pDevice.getDevice(), &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create pipeline layout");
+    }
+
+    pPipelineLayouts.emplace(std::move(key), pipeline_layout);
+    return pipeline_layout;
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef SVKE_PIPELINE_LIBRARY_HPP
+#define SVKE_PIPELINE_LIBRARY_HPP
+
+#include "defines.hpp"
+#include "device.hpp"
+#include "pch.hpp"
+#include "pipeline.hpp"
+
+namespace svke {
+  struct PipelineLibraryStats {
+    uint64_t pipeline_hits          = 0;
+    uint64_t pipeline_misses        = 0;
+    uint64_t shader_module_hits     = 0;
+    uint64_t shader_module_misses   = 0;
+    uint64_t pipeline_layout_hits   = 0;
+    uint64_t pipeline_layout_misses = 0;
+  };
+
+  // Owns every pipeline, pipeline layout and shader module created through it. Requests that resolve to the same
+  // PipelineDescription get the same Pipeline back, and shader modules are shared between all pipelines using them.
+  class PipelineLibrary {
+   public:
+    PipelineLibrary(Device& device);
+    ~PipelineLibrary();
+
+    PipelineLibrary(const PipelineLibrary& other) = delete;
+    PipelineLibrary& operator=(const PipelineLibrary& other) = delete;
+
+   public:
+    Pipeline*        GetPipeline(const std::string&    vertex_path,
+                                 const std::string&    fragment_path,
+                                 const PipelineConfig& config);
+    VkShaderModule   GetShaderModule(const std::string& path);
+    VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& set_layouts,
+                                       const std::vector<VkPushConstantRange>&   push_constant_ranges);
+
+    const PipelineLibraryStats& getStats() const { return pStats; }
+    uint64_t                    getPipelineCount() const { return pPipelines.size(); }
+
+   private:
+    Device&              pDevice;
+    PipelineLibraryStats pStats {};
+
+    std::unordered_map<PipelineDescription, std::unique_ptr<Pipeline>, PipelineDescriptionHash> pPipelines;
+    std::unordered_map<std::string, VkShaderModule>                                             pShaderModules;
+    std::unordered_map<std::string, VkPipelineLayout>                                           pPipelineLayouts;
+  };
+}
+
+#endif
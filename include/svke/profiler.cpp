@@ -0,0 +1,152 @@
+#include "profiler.hpp"
+
+#include "defines.hpp"
+#include "pch_core.hpp"
+
+namespace svke {
+  std::atomic<bool>                                    Profiler::pRecording {false};
+  const Profiler::clock::time_point                    Profiler::pEpoch = Profiler::clock::now();
+  std::mutex                                           Profiler::pMutex;
+  std::vector<std::unique_ptr<Profiler::ThreadBuffer>> Profiler::pThreadBuffers;
+  std::vector<uint64_t>                                Profiler::pFrameTimes;
+  uint32_t                                             Profiler::pFramesLeft {0};
+  std::string                                          Profiler::pPath;
+  thread_local Profiler::ThreadBuffer*                 Profiler::pCurrentBuffer {nullptr};
+
+  static std::string EscapeJson(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+
+    for (char c : value) {
+      if (c == '"' || c == '\\') {
+        escaped += '\\';
+      }
+
+      escaped += c;
+    }
+
+    return escaped;
+  }
+
+  void Profiler::BeginCapture(uint32_t frame_count, const std::string& path) {
+    if (frame_count == 0) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    if (pRecording.load(std::memory_order_relaxed)) {
+      return;
+    }
+
+    for (auto& buffer : pThreadBuffers) {
+      buffer->count.store(0, std::memory_order_relaxed);
+    }
+
+    pFrameTimes.clear();
+    pFrameTimes.push_back(Now());
+    pFramesLeft = frame_count;
+    pPath       = path;
+
+    pRecording.store(true, std::memory_order_release);
+  }
+
+  void Profiler::MarkFrame() {
+    if (!IsRecording()) {
+      return;
+    }
+
+    bool finished;
+
+    {
+      std::lock_guard<std::mutex> lock {pMutex};
+
+      pFrameTimes.push_back(Now());
+      finished = --pFramesLeft == 0;
+    }
+
+    if (finished) {
+      pEndCapture();
+    }
+  }
+
+  void Profiler::SetThreadName(const std::string& name) {
+    ThreadBuffer* buffer = pGetThreadBuffer();
+
+    std::lock_guard<std::mutex> lock {pMutex};
+    buffer->name = name;
+  }
+
+  void Profiler::Record(const char* name, uint64_t start_ns, uint64_t end_ns) {
+    ThreadBuffer* buffer = pGetThreadBuffer();
+    uint64_t      index  = buffer->count.load(std::memory_order_relaxed);
+
+    // Only the owning thread writes, the release publishes the event to pEndCapture
+    buffer->events[index % RING_CAPACITY] = {name, start_ns, end_ns};
+    buffer->count.store(index + 1, std::memory_order_release);
+  }
+
+  Profiler::ThreadBuffer* Profiler::pGetThreadBuffer() {
+    if (pCurrentBuffer == nullptr) {
+      auto buffer = std::make_unique<ThreadBuffer>();
+      buffer->events.resize(RING_CAPACITY);
+
+      std::lock_guard<std::mutex> lock {pMutex};
+
+      buffer->thread_id = static_cast<uint32_t>(pThreadBuffers.size());
+      buffer->name      = "Thread " + std::to_string(buffer->thread_id);
+      pCurrentBuffer    = buffer.get();
+
+      // Owned here rather than by the thread, so the events of threads that already exited still make it out
+      pThreadBuffers.push_back(std::move(buffer));
+    }
+
+    return pCurrentBuffer;
+  }
+
+  void Profiler::pEndCapture() {
+    pRecording.store(false, std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    std::ofstream file {pPath, std::ios::trunc};
+
+    if (!file.is_open()) {
+      std::cerr << "Failed to write profile capture to " << pPath << std::endl;
+      return;
+    }
+
+    // Chrome trace event format, timestamps are in microseconds
+    file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"svke\"}}";
+
+    uint64_t event_count = 0;
+
+    for (const auto& buffer : pThreadBuffers) {
+      file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread_id
+           << ",\"args\":{\"name\":\"" << EscapeJson(buffer->name) << "\"}}";
+
+      uint64_t count = buffer->count.load(std::memory_order_acquire);
+      uint64_t first = count > RING_CAPACITY ? count - RING_CAPACITY : 0;
+
+      for (uint64_t i = first; i < count; i++) {
+        const ProfileEvent& event = buffer->events[i % RING_CAPACITY];
+
+        file << ",\n{\"name\":\"" << EscapeJson(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_id
+             << ",\"ts\":" << event.start_ns / 1000.0 << ",\"dur\":" << (event.end_ns - event.start_ns) / 1000.0 << "}";
+      }
+
+      event_count += count - first;
+    }
+
+    for (size_t frame = 0; frame < pFrameTimes.size(); frame++) {
+      file << ",\n{\"name\":\"Frame " << frame << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":"
+           << pFrameTimes[frame] / 1000.0 << "}";
+    }
+
+    file << "\n]}\n";
+
+    std::cout << "Wrote " << event_count << " profile events over " << pFrameTimes.size() - 1 << " frames to " << pPath
+              << std::endl;
+  }
+}
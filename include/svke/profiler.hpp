@@ -0,0 +1,93 @@
+#ifndef SVKE_PROFILER_HPP
+#define SVKE_PROFILER_HPP
+
+#include "defines.hpp"
+#include "pch_core.hpp"
+
+namespace svke {
+  struct ProfileEvent {
+    const char* name;  // Must outlive the capture, string literals in practice
+    uint64_t    start_ns;
+    uint64_t    end_ns;
+  };
+
+  // Records scoped zones into per thread ring buffers while a capture runs and writes the captured frames to a Chrome
+  // trace event file, which chrome://tracing and Perfetto open. Outside of a capture a zone costs one relaxed atomic
+  // load, and defining SVKE_DISABLE_PROFILER compiles the zones out altogether.
+  class Profiler {
+   public:
+    using clock = std::chrono::steady_clock;
+
+    // Events per thread, older events of a capture are overwritten once a thread records more
+    static constexpr uint32_t RING_CAPACITY = 1 << 15;
+
+   public:
+    Profiler() = delete;
+
+   public:
+    static bool IsRecording() { return pRecording.load(std::memory_order_relaxed); }
+
+    // Starts recording, the trace is written to path once frame_count frames have been marked. Ignored while a
+    // capture is already running.
+    static void BeginCapture(uint32_t frame_count, const std::string& path);
+
+    // Called once per frame by the main loop, finishes the capture when enough frames have been recorded
+    static void MarkFrame();
+
+    static void SetThreadName(const std::string& name);
+    static void Record(const char* name, uint64_t start_ns, uint64_t end_ns);
+
+    static uint64_t Now() {
+      return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - pEpoch).count());
+    }
+
+   private:
+    struct ThreadBuffer {
+      uint32_t                  thread_id;
+      std::string               name;
+      std::vector<ProfileEvent> events;
+      std::atomic<uint64_t>     count {0};
+    };
+
+    static ThreadBuffer* pGetThreadBuffer();
+    static void          pEndCapture();
+
+   private:
+    static std::atomic<bool>                          pRecording;
+    static const clock::time_point                    pEpoch;
+    static std::mutex                                 pMutex;
+    static std::vector<std::unique_ptr<ThreadBuffer>> pThreadBuffers;
+    static std::vector<uint64_t>                      pFrameTimes;
+    static uint32_t                                   pFramesLeft;
+    static std::string                                pPath;
+    static thread_local ThreadBuffer*                 pCurrentBuffer;
+  };
+
+  class ProfileScope {
+   public:
+    explicit ProfileScope(const char* name) : pName {name}, pStart {Profiler::IsRecording() ? Profiler::Now() : 0} {}
+    ~ProfileScope() {
+      if (pStart != 0 && Profiler::IsRecording()) {
+        Profiler::Record(pName, pStart, Profiler::Now());
+      }
+    }
+
+    ProfileScope(const ProfileScope& other) = delete;
+    ProfileScope& operator=(const ProfileScope& other) = delete;
+
+   private:
+    const char* pName;
+    uint64_t    pStart;
+  };
+}
+
+#define SVKE_PROFILE_CONCAT_INNER(a, b) a##b
+#define SVKE_PROFILE_CONCAT(a, b)       SVKE_PROFILE_CONCAT_INNER(a, b)
+
+#ifndef SVKE_DISABLE_PROFILER
+#  define SVKE_PROFILE_SCOPE(name) ::svke::ProfileScope SVKE_PROFILE_CONCAT(svke_profile_scope_, __LINE__)(name)
+#else
+#  define SVKE_PROFILE_SCOPE(name)
+#endif
+
+#endif
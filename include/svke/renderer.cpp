@@ -1,9 +1,11 @@
 #include "defines.hpp"
 #include "pch.hpp"
+#include "profiler.hpp"
 #include "renderer.hpp"
 
 namespace svke {
-  Renderer::Renderer(Window& window, Device& device) : pWindow {window}, pDevice {device} {
+  Renderer::Renderer(Window& window, Device& device, const SwapChainConfig& config)
+      : pWindow {window}, pDevice {device}, pConfig {config} {
     pRecreateSwapChain();
     pCreateCommandBuffers();
   }
@@ -11,7 +13,7 @@ namespace svke {
   Renderer::~Renderer() { pFreeCommandBuffers(); }
 
   void Renderer::pCreateCommandBuffers() {
-    pCommandBuffer.resize(MAX_FRAMES_IN_FLIGHT);
+    pCommandBuffer.resize(pConfig.frames_in_flight);
 
     VkCommandBufferAllocateInfo alloc_info {};
 
@@ -41,16 +43,72 @@ namespace svke {
       glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(pDevice.getDevice());
+    pWindow.ResetResize();
+    pRecreatePending = false;
 
     if (pSwapChain == nullptr) {
-      pSwapChain = std::make_unique<SwapChain>(pDevice, extent);
+      pSwapChain = std::make_unique<SwapChain>(pDevice, extent, pConfig);
+      pLatencyProbe.Resize(pConfig.frames_in_flight);
+      pHiZPyramid.Resize(*pSwapChain, pConfig.frames_in_flight);
+
+      return;
+    }
+
+    // With the same frame count the new swap chain takes over the frame sync objects and rendering carries on, the old
+    // one is destroyed once every frame submitted to it has completed. Otherwise the frames cannot be tracked across.
+    bool keep_rendering = pSwapChain->getFramesInFlight() == pConfig.frames_in_flight && !pWaitIdleOnRecreate;
+
+    if (!keep_rendering) {
+      pDevice.WaitIdle();
+      pDevice.RetireFrameValue(pDevice.getFrameValue() - 1);
+    }
+
+    std::shared_ptr<SwapChain> old_swapchain = std::move(pSwapChain);
+    pSwapChain                               = std::make_unique<SwapChain>(pDevice, extent, pConfig, old_swapchain);
+
+    if (!old_swapchain->CompareSwapFormats(*pSwapChain.get())) {
+      throw std::runtime_error("Swapchain image or depth format has changed");
+    }
+
+    if (keep_rendering) {
+      pDevice.DeferDestroy([swap_chain = std::move(old_swapchain)]() mutable { swap_chain.reset(); });
     } else {
-      std::shared_ptr<SwapChain> old_swapchain = std::move(pSwapChain);
-      pSwapChain                               = std::make_unique<SwapChain>(pDevice, extent, old_swapchain);
+      pLatencyProbe.Resize(pConfig.frames_in_flight);
+      pGpuProfiler.Resize(pConfig.frames_in_flight);
+    }
+
+    // The pyramid matches the new extent and depth images, frames in flight keep building the old one
+    pHiZPyramid.Resize(*pSwapChain, pConfig.frames_in_flight);
+
+    pCurrentFrameIndex = pSwapChain->getCurrentFrame();
+  }
+
+  void Renderer::SetSwapChainConfig(const SwapChainConfig& config) {
+    assert(!pIsFrameStarted && "Cannot change the swap chain configuration while a frame is in progress");
+
+    if (config.frames_in_flight == 0) {
+      throw std::runtime_error("A swap chain needs at least one frame in flight");
+    }
+
+    if (config == pConfig) {
+      return;
+    }
+
+    bool frame_count_changed = config.frames_in_flight != pConfig.frames_in_flight;
+    pConfig                  = config;
+
+    pRecreateSwapChain();
+
+    if (frame_count_changed) {
+      pFreeCommandBuffers();
+      pCreateCommandBuffers();
+    }
+  }
 
-      if (!old_swapchain->CompareSwapFormats(*pSwapChain.get())) {
-        throw std::runtime_error("Swapchain image or depth format has changed");
+  void Renderer::pPollLatency() {
+    for (uint32_t frame = 0; frame < pConfig.frames_in_flight; frame++) {
+      if (pLatencyProbe.IsPending(frame) && pSwapChain->IsFrameComplete(frame)) {
+        pLatencyProbe.MarkGpuComplete(frame);
       }
     }
   }
@@ -58,8 +116,24 @@ namespace svke {
   VkCommandBuffer Renderer::BeginFrame() {
     assert(!pIsFrameStarted && "Cannot begin frame with one already in progress");
 
+    SVKE_PROFILE_SCOPE("Renderer::BeginFrame");
+
+    if (pRecreatePending && (pWaitIdleOnRecreate || pWindow.getTimeSinceResize() >= RESIZE_DEBOUNCE)) {
+      pRecreateSwapChain();
+    }
+
+    pPollLatency();
+    pDevice.PollUploads();
+
     VkResult result = pSwapChain->AcquireNextImage(&pCurrentImageIndex);
 
+    // Acquiring waited for this slot, so the frame recorded frames_in_flight frames ago has completed
+    pLatencyProbe.MarkGpuComplete(pCurrentFrameIndex);
+
+    // With a timeline semaphore this may also retire frames that finished after the slot's own
+    uint64_t frame_value = pDevice.getFrameValue();
+    pDevice.RetireCompletedFrames(frame_value > pConfig.frames_in_flight ? frame_value - pConfig.frames_in_flight : 0);
+
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
       pRecreateSwapChain();
       return nullptr;
@@ -78,27 +152,46 @@ namespace svke {
       throw std::runtime_error("Failed to begin recording command buffer");
     }
 
+    pGpuProfiler.BeginFrame(pCommandBuffer[pCurrentFrameIndex], pCurrentFrameIndex);
+    pHiZPyramid.BeginFrame(pCurrentFrameIndex);
+
     return pCommandBuffer[pCurrentFrameIndex];
   }
 
   void Renderer::EndFrame() {
     assert(pIsFrameStarted && "Cannot end a frame without one being started");
 
+    SVKE_PROFILE_SCOPE("Renderer::EndFrame");
+
     if (vkEndCommandBuffer(pCommandBuffer[pCurrentFrameIndex]) != VK_SUCCESS) {
       throw std::runtime_error("Failed to record command buffer");
     }
 
-    auto result = pSwapChain->SubmitCommandBuffers(&pCommandBuffer[pCurrentFrameIndex], &pCurrentImageIndex);
+    // Uploads recorded so far go to the queue first, so whatever this frame draws has finished copying. On a dedicated
+    // transfer queue the frame waits on the upload timeline instead, before every stage that can read an uploaded
+    // buffer or image: indirect arguments, vertex and index input, any shader, and copies out of uploaded resources.
+    // Render pass clears, depth testing and color output never read uploads and may start early.
+    std::vector<TimelineWait> timeline_waits = pDevice.SubmitUploads(
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT);
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || pWindow.WasResized()) {
-      pWindow.ResetResize();
+    auto result =
+        pSwapChain->SubmitCommandBuffers(&pCommandBuffer[pCurrentFrameIndex], &pCurrentImageIndex, timeline_waits);
+
+    pLatencyProbe.MarkPresented(pCurrentFrameIndex);
+    pDevice.AdvanceFrameValue();
+
+    pIsFrameStarted    = false;
+    pCurrentFrameIndex = (pCurrentFrameIndex + 1) % pConfig.frames_in_flight;
+
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
       pRecreateSwapChain();
+    } else if (result == VK_SUBOPTIMAL_KHR || pWindow.WasResized()) {
+      // A suboptimal swap chain can still present, wait for the resize to settle in BeginFrame
+      pRecreatePending = true;
     } else if (result != VK_SUCCESS) {
       throw std::runtime_error("Failed to present swap chain image");
     }
-
-    pIsFrameStarted    = false;
-    pCurrentFrameIndex = (pCurrentFrameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
   }
 
   void Renderer::BeginSwapChainRenderPass(VkCommandBuffer command_buffer) {
@@ -122,6 +215,9 @@ namespace svke {
     render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
     render_pass_info.pClearValues    = clear_values.data();
 
+    // Timestamps only, so that the render systems inside can take pipeline statistics
+    pPassScope = pGpuProfiler.BeginScope(command_buffer, "Swap chain pass", false);
+
     vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
 
     VkViewport viewport {};
@@ -148,5 +244,13 @@ namespace svke {
            "Cannot end swapchain render pass on commadn buffer of a different frame");
 
     vkCmdEndRenderPass(command_buffer);
+
+    pGpuProfiler.EndScope(command_buffer, pPassScope);
+    pPassScope = GpuProfiler::NO_SCOPE;
+
+    if (pHiZPyramid.IsEnabled()) {
+      GpuScope gpu_scope {pGpuProfiler, command_buffer, "Hi-Z pyramid", false};
+      pHiZPyramid.Record(command_buffer, pCurrentImageIndex);
+    }
   }
 }
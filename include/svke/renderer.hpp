@@ -3,6 +3,9 @@
 
 #include "defines.hpp"
 #include "device.hpp"
+#include "gpu_profiler.hpp"
+#include "hi_z_pyramid.hpp"
+#include "latency_probe.hpp"
 #include "pch.hpp"
 #include "swap_chain.hpp"
 #include "window.hpp"
@@ -10,7 +13,12 @@
 namespace svke {
   class Renderer {
    public:
-    Renderer(Window &window, Device &device);
+    // Resizes recreate the swap chain once no resize event arrived for this long, an out of date swap chain is always
+    // recreated right away
+    static constexpr std::chrono::milliseconds RESIZE_DEBOUNCE {50};
+
+   public:
+    Renderer(Window &window, Device &device, const SwapChainConfig &config = {});
     ~Renderer();
 
     Renderer(const Renderer &other) = delete;
@@ -20,28 +28,53 @@ namespace svke {
     bool         isFrameInProgress() const { return pIsFrameStarted; }
     float        getAspectRatio() const { return pSwapChain->getExtentAspectRatio(); }
     VkRenderPass getSwapChainRenderPass() const { return pSwapChain->getRenderPass(); }
+    VkFormat     getSwapChainImageFormat() const { return pSwapChain->getSwapChainImageFormat(); }
+    VkFormat     getSwapChainDepthFormat() const { return pSwapChain->getSwapChainDepthFormat(); }
+
+    const SwapChainConfig &getSwapChainConfig() const { return pConfig; }
+    uint32_t               getFramesInFlight() const { return pConfig.frames_in_flight; }
+    LatencyProbe &         getLatencyProbe() { return pLatencyProbe; }
+    GpuProfiler &          getGpuProfiler() { return pGpuProfiler; }
+    HiZPyramid &           getHiZPyramid() { return pHiZPyramid; }
 
    public:
     VkCommandBuffer BeginFrame();
     void            EndFrame();
     void            BeginSwapChainRenderPass(VkCommandBuffer command_buffer);
-    void            EndSwapChainRenderPass(VkCommandBuffer command_buffer);
+    void            EndSwapChainRenderPass(VkCommandBuffer command_buffer);  // Also builds the Hi-Z pyramid
+
+    // Rebuilds the swap chain, and the per frame command buffers when the frame count changes. Only between frames.
+    void SetSwapChainConfig(const SwapChainConfig &config);
+
+    // Called once input for the next frame has been sampled, starts that frame's latency measurement
+    void MarkInputSampled() { pLatencyProbe.MarkInputSampled(); }
+
+    // Drain the device and recreate on every resize event instead, only kept to compare against
+    void SetWaitIdleOnRecreate(bool wait_idle) { pWaitIdleOnRecreate = wait_idle; }
 
    private:
     void pCreateCommandBuffers();
     void pFreeCommandBuffers();
     void pRecreateSwapChain();
+    void pPollLatency();
 
    private:
     Window &                     pWindow;
     Device &                     pDevice;
+    SwapChainConfig              pConfig;
     std::unique_ptr<SwapChain>   pSwapChain;
     std::vector<VkCommandBuffer> pCommandBuffer;
+    LatencyProbe                 pLatencyProbe;
+    GpuProfiler                  pGpuProfiler {pDevice, pConfig.frames_in_flight};
+    HiZPyramid                   pHiZPyramid {pDevice, pConfig.frames_in_flight};
 
    private:
     uint32_t pCurrentImageIndex {0};
     uint32_t pCurrentFrameIndex {0};
+    uint32_t pPassScope {GpuProfiler::NO_SCOPE};
     bool     pIsFrameStarted {false};
+    bool     pRecreatePending {false};
+    bool     pWaitIdleOnRecreate {false};
   };
 }  // namespace svke
 
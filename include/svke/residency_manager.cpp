@@ -0,0 +1,248 @@
+#include "residency_manager.hpp"
+
+#include "defines.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  ResidencyManager::ResidencyManager(Device& device, VkDeviceSize budget) : pDevice {device}, pBudget {budget} {}
+
+  ResidencyManager::~ResidencyManager() {
+    for (auto& entry : pEntries) {
+      if (entry.registered && entry.level != NOT_RESIDENT) {
+        pEvict(entry);
+      }
+    }
+  }
+
+  ResidencyHandle ResidencyManager::Register(ResidencyDescription description, uint32_t level) {
+    assert(!description.level_sizes.empty() && "A resource needs at least one level");
+    assert((level == NOT_RESIDENT || level < description.level_sizes.size()) && "Level out of range");
+
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    ResidencyHandle handle;
+
+    if (!pFreeHandles.empty()) {
+      handle = pFreeHandles.back();
+      pFreeHandles.pop_back();
+    } else {
+      handle = static_cast<ResidencyHandle>(pEntries.size());
+      pEntries.emplace_back();
+    }
+
+    pEntries[handle]             = {};
+    pEntries[handle].description = std::move(description);
+    pEntries[handle].registered  = true;
+
+    if (level != NOT_RESIDENT) {
+      pEntries[handle].level     = level;
+      pEntries[handle].last_used = pDevice.getFrameValue();
+
+      pResidentBytes += pEntries[handle].description.level_sizes[level];
+      pStats.resident_count++;
+    }
+
+    return handle;
+  }
+
+  void ResidencyManager::Unregister(ResidencyHandle handle) {
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    Entry& entry = pEntries[handle];
+
+    if (entry.level != NOT_RESIDENT) {
+      pEvict(entry);
+    }
+
+    entry = {};
+    pFreeHandles.push_back(handle);
+  }
+
+  void ResidencyManager::Touch(ResidencyHandle handle) {
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    Entry& entry    = pEntries[handle];
+    entry.last_used = pDevice.getFrameValue();
+
+    if (entry.level == NOT_RESIDENT && !entry.requested) {
+      entry.requested = true;
+      pRequests.push_back(handle);
+    }
+  }
+
+  void ResidencyManager::Update() {
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    VkDeviceSize budget = pComputeBudget();
+
+    pEvictUntil(budget);
+
+    // Requests are served in order, one that does not fit even after evicting holds back the ones after it
+    while (!pRequests.empty() && pServeRequest(pRequests.front(), budget)) {
+      pRequests.pop_front();
+    }
+
+    if (pRequests.empty()) {
+      pUpgradeOne(budget);
+    }
+
+    pStats.budget_bytes   = budget;
+    pStats.resident_bytes = pResidentBytes;
+    pStats.headroom_bytes = static_cast<int64_t>(budget) - static_cast<int64_t>(pResidentBytes);
+    pStats.pending_count  = static_cast<uint32_t>(pRequests.size());
+  }
+
+  void ResidencyManager::SetBudget(VkDeviceSize budget) {
+    std::lock_guard<std::mutex> lock {pMutex};
+    pBudget = budget;
+  }
+
+  uint32_t ResidencyManager::getLevel(ResidencyHandle handle) {
+    std::lock_guard<std::mutex> lock {pMutex};
+    return pEntries[handle].level;
+  }
+
+  ResidencyStats ResidencyManager::getStats() {
+    std::lock_guard<std::mutex> lock {pMutex};
+    return pStats;
+  }
+
+  VkDeviceSize ResidencyManager::pComputeBudget() {
+    MemoryBudget device_budget = pDevice.QueryMemoryBudget();
+    VkDeviceSize available     = static_cast<VkDeviceSize>(device_budget.budget * DEVICE_BUDGET_FRACTION);
+
+    // Usage reported by the device includes what is resident here, the rest belongs to everything else
+    if (device_budget.from_extension) {
+      VkDeviceSize others = device_budget.usage > pResidentBytes ? device_budget.usage - pResidentBytes : 0;
+      available           = available > others ? available - others : 0;
+    }
+
+    pStats.budget_from_device = device_budget.from_extension;
+
+    return pBudget == 0 ? available : std::min(pBudget, available);
+  }
+
+  void ResidencyManager::pEvictUntil(VkDeviceSize target) {
+    if (pResidentBytes <= target) {
+      return;
+    }
+
+    // Resources used by a frame that has not completed yet stay, evicting them would not free anything in time
+    const uint64_t completed = pDevice.getCompletedFrameValue();
+
+    std::vector<Entry*> candidates;
+
+    for (auto& entry : pEntries) {
+      if (entry.registered && entry.level != NOT_RESIDENT && entry.last_used <= completed) {
+        candidates.push_back(&entry);
+      }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b) {
+      return a->last_used < b->last_used;
+    });
+
+    for (Entry* entry : candidates) {
+      if (pResidentBytes <= target) {
+        break;
+      }
+
+      pEvict(*entry);
+    }
+  }
+
+  void ResidencyManager::pEvict(Entry& entry) {
+    entry.description.evict();
+
+    pResidentBytes -= entry.description.level_sizes[entry.level];
+    entry.level = NOT_RESIDENT;
+
+    pStats.evictions++;
+    pStats.resident_count--;
+  }
+
+  void ResidencyManager::pStreamIn(Entry& entry, uint32_t level) {
+    entry.description.stream_in(level);
+
+    if (entry.level == NOT_RESIDENT) {
+      pStats.stream_ins++;
+      pStats.resident_count++;
+    } else {
+      pResidentBytes -= entry.description.level_sizes[entry.level];
+    }
+
+    pResidentBytes += entry.description.level_sizes[level];
+    entry.level = level;
+  }
+
+  bool ResidencyManager::pServeRequest(ResidencyHandle handle, VkDeviceSize budget) {
+    Entry& entry = pEntries[handle];
+
+    // Unregistered, or made resident by an earlier request for the same handle
+    if (!entry.requested || entry.level != NOT_RESIDENT) {
+      entry.requested = false;
+      return true;
+    }
+
+    const auto&        sizes          = entry.description.level_sizes;
+    const uint32_t     level_count    = static_cast<uint32_t>(sizes.size());
+    const VkDeviceSize pressure_limit = static_cast<VkDeviceSize>(budget * PRESSURE_THRESHOLD);
+
+    // Full quality only while below the pressure threshold, past it the best level that still fits the budget
+    for (uint32_t level = 0; level < level_count; level++) {
+      VkDeviceSize limit = level == 0 && level_count > 1 ? pressure_limit : budget;
+
+      if (pResidentBytes + sizes[level] <= limit) {
+        pStreamIn(entry, level);
+        pStats.reduced_stream_ins += level > 0 ? 1 : 0;
+        entry.requested = false;
+        return true;
+      }
+    }
+
+    // Nothing fits, make room for the cheapest level by evicting cold resources
+    const uint32_t cheapest = level_count - 1;
+
+    if (sizes[cheapest] > budget) {
+      return false;
+    }
+
+    pEvictUntil(budget - sizes[cheapest]);
+
+    if (pResidentBytes + sizes[cheapest] > budget) {
+      return false;
+    }
+
+    pStreamIn(entry, cheapest);
+    pStats.reduced_stream_ins += cheapest > 0 ? 1 : 0;
+    entry.requested = false;
+
+    return true;
+  }
+
+  void ResidencyManager::pUpgradeOne(VkDeviceSize budget) {
+    const VkDeviceSize pressure_limit = static_cast<VkDeviceSize>(budget * PRESSURE_THRESHOLD);
+
+    // The most recently used reduced resource moves up one level, as long as that stays below the pressure threshold
+    Entry* best = nullptr;
+
+    for (auto& entry : pEntries) {
+      if (entry.registered && entry.level != NOT_RESIDENT && entry.level > 0 &&
+          (best == nullptr || entry.last_used > best->last_used)) {
+        best = &entry;
+      }
+    }
+
+    if (best == nullptr) {
+      return;
+    }
+
+    const auto&  sizes = best->description.level_sizes;
+    VkDeviceSize grown = pResidentBytes - sizes[best->level] + sizes[best->level - 1];
+
+    if (grown <= pressure_limit) {
+      pStreamIn(*best, best->level - 1);
+      pStats.upgrades++;
+    }
+  }
+}
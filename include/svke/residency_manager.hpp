@@ -0,0 +1,100 @@
+#ifndef SVKE_RESIDENCY_MANAGER_HPP
+#define SVKE_RESIDENCY_MANAGER_HPP
+
+#include "defines.hpp"
+#include "device.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  using ResidencyHandle                         = uint32_t;
+  constexpr ResidencyHandle NO_RESIDENCY_HANDLE = std::numeric_limits<uint32_t>::max();
+
+  struct ResidencyStats {
+    uint64_t     evictions          = 0;
+    uint64_t     stream_ins         = 0;
+    uint64_t     reduced_stream_ins = 0;  // Streamed in below full quality because of memory pressure
+    uint64_t     upgrades           = 0;
+    VkDeviceSize resident_bytes     = 0;
+    VkDeviceSize budget_bytes       = 0;
+    int64_t      headroom_bytes     = 0;
+    uint32_t     resident_count     = 0;
+    uint32_t     pending_count      = 0;
+    bool         budget_from_device = false;  // Budget informed by VK_EXT_memory_budget
+  };
+
+  // A GPU resource that can be streamed in and out. Level 0 is the full quality version, each further level a cheaper
+  // one, such as a texture without its top mips or a lower mesh LOD. The callbacks run from ResidencyManager::Update
+  // and must not call back into the manager. stream_in creates or replaces the GPU copy at the given level, evict
+  // releases it, both going through Device::DeferDestroy for whatever frames in flight may still use.
+  struct ResidencyDescription {
+    std::vector<VkDeviceSize>           level_sizes;
+    std::function<void(uint32_t level)> stream_in;
+    std::function<void()>               evict;
+  };
+
+  // Keeps the registered resources within a memory budget. Touch marks a resource as used by the frame being recorded
+  // and requests it if it is not resident, Update then evicts the least recently used resources that no frame in
+  // flight uses until the budget is met and streams the requests in, at a reduced level when memory is tight.
+  class ResidencyManager {
+   public:
+    static constexpr uint32_t NOT_RESIDENT = std::numeric_limits<uint32_t>::max();
+
+    // Above this fraction of the budget new resources stream in at the best level that still fits instead of level 0
+    static constexpr float PRESSURE_THRESHOLD = 0.9f;
+
+    // Fraction of the device budget the manager allows itself when it has no budget of its own
+    static constexpr float DEVICE_BUDGET_FRACTION = 0.8f;
+
+   public:
+    // A budget of 0 follows the device budget
+    ResidencyManager(Device& device, VkDeviceSize budget = 0);
+    ~ResidencyManager();
+
+    ResidencyManager(const ResidencyManager& other) = delete;
+    ResidencyManager& operator=(const ResidencyManager& other) = delete;
+
+   public:
+    // Resources that already exist when they are registered pass the level they were created at
+    ResidencyHandle Register(ResidencyDescription description, uint32_t level = NOT_RESIDENT);
+    void            Unregister(ResidencyHandle handle);
+
+    void Touch(ResidencyHandle handle);
+    void Update();
+
+    void     SetBudget(VkDeviceSize budget);
+    uint32_t getLevel(ResidencyHandle handle);
+    bool     IsResident(ResidencyHandle handle) { return getLevel(handle) != NOT_RESIDENT; }
+
+    ResidencyStats getStats();
+
+   private:
+    struct Entry {
+      ResidencyDescription description;
+      uint32_t             level {NOT_RESIDENT};
+      uint64_t             last_used {0};
+      bool                 requested {false};
+      bool                 registered {false};
+    };
+
+    VkDeviceSize pComputeBudget();
+    void         pEvictUntil(VkDeviceSize target);
+    void         pEvict(Entry& entry);
+    void         pStreamIn(Entry& entry, uint32_t level);
+    bool         pServeRequest(ResidencyHandle handle, VkDeviceSize budget);
+    void         pUpgradeOne(VkDeviceSize budget);
+
+   private:
+    Device&    pDevice;
+    std::mutex pMutex;
+
+    std::vector<Entry>           pEntries;
+    std::vector<ResidencyHandle> pFreeHandles;
+    std::deque<ResidencyHandle>  pRequests;
+
+    VkDeviceSize   pBudget;
+    VkDeviceSize   pResidentBytes {0};
+    ResidencyStats pStats {};
+  };
+}
+
+#endif
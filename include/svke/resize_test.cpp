@@ -0,0 +1,52 @@
+#include "defines.hpp"
+#include "pch.hpp"
+#include "resize_test.hpp"
+
+namespace svke {
+  ResizeTest::ResizeTest(Window& window) : pWindow {window} {
+    pFrameTimes.reserve(RESIZE_COUNT * FRAMES_PER_RESIZE + SETTLE_FRAMES);
+  }
+
+  bool ResizeTest::Step(float frame_time) {
+    static const std::array<VkExtent2D, 6> sizes = {
+        {{512, 512}, {640, 480}, {800, 600}, {1024, 768}, {720, 720}, {600, 400}}};
+
+    pFrameTimes.push_back(frame_time * 1000.0f);
+
+    if (pFrame % FRAMES_PER_RESIZE == 0 && pFrame / FRAMES_PER_RESIZE < RESIZE_COUNT) {
+      const VkExtent2D& size = sizes[(pFrame / FRAMES_PER_RESIZE) % sizes.size()];
+      pWindow.SetSize(size.width, size.height);
+    }
+
+    pFrame++;
+
+    if (pFrame < RESIZE_COUNT * FRAMES_PER_RESIZE + SETTLE_FRAMES) {
+      return false;
+    }
+
+    pReport();
+
+    return true;
+  }
+
+  void ResizeTest::pReport() {
+    std::vector<float> sorted = pFrameTimes;
+    std::sort(sorted.begin(), sorted.end());
+
+    float total = 0.0f;
+
+    for (float time : sorted) {
+      total += time;
+    }
+
+    const float median = sorted[sorted.size() / 2];
+    const float p99    = sorted[sorted.size() * 99 / 100];
+
+    // A spike is a frame that took more than three times the median
+    uint64_t spikes = std::count_if(sorted.begin(), sorted.end(), [&](float time) { return time > 3.0f * median; });
+
+    std::cout << "Resize test: " << RESIZE_COUNT << " resizes over " << sorted.size() << " frames" << std::endl;
+    std::cout << "  average " << total / sorted.size() << " ms, median " << median << " ms, p99 " << p99
+              << " ms, max " << sorted.back() << " ms, spikes (> 3x median) " << spikes << std::endl;
+  }
+}
@@ -0,0 +1,37 @@
+#ifndef SVKE_RESIZE_TEST_HPP
+#define SVKE_RESIZE_TEST_HPP
+
+#include "defines.hpp"
+#include "pch.hpp"
+#include "window.hpp"
+
+namespace svke {
+  // Scripted sequence of window resizes, a few frames apart, that records every frame time and reports the spikes
+  // once done. Enabled with SVKE_RESIZE_TEST, set it to "idle" to recreate the swap chain the old way for comparison.
+  class ResizeTest {
+   public:
+    static constexpr uint32_t RESIZE_COUNT      = 60;
+    static constexpr uint32_t FRAMES_PER_RESIZE = 4;
+    static constexpr uint32_t SETTLE_FRAMES     = 120;
+
+   public:
+    ResizeTest(Window& window);
+
+    ResizeTest(const ResizeTest& other) = delete;
+    ResizeTest& operator=(const ResizeTest& other) = delete;
+
+   public:
+    // Returns true once the sequence has finished and the report has been printed
+    bool Step(float frame_time);
+
+   private:
+    void pReport();
+
+   private:
+    Window&            pWindow;
+    uint32_t           pFrame {0};
+    std::vector<float> pFrameTimes;
+  };
+}
+
+#endif
@@ -0,0 +1,66 @@
+#include "sampler_cache.hpp"
+
+#include "defines.hpp"
+#include "hash.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  uint64_t SamplerDescription::Hash() const {
+    uint64_t hash = HashValue(mag_filter);
+    hash          = HashValue(min_filter, hash);
+    hash          = HashValue(mipmap_mode, hash);
+    hash          = HashValue(address_mode, hash);
+    hash          = HashValue(anisotropy, hash);
+    hash          = HashValue(max_lod, hash);
+
+    return hash;
+  }
+
+  bool SamplerDescription::operator==(const SamplerDescription& other) const {
+    return mag_filter == other.mag_filter && min_filter == other.min_filter && mipmap_mode == other.mipmap_mode &&
+           address_mode == other.address_mode && anisotropy == other.anisotropy && max_lod == other.max_lod;
+  }
+
+  SamplerCache::SamplerCache(Device& device) : pDevice {device} {}
+
+  SamplerCache::~SamplerCache() {
+    for (auto& [description, sampler] : pSamplers) {
+      vkDestroySampler(pDevice.getDevice(), sampler, nullptr);
+    }
+  }
+
+  VkSampler SamplerCache::GetSampler(const SamplerDescription& description) {
+    auto found = pSamplers.find(description);
+
+    if (found != pSamplers.end()) {
+      return found->second;
+    }
+
+    float anisotropy = std::min(description.anisotropy, pDevice.properties.limits.maxSamplerAnisotropy);
+
+    VkSamplerCreateInfo sampler_info {};
+    sampler_info.sType                   = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.magFilter               = description.mag_filter;
+    sampler_info.minFilter               = description.min_filter;
+    sampler_info.mipmapMode              = description.mipmap_mode;
+    sampler_info.addressModeU            = description.address_mode;
+    sampler_info.addressModeV            = description.address_mode;
+    sampler_info.addressModeW            = description.address_mode;
+    sampler_info.anisotropyEnable        = anisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+    sampler_info.maxAnisotropy           = std::max(anisotropy, 1.0f);
+    sampler_info.minLod                  = 0.0f;
+    sampler_info.maxLod                  = description.max_lod;
+    sampler_info.borderColor             = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    sampler_info.unnormalizedCoordinates = VK_FALSE;
+    sampler_info.compareEnable           = VK_FALSE;
+
+    VkSampler sampler;
+
+    if (vkCreateSampler(pDevice.getDevice(), &sampler_info, nullptr, &sampler) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create sampler");
+    }
+
+    pSamplers.emplace(description, sampler);
+    return sampler;
+  }
+}
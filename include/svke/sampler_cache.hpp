@@ -0,0 +1,47 @@
+#ifndef SVKE_SAMPLER_CACHE_HPP
+#define SVKE_SAMPLER_CACHE_HPP
+
+#include "defines.hpp"
+#include "device.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  struct SamplerDescription {
+    VkFilter             mag_filter   = VK_FILTER_LINEAR;
+    VkFilter             min_filter   = VK_FILTER_LINEAR;
+    VkSamplerMipmapMode  mipmap_mode  = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    VkSamplerAddressMode address_mode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    float                anisotropy   = 16.0f;  // Clamped to what the device supports, 1 or less disables it
+    float                max_lod      = VK_LOD_CLAMP_NONE;
+
+    uint64_t Hash() const;
+    bool     operator==(const SamplerDescription& other) const;
+  };
+
+  struct SamplerDescriptionHash {
+    size_t operator()(const SamplerDescription& description) const {
+      return static_cast<size_t>(description.Hash());
+    }
+  };
+
+  // Owns one sampler per distinct description, textures usually only need a handful between them
+  class SamplerCache {
+   public:
+    SamplerCache(Device& device);
+    ~SamplerCache();
+
+    SamplerCache(const SamplerCache& other) = delete;
+    SamplerCache& operator=(const SamplerCache& other) = delete;
+
+   public:
+    VkSampler GetSampler(const SamplerDescription& description = {});
+
+    uint64_t getSamplerCount() const { return pSamplers.size(); }
+
+   private:
+    Device&                                                                   pDevice;
+    std::unordered_map<SamplerDescription, VkSampler, SamplerDescriptionHash> pSamplers;
+  };
+}
+
+#endif
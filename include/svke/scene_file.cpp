@@ -0,0 +1,459 @@
+#include "scene_file.hpp"
+
+#include "asset_cache.hpp"
+#include "defines.hpp"
+#include "pch.hpp"
+#include "profiler.hpp"
+
+namespace svke {
+  // The header is followed by model_count + 1 offsets into the strings, the parents, model indices and local transforms
+  // of every node, and then the model reference strings. Every array is aligned to its element size.
+  struct SceneFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t node_count;
+    uint32_t model_count;
+    uint64_t string_size;
+  };
+
+  static constexpr uint32_t SCENE_FILE_MAGIC = 0x53454353;  // "SCES"
+
+  // Transforms are stored as their raw floats, a change to the component needs a new version
+  static_assert(sizeof(TransformComponent) == 9 * sizeof(float), "Scene transforms must be nine packed floats");
+
+  struct SceneFileLayout {
+    uint64_t offsets;
+    uint64_t parents;
+    uint64_t models;
+    uint64_t locals;
+    uint64_t strings;
+
+    static SceneFileLayout Make(const SceneFileHeader& header) {
+      const uint64_t node_count = header.node_count;
+
+      SceneFileLayout layout;
+
+      layout.offsets = sizeof(SceneFileHeader);
+      layout.parents = layout.offsets + (static_cast<uint64_t>(header.model_count) + 1) * sizeof(uint64_t);
+      layout.models  = layout.parents + node_count * sizeof(uint32_t);
+      layout.locals  = layout.models + node_count * sizeof(uint32_t);
+      layout.strings = layout.locals + node_count * sizeof(TransformComponent);
+
+      return layout;
+    }
+  };
+
+  // Mapped scene file with its arrays checked against each other
+  struct SceneFileView {
+    AssetBlob                 blob;
+    SceneFileHeader           header;
+    const uint64_t*           string_offsets;
+    const uint32_t*           parents;
+    const uint32_t*           models;
+    const TransformComponent* locals;
+    const char*               strings;
+    std::vector<uint32_t>     object_nodes;  // Positions of the nodes that become game objects
+
+    std::string getReference(uint32_t model) const {
+      return {strings + string_offsets[model], strings + string_offsets[model + 1]};
+    }
+
+    static SceneFileView Map(const std::string& path) {
+      SceneFileView view;
+      view.blob = AssetBlob::FromFile(path);
+
+      if (!view.blob.IsValid()) {
+        throw std::runtime_error("Failed to open file: " + path);
+      }
+
+      if (view.blob.getSize() < sizeof(SceneFileHeader)) {
+        throw std::runtime_error("Invalid scene file: " + path);
+      }
+
+      SceneFileHeader& header = view.header;
+      memcpy(&header, view.blob.getData(), sizeof(header));
+
+      if (header.magic != SCENE_FILE_MAGIC) {
+        throw std::runtime_error("Invalid scene file: " + path);
+      }
+
+      if (header.version != SceneFile::VERSION) {
+        throw std::runtime_error("Unsupported scene file version " + std::to_string(header.version) + ": " + path);
+      }
+
+      const SceneFileLayout layout = SceneFileLayout::Make(header);
+
+      // The strings end the file. Their size is compared to what is left rather than added up, a size from a corrupt
+      // header could wrap the sum around to the file size.
+      if (layout.strings > view.blob.getSize() || header.string_size != view.blob.getSize() - layout.strings) {
+        throw std::runtime_error("Invalid scene file: " + path);
+      }
+
+      const uint8_t* data = view.blob.getData();
+
+      view.string_offsets = reinterpret_cast<const uint64_t*>(data + layout.offsets);
+      view.parents        = reinterpret_cast<const uint32_t*>(data + layout.parents);
+      view.models         = reinterpret_cast<const uint32_t*>(data + layout.models);
+      view.locals         = reinterpret_cast<const TransformComponent*>(data + layout.locals);
+      view.strings        = reinterpret_cast<const char*>(data + layout.strings);
+
+      for (uint32_t i = 0; i < header.model_count; i++) {
+        if (view.string_offsets[i] > view.string_offsets[i + 1] || view.string_offsets[i + 1] > header.string_size) {
+          throw std::runtime_error("Invalid scene file: " + path);
+        }
+      }
+
+      for (uint32_t i = 0; i < header.node_count; i++) {
+        if (view.models[i] != SceneFile::NO_MODEL) {
+          if (view.models[i] >= header.model_count) {
+            throw std::runtime_error("Invalid scene file: " + path);
+          }
+
+          view.object_nodes.push_back(i);
+        }
+      }
+
+      return view;
+    }
+  };
+
+  static double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  // Appends the nodes and creates an empty game object for each node with a model. New objects go to the end of the
+  // pool in dense order, so until something is destroyed they are filled in by index. Returns the first one's index.
+  static uint32_t AddSceneObjects(const SceneFileView& view,
+                                  SceneGraph&          scene_graph,
+                                  GameObjectPool&      game_objects,
+                                  SceneLoadStats&      stats) {
+    auto step_start = std::chrono::steady_clock::now();
+
+    scene_graph.Append(view.header.node_count, view.parents, view.locals);
+
+    stats.nodes_ms = MillisecondsSince(step_start);
+    step_start     = std::chrono::steady_clock::now();
+
+    const uint32_t first_object = game_objects.getSize();
+    game_objects.Reserve(first_object + static_cast<uint32_t>(view.object_nodes.size()));
+
+    for (size_t i = 0; i < view.object_nodes.size(); i++) {
+      game_objects.Create();
+    }
+
+    stats.node_count   = view.header.node_count;
+    stats.object_count = static_cast<uint32_t>(view.object_nodes.size());
+    stats.model_count  = view.header.model_count;
+    stats.objects_ms   = MillisecondsSince(step_start);
+
+    return first_object;
+  }
+
+  // Gives the objects AddSceneObjects created their transforms, scene nodes and, unless they are left to streaming,
+  // their models
+  static void FillSceneObjects(const SceneFileView&            view,
+                               JobSystem&                      job_system,
+                               GameObjectPool&                 game_objects,
+                               uint32_t                        first_object,
+                               SceneNode                       first_node,
+                               const std::vector<ModelHandle>* models) {
+    JobCounter object_counter;
+
+    job_system.ParallelFor(
+        0,
+        static_cast<uint32_t>(view.object_nodes.size()),
+        SceneFile::GRAIN,
+        [&](uint32_t begin, uint32_t end) {
+          for (uint32_t i = begin; i < end; i++) {
+            const uint32_t node   = view.object_nodes[i];
+            GameObject&    object = game_objects[first_object + i];
+
+            object.ObjectModel       = models != nullptr ? (*models)[view.models[node]] : NO_MODEL_HANDLE;
+            object.Transform         = view.locals[node];
+            object.PreviousTransform = view.locals[node];
+            object.Node              = first_node + node;
+          }
+        },
+        object_counter);
+
+    job_system.Wait(object_counter);
+  }
+
+  uint32_t SceneFile::AddModel(const std::string& reference) {
+    pModels.push_back(reference);
+    return static_cast<uint32_t>(pModels.size() - 1);
+  }
+
+  uint32_t SceneFile::AddObject(const TransformComponent& local, uint32_t model, uint32_t parent) {
+    if (parent != NO_PARENT && parent >= pParents.size()) {
+      throw std::runtime_error("Cannot add a scene object before its parent");
+    }
+
+    if (model != NO_MODEL && model >= pModels.size()) {
+      throw std::runtime_error("Cannot add a scene object with an unknown model");
+    }
+
+    pParents.push_back(parent);
+    pObjectModels.push_back(model);
+    pLocals.push_back(local);
+
+    return static_cast<uint32_t>(pParents.size() - 1);
+  }
+
+  void SceneFile::Save(const std::string& path) const {
+    SVKE_PROFILE_SCOPE("SceneFile::Save");
+
+    const uint32_t count = getObjectCount();
+
+    // Children grouped by parent in the order they were added, then walked depth first into the stored order
+    std::vector<uint32_t> child_starts(count + 1, 0);
+    std::vector<uint32_t> children(count);
+
+    for (uint32_t parent : pParents) {
+      if (parent != NO_PARENT) {
+        child_starts[parent + 1]++;
+      }
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+      child_starts[i + 1] += child_starts[i];
+    }
+
+    std::vector<uint32_t> child_ends(child_starts.begin(), child_starts.end() - 1);
+
+    for (uint32_t i = 0; i < count; i++) {
+      if (pParents[i] != NO_PARENT) {
+        children[child_ends[pParents[i]]++] = i;
+      }
+    }
+
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> stored_index(count);
+    std::vector<uint32_t> stack;
+
+    order.reserve(count);
+
+    for (uint32_t root = 0; root < count; root++) {
+      if (pParents[root] != NO_PARENT) {
+        continue;
+      }
+
+      stack.push_back(root);
+
+      while (!stack.empty()) {
+        uint32_t object = stack.back();
+        stack.pop_back();
+
+        stored_index[object] = static_cast<uint32_t>(order.size());
+        order.push_back(object);
+
+        // Pushed in reverse so that children keep their order
+        for (uint32_t child = child_ends[object]; child-- > child_starts[object];) {
+          stack.push_back(children[child]);
+        }
+      }
+    }
+
+    std::vector<uint32_t>           parents(count);
+    std::vector<uint32_t>           models(count);
+    std::vector<TransformComponent> locals(count);
+
+    for (uint32_t i = 0; i < count; i++) {
+      const uint32_t object = order[i];
+
+      parents[i] = pParents[object] == NO_PARENT ? NO_PARENT : stored_index[pParents[object]];
+      models[i]  = pObjectModels[object];
+      locals[i]  = pLocals[object];
+    }
+
+    std::vector<uint64_t> string_offsets {0};
+    std::string           strings;
+
+    for (const auto& reference : pModels) {
+      strings += reference;
+      string_offsets.push_back(strings.size());
+    }
+
+    SceneFileHeader header {SCENE_FILE_MAGIC, VERSION, count, getModelCount(), strings.size()};
+
+    std::filesystem::path temporary_path = path + ".tmp";
+
+    {
+      std::ofstream file {temporary_path, std::ios::binary | std::ios::trunc};
+
+      if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + temporary_path.string());
+      }
+
+      auto write = [&](const void* data, size_t size) {
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+      };
+
+      write(&header, sizeof(header));
+      write(string_offsets.data(), string_offsets.size() * sizeof(uint64_t));
+      write(parents.data(), parents.size() * sizeof(uint32_t));
+      write(models.data(), models.size() * sizeof(uint32_t));
+      write(locals.data(), locals.size() * sizeof(TransformComponent));
+      write(strings.data(), strings.size());
+
+      if (!file.good()) {
+        file.close();
+
+        std::error_code error;
+        std::filesystem::remove(temporary_path, error);
+
+        throw std::runtime_error("Failed to write scene file: " + path);
+      }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+
+    if (error) {
+      std::filesystem::remove(temporary_path, error);
+      throw std::runtime_error("Failed to write scene file: " + path);
+    }
+  }
+
+  SceneLoadStats SceneFile::Load(const std::string&   path,
+                                 JobSystem&           job_system,
+                                 const ModelResolver& resolve,
+                                 ModelRegistry&       models,
+                                 SceneGraph&          scene_graph,
+                                 GameObjectPool&      game_objects) {
+    SVKE_PROFILE_SCOPE("SceneFile::Load");
+
+    const auto     load_start = std::chrono::steady_clock::now();
+    SceneLoadStats stats {};
+
+    const SceneFileView view = SceneFileView::Map(path);
+    stats.map_ms             = MillisecondsSince(load_start);
+
+    // Models load and upload on the workers while this thread builds the scene graph
+    std::vector<std::unique_ptr<Model>> resolved(view.header.model_count);
+    std::exception_ptr                  resolve_error;
+    std::mutex                          resolve_error_mutex;
+    JobCounter                          model_counter;
+
+    job_system.ParallelFor(
+        0,
+        view.header.model_count,
+        1,
+        [&](uint32_t begin, uint32_t end) {
+          for (uint32_t i = begin; i < end; i++) {
+            std::string reference = view.getReference(i);
+
+            try {
+              resolved[i] = resolve(reference);
+
+              if (resolved[i] == nullptr) {
+                throw std::runtime_error("Failed to resolve scene model: " + reference);
+              }
+            } catch (...) {
+              std::lock_guard<std::mutex> lock {resolve_error_mutex};
+
+              if (resolve_error == nullptr) {
+                resolve_error = std::current_exception();
+              }
+            }
+          }
+        },
+        model_counter);
+
+    const SceneNode first_node = static_cast<SceneNode>(scene_graph.getHandleCount());
+    uint32_t        first_object;
+
+    try {
+      first_object = AddSceneObjects(view, scene_graph, game_objects, stats);
+    } catch (...) {
+      job_system.Wait(model_counter);
+      throw;
+    }
+
+    const auto objects_start = std::chrono::steady_clock::now();
+
+    job_system.Wait(model_counter);
+
+    if (resolve_error != nullptr) {
+      // Nothing was destroyed in between, so the new objects are still the last ones and each goes with a pop
+      for (uint32_t i = game_objects.getSize(); i-- > first_object;) {
+        game_objects.Destroy(game_objects[i].getId());
+      }
+
+      // The appended nodes are the last ones, so destroying their roots back to front never moves anything
+      for (uint32_t i = view.header.node_count; i-- > 0;) {
+        if (view.parents[i] == NO_PARENT) {
+          scene_graph.Destroy(first_node + i);
+        }
+      }
+
+      std::rethrow_exception(resolve_error);
+    }
+
+    // Registered on this thread, only once every model resolved so a failed load leaves the registry alone
+    std::vector<ModelHandle> handles(view.header.model_count);
+
+    for (uint32_t i = 0; i < view.header.model_count; i++) {
+      handles[i] = models.Add(std::move(resolved[i]));
+    }
+
+    FillSceneObjects(view, job_system, game_objects, first_object, first_node, &handles);
+
+    stats.objects_ms += MillisecondsSince(objects_start);
+    stats.total_ms = MillisecondsSince(load_start);
+
+    return stats;
+  }
+
+  SceneLoadStats SceneFile::Load(const std::string& path,
+                                 JobSystem&         job_system,
+                                 AssetLoader&       loader,
+                                 uint32_t           essential_models,
+                                 SceneGraph&        scene_graph,
+                                 GameObjectPool&    game_objects) {
+    SVKE_PROFILE_SCOPE("SceneFile::Load");
+
+    const auto     load_start = std::chrono::steady_clock::now();
+    SceneLoadStats stats {};
+
+    const SceneFileView view = SceneFileView::Map(path);
+    stats.map_ms             = MillisecondsSince(load_start);
+
+    const SceneNode first_node   = static_cast<SceneNode>(scene_graph.getHandleCount());
+    const uint32_t  first_object = AddSceneObjects(view, scene_graph, game_objects, stats);
+
+    const auto objects_start = std::chrono::steady_clock::now();
+
+    FillSceneObjects(view, job_system, game_objects, first_object, first_node, nullptr);
+
+    stats.objects_ms += MillisecondsSince(objects_start);
+
+    // Each model's callback hands it to the objects using it, by handle since objects may be destroyed meanwhile
+    std::vector<std::vector<GameObject::id_t>> users(view.header.model_count);
+
+    for (uint32_t i = 0; i < view.object_nodes.size(); i++) {
+      users[view.models[view.object_nodes[i]]].push_back(game_objects[first_object + i].getId());
+    }
+
+    const std::filesystem::path directory = std::filesystem::path {path}.parent_path();
+
+    for (uint32_t model = 0; model < view.header.model_count; model++) {
+      auto objects = std::make_shared<const std::vector<GameObject::id_t>>(std::move(users[model]));
+
+      loader.LoadModel(
+          (directory / view.getReference(model)).string(),
+          [objects, &game_objects](ModelHandle loaded) {
+            for (GameObject::id_t object : *objects) {
+              if (game_objects.IsValid(object)) {
+                game_objects.Get(object).ObjectModel = loaded;
+              }
+            }
+          },
+          model < essential_models);
+    }
+
+    stats.total_ms = MillisecondsSince(load_start);
+
+    return stats;
+  }
+}
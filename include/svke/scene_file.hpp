@@ -0,0 +1,88 @@
+#ifndef SVKE_SCENE_FILE_HPP
+#define SVKE_SCENE_FILE_HPP
+
+#include "asset_loader.hpp"
+#include "defines.hpp"
+#include "game_object.hpp"
+#include "game_object_pool.hpp"
+#include "job_system.hpp"
+#include "model.hpp"
+#include "model_registry.hpp"
+#include "pch.hpp"
+#include "scene_graph.hpp"
+
+namespace svke {
+  // Counts of a loaded scene and how long each step took. Models resolve on the job system while the nodes and objects
+  // are created, so objects_ms includes waiting for the rest of them unless they are streamed in.
+  struct SceneLoadStats {
+    uint32_t node_count   = 0;
+    uint32_t object_count = 0;  // Nodes with a model, which become game objects
+    uint32_t model_count  = 0;
+    double   map_ms       = 0.0;
+    double   nodes_ms     = 0.0;
+    double   objects_ms   = 0.0;
+    double   total_ms     = 0.0;
+  };
+
+  // Versioned binary scene of objects with their local transforms, parents and model references. Each property is one
+  // contiguous array in depth first order, so loading maps the file and hands the arrays straight to the scene graph
+  // instead of parsing anything. Model references are opaque strings, usually paths, turned into models by a resolver.
+  //
+  // Scenes are built with AddModel and AddObject and written with Save, in any order as long as parents come first.
+  class SceneFile {
+   public:
+    static constexpr uint32_t VERSION   = 1;
+    static constexpr uint32_t NO_PARENT = NO_SCENE_NODE;
+    static constexpr uint32_t NO_MODEL  = std::numeric_limits<uint32_t>::max();
+    static constexpr uint32_t GRAIN     = 4096;  // Game objects filled in per job
+
+    // Called from the job system's threads, once per model reference and possibly concurrently
+    using ModelResolver = std::function<std::unique_ptr<Model>(const std::string& reference)>;
+
+   public:
+    SceneFile() = default;
+
+    SceneFile(const SceneFile& other) = delete;
+    SceneFile& operator=(const SceneFile& other) = delete;
+
+   public:
+    uint32_t AddModel(const std::string& reference);
+
+    // Objects without a model only place their children. Returns the index to parent later objects to.
+    uint32_t AddObject(const TransformComponent& local, uint32_t model = NO_MODEL, uint32_t parent = NO_PARENT);
+
+    // Written to a temporary file and renamed over path, so a failed save leaves the previous scene intact
+    void Save(const std::string& path) const;
+
+    // Appends the scene's nodes to scene_graph and a game object for every node with a model to game_objects, with
+    // the models resolved in parallel and added to models. Nothing is added when the file is invalid or a model fails
+    // to resolve.
+    static SceneLoadStats Load(const std::string&   path,
+                               JobSystem&           job_system,
+                               const ModelResolver& resolve,
+                               ModelRegistry&       models,
+                               SceneGraph&          scene_graph,
+                               GameObjectPool&      game_objects);
+
+    // Streams the models in through loader instead, as OBJ files with paths relative to the scene file. The objects
+    // are added right away without a model, which rendering skips, and get it from loader.Poll once it has loaded
+    // unless they were destroyed by then. The first essential_models model references are loaded as essential.
+    static SceneLoadStats Load(const std::string& path,
+                               JobSystem&         job_system,
+                               AssetLoader&       loader,
+                               uint32_t           essential_models,
+                               SceneGraph&        scene_graph,
+                               GameObjectPool&    game_objects);
+
+    uint32_t getObjectCount() const { return static_cast<uint32_t>(pParents.size()); }
+    uint32_t getModelCount() const { return static_cast<uint32_t>(pModels.size()); }
+
+   private:
+    std::vector<std::string>        pModels;
+    std::vector<uint32_t>           pParents;
+    std::vector<uint32_t>           pObjectModels;
+    std::vector<TransformComponent> pLocals;
+  };
+}
+
+#endif
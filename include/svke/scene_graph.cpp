@@ -0,0 +1,273 @@
+#include "scene_graph.hpp"
+
+#include "defines.hpp"
+#include "pch_core.hpp"
+
+namespace svke {
+  SceneNode SceneGraph::Create(const TransformComponent& local, SceneNode parent) {
+    assert((parent == NO_SCENE_NODE || IsValid(parent)) && "Cannot create a node under a destroyed parent");
+
+    SceneNode node;
+
+    if (!pFreeNodes.empty()) {
+      node = pFreeNodes.back();
+      pFreeNodes.pop_back();
+    } else {
+      node = static_cast<SceneNode>(pIndices.size());
+      pIndices.push_back(NO_INDEX);
+    }
+
+    uint32_t index = static_cast<uint32_t>(pNodes.size());
+
+    pNodes.push_back(node);
+    pParentNodes.push_back(parent);
+    pParents.push_back(parent == NO_SCENE_NODE ? NO_INDEX : pIndices[parent]);
+    pSubtreeSizes.push_back(1);
+    pLocals.push_back(local);
+    pWorlds.emplace_back(1.0f);
+    pDirty.push_back(0);
+
+    pIndices[node] = index;
+
+    // A root stays at the end, a child goes to the end of its parent's range
+    if (parent != NO_SCENE_NODE) {
+      uint32_t parent_index = pIndices[parent];
+      uint32_t destination  = parent_index + pSubtreeSizes[parent_index];
+
+      pResizeAncestors(index, 1);
+      pMoveFromEnd(destination, 1);
+    }
+
+    pMarkDirty(pIndices[node]);
+
+    return node;
+  }
+
+  SceneNode SceneGraph::Append(uint32_t count, const uint32_t* parents, const TransformComponent* locals) {
+    // A parent's range must still be open when its child arrives, the ancestors of the previous node are those ranges
+    std::vector<uint32_t> open_ranges;
+
+    for (uint32_t i = 0; i < count; i++) {
+      while (!open_ranges.empty() && open_ranges.back() != parents[i]) {
+        open_ranges.pop_back();
+      }
+
+      if (parents[i] != NO_SCENE_NODE && open_ranges.empty()) {
+        throw std::runtime_error("Scene nodes are not in depth first order");
+      }
+
+      open_ranges.push_back(i);
+    }
+
+    const SceneNode first_node = static_cast<SceneNode>(pIndices.size());
+    const uint32_t  first      = static_cast<uint32_t>(pNodes.size());
+    const uint32_t  end        = first + count;
+
+    pNodes.resize(end);
+    pParentNodes.resize(end);
+    pParents.resize(end);
+    pSubtreeSizes.resize(end, 1);
+    pLocals.insert(pLocals.end(), locals, locals + count);
+    pWorlds.resize(end);
+    pDirty.resize(end, 0);
+    pIndices.resize(pIndices.size() + count);
+
+    for (uint32_t i = 0; i < count; i++) {
+      const uint32_t index = first + i;
+      const bool     root  = parents[i] == NO_SCENE_NODE;
+
+      pNodes[index]            = first_node + i;
+      pParentNodes[index]      = root ? NO_SCENE_NODE : first_node + parents[i];
+      pParents[index]          = root ? NO_INDEX : first + parents[i];
+      pIndices[first_node + i] = index;
+      pWorlds[index]           = root ? pLocals[index].matrix() : pWorlds[pParents[index]] * pLocals[index].matrix();
+    }
+
+    // Children come after their parents, so walking backwards every subtree is complete before it is added up
+    for (uint32_t index = end; index-- > first;) {
+      if (pParents[index] != NO_INDEX) {
+        pSubtreeSizes[pParents[index]] += pSubtreeSizes[index];
+      }
+    }
+
+    return first_node;
+  }
+
+  void SceneGraph::Destroy(SceneNode node) {
+    assert(IsValid(node) && "Cannot destroy a node twice");
+
+    uint32_t index = pIndices[node];
+    uint32_t count = pSubtreeSizes[index];
+
+    pResizeAncestors(index, -static_cast<int64_t>(count));
+    pMoveToEnd(index, count);
+
+    uint32_t first = static_cast<uint32_t>(pNodes.size()) - count;
+
+    for (uint32_t i = first; i < pNodes.size(); i++) {
+      pIndices[pNodes[i]] = NO_INDEX;
+      pFreeNodes.push_back(pNodes[i]);
+    }
+
+    pNodes.resize(first);
+    pParentNodes.resize(first);
+    pParents.resize(first);
+    pSubtreeSizes.resize(first);
+    pLocals.resize(first);
+    pWorlds.resize(first);
+    pDirty.resize(first);
+  }
+
+  void SceneGraph::SetParent(SceneNode node, SceneNode parent) {
+    assert(IsValid(node) && (parent == NO_SCENE_NODE || IsValid(parent)) && "Cannot reparent destroyed nodes");
+
+    uint32_t index = pIndices[node];
+    uint32_t count = pSubtreeSizes[index];
+
+    if (parent != NO_SCENE_NODE && pIndices[parent] >= index && pIndices[parent] < index + count) {
+      throw std::runtime_error("Cannot parent a scene node to itself or one of its descendants");
+    }
+
+    if (pParentNodes[index] == parent) {
+      return;
+    }
+
+    pResizeAncestors(index, -static_cast<int64_t>(count));
+    pMoveToEnd(index, count);
+
+    uint32_t root      = static_cast<uint32_t>(pNodes.size()) - count;
+    pParentNodes[root] = parent;
+    pParents[root]     = parent == NO_SCENE_NODE ? NO_INDEX : pIndices[parent];
+
+    if (parent != NO_SCENE_NODE) {
+      uint32_t parent_index = pIndices[parent];
+      uint32_t destination  = parent_index + pSubtreeSizes[parent_index];
+
+      pResizeAncestors(root, count);
+      pMoveFromEnd(destination, count);
+    }
+
+    pMarkDirty(pIndices[node]);
+  }
+
+  void SceneGraph::SetLocal(SceneNode node, const TransformComponent& local) {
+    uint32_t index = pIndices[node];
+
+    pLocals[index] = local;
+    pMarkDirty(index);
+  }
+
+  void SceneGraph::Update() {
+    pLastUpdateCount = 0;
+
+    if (pDirtyNodes.empty()) {
+      return;
+    }
+
+    std::vector<uint32_t> dirty_indices;
+    dirty_indices.reserve(pDirtyNodes.size());
+
+    for (SceneNode node : pDirtyNodes) {
+      // Nodes destroyed after being marked are skipped
+      if (IsValid(node) && pDirty[pIndices[node]]) {
+        dirty_indices.push_back(pIndices[node]);
+        pDirty[pIndices[node]] = 0;
+      }
+    }
+
+    pDirtyNodes.clear();
+
+    // Ancestors come first, so a changed node inside a subtree that is already being recomputed is covered by it
+    std::sort(dirty_indices.begin(), dirty_indices.end());
+
+    uint32_t covered_end = 0;
+
+    for (uint32_t first : dirty_indices) {
+      if (first < covered_end) {
+        continue;
+      }
+
+      uint32_t last = first + pSubtreeSizes[first];
+
+      for (uint32_t i = first; i < last; i++) {
+        pWorlds[i] = pParents[i] == NO_INDEX ? pLocals[i].matrix() : pWorlds[pParents[i]] * pLocals[i].matrix();
+      }
+
+      pLastUpdateCount += last - first;
+      covered_end = last;
+    }
+  }
+
+  bool SceneGraph::IsValid(SceneNode node) const { return node < pIndices.size() && pIndices[node] != NO_INDEX; }
+
+  glm::mat4 SceneGraph::getParentWorld(SceneNode node) const {
+    uint32_t parent = pParents[pIndices[node]];
+    return parent == NO_INDEX ? glm::mat4 {1.0f} : pWorlds[parent];
+  }
+
+  void SceneGraph::pMoveToEnd(uint32_t first, uint32_t count) {
+    uint32_t end = first + count;
+
+    if (end == pNodes.size()) {
+      return;
+    }
+
+    auto move = [&](auto& values) { std::rotate(values.begin() + first, values.begin() + end, values.end()); };
+
+    move(pNodes);
+    move(pParentNodes);
+    move(pParents);
+    move(pSubtreeSizes);
+    move(pLocals);
+    move(pWorlds);
+    move(pDirty);
+
+    pRebuildIndices(first);
+  }
+
+  void SceneGraph::pMoveFromEnd(uint32_t destination, uint32_t count) {
+    uint32_t first = static_cast<uint32_t>(pNodes.size()) - count;
+
+    if (destination == first) {
+      return;
+    }
+
+    auto move = [&](auto& values) {
+      std::rotate(values.begin() + destination, values.begin() + first, values.end());
+    };
+
+    move(pNodes);
+    move(pParentNodes);
+    move(pParents);
+    move(pSubtreeSizes);
+    move(pLocals);
+    move(pWorlds);
+    move(pDirty);
+
+    pRebuildIndices(destination);
+  }
+
+  void SceneGraph::pRebuildIndices(uint32_t first) {
+    for (uint32_t i = first; i < pNodes.size(); i++) {
+      pIndices[pNodes[i]] = i;
+    }
+
+    // Parents before first did not move, but a moved node's parent may sit anywhere
+    for (uint32_t i = first; i < pNodes.size(); i++) {
+      pParents[i] = pParentNodes[i] == NO_SCENE_NODE ? NO_INDEX : pIndices[pParentNodes[i]];
+    }
+  }
+
+  void SceneGraph::pResizeAncestors(uint32_t index, int64_t delta) {
+    for (uint32_t parent = pParents[index]; parent != NO_INDEX; parent = pParents[parent]) {
+      pSubtreeSizes[parent] = static_cast<uint32_t>(pSubtreeSizes[parent] + delta);
+    }
+  }
+
+  void SceneGraph::pMarkDirty(uint32_t index) {
+    if (!pDirty[index]) {
+      pDirty[index] = 1;
+      pDirtyNodes.push_back(pNodes[index]);
+    }
+  }
+}
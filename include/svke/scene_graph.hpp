@@ -0,0 +1,80 @@
+#ifndef SVKE_SCENE_GRAPH_HPP
+#define SVKE_SCENE_GRAPH_HPP
+
+#include "defines.hpp"
+#include "game_object.hpp"
+#include "pch_core.hpp"
+
+namespace svke {
+  // Parent / child hierarchy of local transforms and the world matrices derived from them. Nodes live in contiguous
+  // arrays in depth first order, so every parent comes before its children and every subtree is one contiguous range.
+  // Changing a local transform only marks the node, Update then recomputes the range of each topmost changed subtree in
+  // one linear pass and leaves the rest of the scene alone. Structural changes (creating, destroying or reparenting)
+  // move ranges around and cost a pass over the arrays, they are meant to be far rarer than transform changes.
+  class SceneGraph {
+   public:
+    SceneGraph() = default;
+
+    SceneGraph(const SceneGraph& other) = delete;
+    SceneGraph& operator=(const SceneGraph& other) = delete;
+
+   public:
+    SceneNode Create(const TransformComponent& local = {}, SceneNode parent = NO_SCENE_NODE);
+
+    // Adds count nodes that are already in depth first order, such as a loaded scene, in one pass and with their world
+    // matrices computed. parents[i] is the position of node i's parent among them, before i, or NO_SCENE_NODE for a
+    // root. The nodes get consecutive handles, the first is returned.
+    SceneNode Append(uint32_t count, const uint32_t* parents, const TransformComponent* locals);
+
+    // Destroys the node along with all its descendants
+    void Destroy(SceneNode node);
+
+    // Keeps the local transform, so the node moves along with its new parent
+    void SetParent(SceneNode node, SceneNode parent);
+
+    void SetLocal(SceneNode node, const TransformComponent& local);
+    void Update();
+
+    const TransformComponent& getLocal(SceneNode node) const { return pLocals[pIndices[node]]; }
+    const glm::mat4&          getWorld(SceneNode node) const { return pWorlds[pIndices[node]]; }
+    SceneNode                 getParent(SceneNode node) const { return pParentNodes[pIndices[node]]; }
+    uint32_t                  getSubtreeSize(SceneNode node) const { return pSubtreeSizes[pIndices[node]]; }
+    uint32_t                  getSize() const { return static_cast<uint32_t>(pNodes.size()); }
+    uint32_t                  getHandleCount() const { return static_cast<uint32_t>(pIndices.size()); }
+    bool                      IsValid(SceneNode node) const;
+
+    // World matrix of the node's parent, identity for roots
+    glm::mat4 getParentWorld(SceneNode node) const;
+
+    // Nodes whose world matrix the last Update recomputed
+    uint32_t getLastUpdateCount() const { return pLastUpdateCount; }
+
+   private:
+    static constexpr uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
+
+    void pMoveToEnd(uint32_t first, uint32_t count);
+    void pMoveFromEnd(uint32_t destination, uint32_t count);
+    void pRebuildIndices(uint32_t first);
+    void pResizeAncestors(uint32_t index, int64_t delta);
+    void pMarkDirty(uint32_t index);
+
+   private:
+    // Indexed by position in depth first order
+    std::vector<SceneNode>          pNodes;
+    std::vector<SceneNode>          pParentNodes;
+    std::vector<uint32_t>           pParents;  // Positions of pParentNodes, rebuilt whenever nodes move
+    std::vector<uint32_t>           pSubtreeSizes;
+    std::vector<TransformComponent> pLocals;
+    std::vector<glm::mat4>          pWorlds;
+    std::vector<uint8_t>            pDirty;
+
+    // Indexed by node
+    std::vector<uint32_t>  pIndices;
+    std::vector<SceneNode> pFreeNodes;
+
+    std::vector<SceneNode> pDirtyNodes;
+    uint32_t               pLastUpdateCount {0};
+  };
+}
+
+#endif
@@ -1,14 +1,19 @@
 #include "defines.hpp"
 #include "pch.hpp"
+#include "profiler.hpp"
 #include "simple_render_system.hpp"
 
 namespace svke {
-  SimpleRenderSystem::SimpleRenderSystem(Device& device, VkRenderPass render_pass) : pDevice {device} {
+  SimpleRenderSystem::SimpleRenderSystem(Device& device, PipelineLibrary& pipeline_library, Renderer& renderer)
+      : pDevice {device},
+        pPipelineLibrary {pipeline_library},
+        pGpuProfiler {renderer.getGpuProfiler()},
+        pHiZPyramid {renderer.getHiZPyramid()} {
     pCreatePipelineLayout();
-    pCreatePipeline(render_pass);
+    pCreatePipeline(renderer);
   }
 
-  SimpleRenderSystem::~SimpleRenderSystem() { vkDestroyPipelineLayout(pDevice.getDevice(), pPipelineLayout, nullptr); }
+  SimpleRenderSystem::~SimpleRenderSystem() {}
 
   void SimpleRenderSystem::pCreatePipelineLayout() {
     VkPushConstantRange push_constant_range {};
@@ -17,44 +22,129 @@ namespace svke {
     push_constant_range.offset     = 0;
     push_constant_range.size       = sizeof(PushConstantData);
 
-    VkPipelineLayoutCreateInfo pipeline_layout_info {};
-
-    pipeline_layout_info.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipeline_layout_info.setLayoutCount         = 0;
-    pipeline_layout_info.pSetLayouts            = nullptr;
-    pipeline_layout_info.pushConstantRangeCount = 1;
-    pipeline_layout_info.pPushConstantRanges    = &push_constant_range;
-
-    if (vkCreatePipelineLayout(pDevice.getDevice(), &pipeline_layout_info, nullptr, &pPipelineLayout) != VK_SUCCESS) {
-      throw std::runtime_error("Failed to create pipeline layout");
-    }
+    pPipelineLayout = pPipelineLibrary.GetPipelineLayout({}, {push_constant_range});
   }
 
-  void SimpleRenderSystem::pCreatePipeline(VkRenderPass render_pass) {
+  void SimpleRenderSystem::pCreatePipeline(Renderer& renderer) {
     assert(pPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
     PipelineConfig pipeline_config {};
     Pipeline::DefaultPipelineConfig(pipeline_config);
 
-    pipeline_config.render_pass     = render_pass;
+    pipeline_config.render_pass     = renderer.getSwapChainRenderPass();
+    pipeline_config.color_format    = renderer.getSwapChainImageFormat();
+    pipeline_config.depth_format    = renderer.getSwapChainDepthFormat();
     pipeline_config.pipeline_layout = pPipelineLayout;
 
-    pPipeline =
-        std::make_unique<Pipeline>(pDevice, "shaders/simple.vert.spv", "shaders/simple.frag.spv", pipeline_config);
+    pPipeline = pPipelineLibrary.GetPipeline("shaders/simple.vert.spv", "shaders/simple.frag.spv", pipeline_config);
   }
 
-  void SimpleRenderSystem::RenderGameObjects(VkCommandBuffer          command_buffer,
-                                             std::vector<GameObject>& game_objects,
-                                             const Camera&            camera) {
-    pPipeline->Bind(command_buffer);
+  void SimpleRenderSystem::RenderGameObjects(VkCommandBuffer      command_buffer,
+                                             GameObjectPool&      game_objects,
+                                             const ModelRegistry& models,
+                                             const Camera&        camera,
+                                             JobSystem&           job_system,
+                                             float                alpha,
+                                             const SceneGraph*    scene_graph) {
+    SVKE_PROFILE_SCOPE("SimpleRenderSystem::RenderGameObjects");
+
+    pStats = {};
+    pDrawListBuilder.Resize(game_objects.getSize());
+
+    JobCounter transform_counter;
+
+    job_system.ParallelFor(
+        0,
+        game_objects.getSize(),
+        DrawListBuilder::GRAIN,
+        [&](uint32_t begin, uint32_t end) {
+          SVKE_PROFILE_SCOPE("Update transforms");
+
+          for (uint32_t i = begin; i < end; i++) {
+            const auto& object = game_objects[i];
+
+            auto      transform = TransformComponent::Interpolate(object.PreviousTransform, object.Transform, alpha);
+            glm::mat4 world     = transform.matrix();
+
+            if (scene_graph != nullptr && object.Node != NO_SCENE_NODE) {
+              world = scene_graph->getParentWorld(object.Node) * world;
+            }
+
+            // Objects whose model is still streaming in or was removed get empty bounds, which culling drops
+            if (models.IsValid(object.ObjectModel)) {
+              pDrawListBuilder.SetObject(i,
+                                         world,
+                                         models.getBounds(object.ObjectModel),
+                                         pPipeline->getId(),
+                                         object.ObjectModel,
+                                         object.getId());
+            } else {
+              pDrawListBuilder.SetObject(i, world, AABB {}, pPipeline->getId(), NO_MODEL_HANDLE, object.getId());
+            }
+          }
+        },
+        transform_counter);
+
+    ModelHandle previous_model = NO_MODEL_HANDLE;
+
+    for (const auto& object : game_objects) {
+      if (object.ObjectModel != previous_model) {
+        pStats.unsorted_buffer_binds++;
+        previous_model = object.ObjectModel;
+      }
+    }
+
+    pStats.unsorted_pipeline_binds = game_objects.IsEmpty() ? 0 : 1;
+
+    {
+      SVKE_PROFILE_SCOPE("Build draw list");
+
+      const OcclusionBuffer* occlusion = pHiZPyramid.IsEnabled() ? &pHiZPyramid.getOcclusionBuffer() : nullptr;
+
+      pHiZPyramid.SetProjectionView(camera.getProjectionMatrix() * camera.getViewMatrix());
+      pDrawListBuilder.Build(job_system,
+                             camera.getProjectionMatrix(),
+                             camera.getViewMatrix(),
+                             pDrawList,
+                             &transform_counter,
+                             occlusion);
 
-    for (auto& object : game_objects) {
-      object.Transform.rotation.y = glm::mod(object.Transform.rotation.y + 0.001f, glm::two_pi<float>());
-      object.Transform.rotation.x = glm::mod(object.Transform.rotation.x + 0.0005f, glm::two_pi<float>());
+      pStats.occlusion_tested = pDrawListBuilder.getOcclusionTested();
+      pStats.occlusion_culled = pDrawListBuilder.getOcclusionCulled();
+    }
+
+    SVKE_PROFILE_SCOPE("Record draws");
+    GpuScope gpu_scope {pGpuProfiler, command_buffer, "SimpleRenderSystem"};
+
+    // Recording stays on this thread, every draw goes into the frame's single primary command buffer. It reads only
+    // the draw list, the builder's transforms and the registry's draw data, never the objects or models themselves.
+    Pipeline*   bound_pipeline = nullptr;
+    ModelHandle bound_model    = NO_MODEL_HANDLE;
+    ModelHandle touched_model  = NO_MODEL_HANDLE;
+
+    for (const auto& item : pDrawList.getItems()) {
+      const Model::DrawData& draw_data = models.getDrawData(item.model_id);
+
+      // Items come sorted by model, so a visible model is touched about once per frame. An evicted one is requested
+      // again and skipped until it is back.
+      if (touched_model != item.model_id) {
+        models.Touch(item.model_id);
+        touched_model = item.model_id;
+      }
+
+      if (draw_data.vertex_buffer == VK_NULL_HANDLE) {
+        continue;
+      }
+
+      if (bound_pipeline != pPipeline) {
+        pPipeline->Bind(command_buffer);
+        bound_pipeline = pPipeline;
+        pStats.pipeline_binds++;
+      }
 
       PushConstantData push {};
 
-      push.transform = (camera.getProjectionMatrix() * camera.getViewMatrix()) * object.Transform.matrix();
+      push.transform = pDrawListBuilder.getTransform(item.object_index);
 
       vkCmdPushConstants(command_buffer,
                          pPipelineLayout,
@@ -63,8 +153,14 @@ namespace svke {
                          sizeof(PushConstantData),
                          &push);
 
-      object.ObjectModel->Bind(command_buffer);
-      object.ObjectModel->Draw(command_buffer);
+      if (bound_model != item.model_id) {
+        Model::Bind(command_buffer, draw_data);
+        bound_model = item.model_id;
+        pStats.buffer_binds++;
+      }
+
+      Model::Draw(command_buffer, draw_data);
+      pStats.draw_calls++;
     }
   }
 }
@@ -4,18 +4,37 @@
 #include "camera.hpp"
 #include "defines.hpp"
 #include "device.hpp"
+#include "draw_list.hpp"
 #include "game_object.hpp"
+#include "game_object_pool.hpp"
+#include "job_system.hpp"
+#include "model_registry.hpp"
 #include "pch.hpp"
 #include "pipeline.hpp"
+#include "pipeline_library.hpp"
+#include "renderer.hpp"
+#include "scene_graph.hpp"
 
 namespace svke {
   struct PushConstantData {
     glm::mat4 transform {1.0f};
   };
 
+  // Bind counts for the last recorded frame. The unsorted counters are what drawing in object order would have cost.
+  // Occlusion counts cover the objects inside the view frustum, zero while there is no read back pyramid yet.
+  struct RenderStats {
+    uint32_t draw_calls              = 0;
+    uint32_t pipeline_binds          = 0;
+    uint32_t buffer_binds            = 0;
+    uint32_t unsorted_pipeline_binds = 0;
+    uint32_t unsorted_buffer_binds   = 0;
+    uint32_t occlusion_tested        = 0;
+    uint32_t occlusion_culled        = 0;
+  };
+
   class SimpleRenderSystem {
    public:
-    SimpleRenderSystem(Device &device, VkRenderPass render_pass);
+    SimpleRenderSystem(Device &device, PipelineLibrary &pipeline_library, Renderer &renderer);
     ~SimpleRenderSystem();
 
     SimpleRenderSystem(const SimpleRenderSystem &other) = delete;
@@ -23,15 +42,31 @@ namespace svke {
 
    private:
     void pCreatePipelineLayout();
-    void pCreatePipeline(VkRenderPass render_pass);
+    void pCreatePipeline(Renderer &renderer);
 
    public:
-    void RenderGameObjects(VkCommandBuffer command_buffer, std::vector<GameObject> &game_objects, const Camera &camera);
+    // alpha blends each object between its previous and current simulation state. Objects with a scene node are placed
+    // under its parent's world matrix, so scene_graph must be up to date for them. Models are looked up in models.
+    void RenderGameObjects(VkCommandBuffer      command_buffer,
+                           GameObjectPool &     game_objects,
+                           const ModelRegistry &models,
+                           const Camera &       camera,
+                           JobSystem &          job_system,
+                           float                alpha,
+                           const SceneGraph *   scene_graph = nullptr);
+
+    const RenderStats &getStats() const { return pStats; }
 
    private:
-    Device &                  pDevice;
-    std::unique_ptr<Pipeline> pPipeline;
-    VkPipelineLayout          pPipelineLayout;
+    Device &          pDevice;
+    PipelineLibrary & pPipelineLibrary;
+    GpuProfiler &     pGpuProfiler;
+    HiZPyramid &      pHiZPyramid;
+    Pipeline *        pPipeline;
+    VkPipelineLayout  pPipelineLayout;
+    DrawList          pDrawList;
+    DrawListBuilder   pDrawListBuilder;
+    RenderStats       pStats;
   };
 }
 
@@ -7,10 +7,30 @@
 //
 
 #include "application.hpp"
+#include "asset_cache.hpp"
+#include "asset_loader.hpp"
+#include "bvh.hpp"
+#include "deletion_queue.hpp"
 #include "device.hpp"
+#include "game_object_pool.hpp"
+#include "gpu_profiler.hpp"
+#include "hi_z_pyramid.hpp"
+#include "job_system.hpp"
+#include "latency_probe.hpp"
+#include "memory_tracker.hpp"
 #include "model.hpp"
+#include "model_registry.hpp"
+#include "occlusion_buffer.hpp"
 #include "pipeline.hpp"
+#include "pipeline_library.hpp"
+#include "profiler.hpp"
+#include "residency_manager.hpp"
+#include "sampler_cache.hpp"
+#include "scene_file.hpp"
+#include "scene_graph.hpp"
 #include "swap_chain.hpp"
+#include "texture.hpp"
+#include "upload_context.hpp"
 #include "window.hpp"
 
 #endif
\ No newline at end of file
@@ -1,14 +1,80 @@
 #include "defines.hpp"
 #include "pch.hpp"
+#include "profiler.hpp"
 #include "swap_chain.hpp"
 
 namespace svke {
-  SwapChain::SwapChain(Device &device, VkExtent2D window_extent) : pDevice {device}, pWindowExtent {window_extent} {
+  static uint32_t ParseCount(const char *variable, uint32_t fallback) {
+    const char *value = std::getenv(variable);
+
+    if (value == nullptr || *value == '\0') {
+      return fallback;
+    }
+
+    char *        end    = nullptr;
+    unsigned long result = std::strtoul(value, &end, 10);
+
+    if (*end != '\0' || result > std::numeric_limits<uint32_t>::max()) {
+      throw std::runtime_error(std::string("Invalid value for ") + variable + ": " + value);
+    }
+
+    return static_cast<uint32_t>(result);
+  }
+
+  SwapChainConfig SwapChainConfig::FromEnvironment() {
+    SwapChainConfig config {};
+
+    config.frames_in_flight = ParseCount("SVKE_FRAMES_IN_FLIGHT", config.frames_in_flight);
+    config.image_count      = ParseCount("SVKE_SWAPCHAIN_IMAGES", config.image_count);
+
+    if (config.frames_in_flight == 0) {
+      throw std::runtime_error("SVKE_FRAMES_IN_FLIGHT must be at least 1");
+    }
+
+    if (const char *present_mode = std::getenv("SVKE_PRESENT_MODE")) {
+      const std::string name {present_mode};
+
+      if (name == "immediate") {
+        config.present_mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+      } else if (name == "mailbox") {
+        config.present_mode = VK_PRESENT_MODE_MAILBOX_KHR;
+      } else if (name == "fifo") {
+        config.present_mode = VK_PRESENT_MODE_FIFO_KHR;
+      } else if (name == "fifo_relaxed") {
+        config.present_mode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+      } else {
+        throw std::runtime_error("Invalid value for SVKE_PRESENT_MODE: " + name);
+      }
+    }
+
+    return config;
+  }
+
+  const char *PresentModeName(VkPresentModeKHR present_mode) {
+    switch (present_mode) {
+      case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "Immediate";
+      case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "Mailbox";
+      case VK_PRESENT_MODE_FIFO_KHR:
+        return "V-Sync";
+      case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "Relaxed V-Sync";
+      default:
+        return "Unknown";
+    }
+  }
+
+  SwapChain::SwapChain(Device &device, VkExtent2D window_extent, const SwapChainConfig &config)
+      : pConfig {config}, pDevice {device}, pWindowExtent {window_extent} {
     pInitSwapChain();
   }
 
-  SwapChain::SwapChain(Device &device, VkExtent2D window_extent, std::shared_ptr<SwapChain> previous)
-      : pDevice {device}, pWindowExtent {window_extent}, pOldSwapChain {previous} {
+  SwapChain::SwapChain(Device &                   device,
+                       VkExtent2D                 window_extent,
+                       const SwapChainConfig &    config,
+                       std::shared_ptr<SwapChain> previous)
+      : pConfig {config}, pDevice {device}, pWindowExtent {window_extent}, pOldSwapChain {previous} {
     pInitSwapChain();
 
     pOldSwapChain = nullptr;
@@ -20,7 +86,12 @@ namespace svke {
     pCreateRenderPass();
     pCreateDepthResources();
     pCreateFramebuffers();
-    pCreateSyncObjects();
+
+    if (pOldSwapChain != nullptr && pOldSwapChain->pConfig.frames_in_flight == pConfig.frames_in_flight) {
+      pAdoptSyncObjects(*pOldSwapChain);
+    } else {
+      pCreateSyncObjects();
+    }
   }
 
   SwapChain::~SwapChain() {
@@ -38,7 +109,7 @@ namespace svke {
     for (uint64_t i = 0; i < pDepthImages.size(); i++) {
       vkDestroyImageView(pDevice.getDevice(), pDepthImageViews[i], nullptr);
       vkDestroyImage(pDevice.getDevice(), pDepthImages[i], nullptr);
-      vkFreeMemory(pDevice.getDevice(), pDepthImageMemorys[i], nullptr);
+      pDevice.FreeMemory(pDepthImageMemorys[i]);
     }
 
     for (auto framebuffer : pSwapChainFramebuffers) {
@@ -47,16 +118,37 @@ namespace svke {
 
     vkDestroyRenderPass(pDevice.getDevice(), pRenderPass, nullptr);
 
-    for (uint64_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    // Empty when a newer swap chain took the sync objects over
+    for (uint64_t i = 0; i < pImageAvailableSemaphores.size(); i++) {
       vkDestroySemaphore(pDevice.getDevice(), pRenderFinishedSemaphores[i], nullptr);
       vkDestroySemaphore(pDevice.getDevice(), pImageAvailableSemaphores[i], nullptr);
-      vkDestroyFence(pDevice.getDevice(), pInFlightFences[i], nullptr);
+    }
+
+    for (auto fence : pInFlightFences) {
+      vkDestroyFence(pDevice.getDevice(), fence, nullptr);
     }
   }
 
   VkResult SwapChain::AcquireNextImage(uint32_t *imageIndex) {
-    vkWaitForFences(
-        pDevice.getDevice(), 1, &pInFlightFences[pCurrentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+    SVKE_PROFILE_SCOPE("SwapChain::AcquireNextImage");
+
+    {
+      SVKE_PROFILE_SCOPE("Wait for frame slot");
+
+      if (pDevice.SupportsTimelineSemaphores()) {
+        // The frame that last used this slot has the frame value frames_in_flight below the one about to be recorded
+        uint64_t frame_value = pDevice.getFrameValue();
+
+        if (frame_value > pConfig.frames_in_flight) {
+          pDevice.WaitFrameValue(frame_value - pConfig.frames_in_flight);
+        }
+      } else {
+        vkWaitForFences(
+            pDevice.getDevice(), 1, &pInFlightFences[pCurrentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+      }
+    }
+
+    SVKE_PROFILE_SCOPE("vkAcquireNextImageKHR");
 
     return vkAcquireNextImageKHR(pDevice.getDevice(),
                                  pSwapChain,
@@ -66,33 +158,83 @@ namespace svke {
                                  imageIndex);
   }
 
-  VkResult SwapChain::SubmitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) {
-    if (pInFlightImages[*imageIndex] != VK_NULL_HANDLE) {
-      vkWaitForFences(pDevice.getDevice(), 1, &pInFlightImages[*imageIndex], VK_TRUE, UINT64_MAX);
-    }
+  VkResult SwapChain::SubmitCommandBuffers(const VkCommandBuffer *          buffers,
+                                           uint32_t *                       imageIndex,
+                                           const std::vector<TimelineWait> &timeline_waits) {
+    assert((timeline_waits.empty() || pDevice.SupportsTimelineSemaphores()) &&
+           "Timeline waits need timeline semaphore support");
+
+    SVKE_PROFILE_SCOPE("SwapChain::SubmitCommandBuffers");
+
+    const bool     use_timeline = pDevice.SupportsTimelineSemaphores();
+    const uint64_t frame_value  = pDevice.getFrameValue();
+
+    if (use_timeline) {
+      if (pImageFrameValues[*imageIndex] != 0) {
+        SVKE_PROFILE_SCOPE("Wait for image");
+        pDevice.WaitFrameValue(pImageFrameValues[*imageIndex]);
+      }
 
-    pInFlightImages[*imageIndex] = pInFlightFences[pCurrentFrame];
+      pImageFrameValues[*imageIndex] = frame_value;
+      pFrameValues[pCurrentFrame]    = frame_value;
+    } else {
+      if (pInFlightImages[*imageIndex] != VK_NULL_HANDLE) {
+        SVKE_PROFILE_SCOPE("Wait for image");
+        vkWaitForFences(pDevice.getDevice(), 1, &pInFlightImages[*imageIndex], VK_TRUE, UINT64_MAX);
+      }
+
+      pInFlightImages[*imageIndex] = pInFlightFences[pCurrentFrame];
+    }
 
     VkSubmitInfo submit_info = {};
     submit_info.sType        = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    VkSemaphore          wait_semaphores[] = {pImageAvailableSemaphores[pCurrentFrame]};
-    VkPipelineStageFlags wait_stages[]     = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    // The binary image available semaphore ignores its wait value
+    std::vector<VkSemaphore>          wait_semaphores = {pImageAvailableSemaphores[pCurrentFrame]};
+    std::vector<VkPipelineStageFlags> wait_stages     = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    std::vector<uint64_t>             wait_values     = {0};
 
-    submit_info.waitSemaphoreCount = 1;
-    submit_info.pWaitSemaphores    = wait_semaphores;
-    submit_info.pWaitDstStageMask  = wait_stages;
+    for (const auto &wait : timeline_waits) {
+      wait_semaphores.push_back(wait.semaphore);
+      wait_stages.push_back(wait.stages);
+      wait_values.push_back(wait.value);
+    }
+
+    submit_info.waitSemaphoreCount = static_cast<uint32_t>(wait_semaphores.size());
+    submit_info.pWaitSemaphores    = wait_semaphores.data();
+    submit_info.pWaitDstStageMask  = wait_stages.data();
 
     submit_info.commandBufferCount = 1;
     submit_info.pCommandBuffers    = buffers;
 
-    VkSemaphore signal_semaphores[]  = {pRenderFinishedSemaphores[pCurrentFrame]};
-    submit_info.signalSemaphoreCount = 1;
+    // The binary render finished semaphore ignores its value, the frame timeline is signaled with the frame value
+    VkSemaphore signal_semaphores[] = {pRenderFinishedSemaphores[pCurrentFrame], pDevice.getFrameTimeline()};
+    uint64_t    signal_values[]     = {0, frame_value};
+
+    VkTimelineSemaphoreSubmitInfo timeline_info = {};
+    timeline_info.sType                         = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_info.waitSemaphoreValueCount       = static_cast<uint32_t>(wait_values.size());
+    timeline_info.pWaitSemaphoreValues          = wait_values.data();
+    timeline_info.signalSemaphoreValueCount     = 2;
+    timeline_info.pSignalSemaphoreValues        = signal_values;
+
+    submit_info.signalSemaphoreCount = use_timeline ? 2 : 1;
     submit_info.pSignalSemaphores    = signal_semaphores;
+    submit_info.pNext                = use_timeline ? &timeline_info : nullptr;
+
+    VkFence submit_fence = VK_NULL_HANDLE;
 
-    vkResetFences(pDevice.getDevice(), 1, &pInFlightFences[pCurrentFrame]);
-    if (vkQueueSubmit(pDevice.getGraphicsQueue(), 1, &submit_info, pInFlightFences[pCurrentFrame]) != VK_SUCCESS) {
-      throw std::runtime_error("Failed to submit draw command buffer");
+    if (!use_timeline) {
+      submit_fence = pInFlightFences[pCurrentFrame];
+      vkResetFences(pDevice.getDevice(), 1, &submit_fence);
+    }
+
+    {
+      auto queue_lock = pDevice.LockQueue(pDevice.getGraphicsQueue());
+
+      if (vkQueueSubmit(pDevice.getGraphicsQueue(), 1, &submit_info, submit_fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit draw command buffer");
+      }
     }
 
     VkPresentInfoKHR present_info = {};
@@ -107,13 +249,27 @@ namespace svke {
 
     present_info.pImageIndices = imageIndex;
 
-    auto result = vkQueuePresentKHR(pDevice.getPresentQueue(), &present_info);
+    VkResult result;
 
-    pCurrentFrame = (pCurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    {
+      SVKE_PROFILE_SCOPE("vkQueuePresentKHR");
+      auto queue_lock = pDevice.LockQueue(pDevice.getPresentQueue());
+      result          = vkQueuePresentKHR(pDevice.getPresentQueue(), &present_info);
+    }
+
+    pCurrentFrame = (pCurrentFrame + 1) % pConfig.frames_in_flight;
 
     return result;
   }
 
+  bool SwapChain::IsFrameComplete(uint32_t frame) {
+    if (pDevice.SupportsTimelineSemaphores()) {
+      return pFrameValues[frame] <= pDevice.QueryCompletedFrameValue();
+    }
+
+    return vkGetFenceStatus(pDevice.getDevice(), pInFlightFences[frame]) == VK_SUCCESS;
+  }
+
   void SwapChain::pCreateSwapChain() {
     SwapChainSupportDetails swapChainSupport = pDevice.getSwapChainSupport();
 
@@ -123,6 +279,10 @@ namespace svke {
 
     uint32_t image_count = swapChainSupport.capabilities.minImageCount + 1;
 
+    if (pConfig.image_count != 0) {
+      image_count = std::max(pConfig.image_count, swapChainSupport.capabilities.minImageCount);
+    }
+
     if (swapChainSupport.capabilities.maxImageCount > 0 && image_count > swapChainSupport.capabilities.maxImageCount) {
       image_count = swapChainSupport.capabilities.maxImageCount;
     }
@@ -172,6 +332,7 @@ namespace svke {
     pSwapChainImages.resize(image_count);
     vkGetSwapchainImagesKHR(pDevice.getDevice(), pSwapChain, &image_count, pSwapChainImages.data());
 
+    pPresentMode          = present_mode;
     pSwapChainImageFormat = surface_format.format;
     pSwapChainExtent      = window_extent;
   }
@@ -204,11 +365,11 @@ namespace svke {
     depth_attachment.format         = FindDepthFormat();
     depth_attachment.samples        = VK_SAMPLE_COUNT_1_BIT;
     depth_attachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depth_attachment.storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth_attachment.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
     depth_attachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     depth_attachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-    depth_attachment.finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depth_attachment.finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;  // Read by the Hi-Z pyramid
 
     VkAttachmentReference depth_attachment_ref {};
 
@@ -238,16 +399,26 @@ namespace svke {
     subpass.pColorAttachments       = &color_attachment_ref;
     subpass.pDepthStencilAttachment = &depth_attachment_ref;
 
-    VkSubpassDependency dependency = {};
+    std::array<VkSubpassDependency, 2> dependencies = {};
 
-    dependency.dstSubpass    = 0;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    dependency.dstStageMask =
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.srcSubpass    = VK_SUBPASS_EXTERNAL;
-    dependency.srcAccessMask = 0;
-    dependency.srcStageMask =
+    // The depth attachment may still be read by the compute pass of the last frame that rendered to it
+    dependencies[0].dstSubpass    = 0;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[0].dstStageMask =
         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependencies[0].srcSubpass    = VK_SUBPASS_EXTERNAL;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                   VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+    // Depth writes finish before the Hi-Z pyramid samples the attachment
+    dependencies[1].srcSubpass    = 0;
+    dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[1].srcStageMask =
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[1].dstSubpass    = VK_SUBPASS_EXTERNAL;
+    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    dependencies[1].dstStageMask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
 
     std::array<VkAttachmentDescription, 2> attachments      = {color_attachment, depth_attachment};
     VkRenderPassCreateInfo                 render_pass_info = {};
@@ -257,8 +428,8 @@ namespace svke {
     render_pass_info.pAttachments    = attachments.data();
     render_pass_info.subpassCount    = 1;
     render_pass_info.pSubpasses      = &subpass;
-    render_pass_info.dependencyCount = 1;
-    render_pass_info.pDependencies   = &dependency;
+    render_pass_info.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    render_pass_info.pDependencies   = dependencies.data();
 
     if (vkCreateRenderPass(pDevice.getDevice(), &render_pass_info, nullptr, &pRenderPass) != VK_SUCCESS) {
       throw std::runtime_error("Failed to create render pass");
@@ -310,13 +481,16 @@ namespace svke {
       image_info.format        = depthFormat;
       image_info.tiling        = VK_IMAGE_TILING_OPTIMAL;
       image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-      image_info.usage         = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+      image_info.usage         = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
       image_info.samples       = VK_SAMPLE_COUNT_1_BIT;
       image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
       image_info.flags         = 0;
 
-      pDevice.CreateImageWithInfo(
-          image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pDepthImages[i], pDepthImageMemorys[i]);
+      pDevice.CreateImageWithInfo(image_info,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  pDepthImages[i],
+                                  pDepthImageMemorys[i],
+                                  MemoryCategory::Depth);
 
       VkImageViewCreateInfo view_info {};
 
@@ -339,10 +513,18 @@ namespace svke {
   }
 
   void SwapChain::pCreateSyncObjects() {
-    pImageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    pRenderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    pInFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    pInFlightImages.resize(getImageCount(), VK_NULL_HANDLE);
+    const bool use_timeline = pDevice.SupportsTimelineSemaphores();
+
+    pImageAvailableSemaphores.resize(pConfig.frames_in_flight);
+    pRenderFinishedSemaphores.resize(pConfig.frames_in_flight);
+
+    if (use_timeline) {
+      pFrameValues.resize(pConfig.frames_in_flight, 0);
+      pImageFrameValues.resize(getImageCount(), 0);
+    } else {
+      pInFlightFences.resize(pConfig.frames_in_flight);
+      pInFlightImages.resize(getImageCount(), VK_NULL_HANDLE);
+    }
 
     VkSemaphoreCreateInfo semaphore_info = {};
     semaphore_info.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -351,17 +533,37 @@ namespace svke {
     fence_info.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fence_info.flags             = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    for (uint64_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (uint64_t i = 0; i < pConfig.frames_in_flight; i++) {
       if (vkCreateSemaphore(pDevice.getDevice(), &semaphore_info, nullptr, &pImageAvailableSemaphores[i]) !=
               VK_SUCCESS ||
           vkCreateSemaphore(pDevice.getDevice(), &semaphore_info, nullptr, &pRenderFinishedSemaphores[i]) !=
               VK_SUCCESS ||
-          vkCreateFence(pDevice.getDevice(), &fence_info, nullptr, &pInFlightFences[i]) != VK_SUCCESS) {
+          (!use_timeline &&
+           vkCreateFence(pDevice.getDevice(), &fence_info, nullptr, &pInFlightFences[i]) != VK_SUCCESS)) {
         throw std::runtime_error("Failed to create synchronization objects for a frame");
       }
     }
   }
 
+  void SwapChain::pAdoptSyncObjects(SwapChain &previous) {
+    pImageAvailableSemaphores = std::move(previous.pImageAvailableSemaphores);
+    pRenderFinishedSemaphores = std::move(previous.pRenderFinishedSemaphores);
+    pInFlightFences           = std::move(previous.pInFlightFences);
+    pFrameValues              = std::move(previous.pFrameValues);
+    pCurrentFrame             = previous.pCurrentFrame;
+
+    previous.pImageAvailableSemaphores.clear();
+    previous.pRenderFinishedSemaphores.clear();
+    previous.pInFlightFences.clear();
+
+    // The images are new, none of them is used by a frame yet
+    if (pDevice.SupportsTimelineSemaphores()) {
+      pImageFrameValues.resize(getImageCount(), 0);
+    } else {
+      pInFlightImages.resize(getImageCount(), VK_NULL_HANDLE);
+    }
+  }
+
   VkSurfaceFormatKHR SwapChain::pChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats) {
     for (const auto &available_format : availableFormats) {
       if (available_format.format == VK_FORMAT_B8G8R8A8_SRGB &&
@@ -374,26 +576,23 @@ namespace svke {
   }
 
   VkPresentModeKHR SwapChain::pChooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes) {
-    for (const auto &available_present_mode : availablePresentModes) {
-      if (available_present_mode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-#ifdef SVKE_VERBOSE_PRESENT_MODE
-        std::cout << "Present mode: Immediate" << std::endl;
-#endif
-        return available_present_mode;
-      }
-    }
+    // The configured mode first, then the lowest latency mode available. FIFO support is guaranteed by the spec.
+    const std::array<VkPresentModeKHR, 3> preference = {
+        pConfig.present_mode, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR};
 
-    for (const auto &available_present_mode : availablePresentModes) {
-      if (available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR) {
+    for (auto present_mode : preference) {
+      for (const auto &available_present_mode : availablePresentModes) {
+        if (available_present_mode == present_mode) {
 #ifdef SVKE_VERBOSE_PRESENT_MODE
-        std::cout << "Present mode: Mailbox" << std::endl;
+          std::cout << "Present mode: " << PresentModeName(present_mode) << std::endl;
 #endif
-        return available_present_mode;
+          return available_present_mode;
+        }
       }
     }
 
 #ifdef SVKE_VERBOSE_PRESENT_MODE
-    std::cout << "Present mode: V-Sync" << std::endl;
+    std::cout << "Present mode: " << PresentModeName(VK_PRESENT_MODE_FIFO_KHR) << std::endl;
 #endif
     return VK_PRESENT_MODE_FIFO_KHR;
   }
@@ -418,6 +617,6 @@ namespace svke {
     return pDevice.FindSupportedFormat(
         {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
         VK_IMAGE_TILING_OPTIMAL,
-        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
   }
 }
@@ -5,13 +5,35 @@
 #include "device.hpp"
 #include "pch.hpp"
 
-#define MAX_FRAMES_IN_FLIGHT 2
-
 namespace svke {
+  struct SwapChainConfig {
+    uint32_t         frames_in_flight = 2;
+    VkPresentModeKHR present_mode     = VK_PRESENT_MODE_IMMEDIATE_KHR;  // Preferred, falls back when unsupported
+    uint32_t         image_count      = 0;                              // 0 uses one more than the surface minimum
+
+    // Defaults overridden by SVKE_FRAMES_IN_FLIGHT, SVKE_PRESENT_MODE (immediate, mailbox, fifo, fifo_relaxed) and
+    // SVKE_SWAPCHAIN_IMAGES
+    static SwapChainConfig FromEnvironment();
+
+    bool operator==(const SwapChainConfig &other) const {
+      return frames_in_flight == other.frames_in_flight && present_mode == other.present_mode &&
+             image_count == other.image_count;
+    }
+    bool operator!=(const SwapChainConfig &other) const { return !(*this == other); }
+  };
+
+  const char *PresentModeName(VkPresentModeKHR present_mode);
+
+  // A swap chain created from a previous one with the same number of frames in flight takes over its per frame sync
+  // objects and frame index, so frames already submitted on the old swap chain keep being waited on as usual. The old
+  // swap chain must then be kept alive until those frames have completed.
   class SwapChain {
    public:
-    SwapChain(Device &device, VkExtent2D window_extent);
-    SwapChain(Device &device, VkExtent2D window_extent, std::shared_ptr<SwapChain> previous);
+    SwapChain(Device &device, VkExtent2D window_extent, const SwapChainConfig &config);
+    SwapChain(Device &                   device,
+              VkExtent2D                 window_extent,
+              const SwapChainConfig &    config,
+              std::shared_ptr<SwapChain> previous);
     ~SwapChain();
 
     SwapChain(const SwapChain &other) = delete;
@@ -21,12 +43,19 @@ namespace svke {
     VkFramebuffer getFrameBuffer(int index) { return pSwapChainFramebuffers[index]; }
     VkRenderPass  getRenderPass() { return pRenderPass; }
     VkImageView   getImageView(int index) { return pSwapChainImageViews[index]; }
+    VkImageView   getDepthImageView(int index) { return pDepthImageViews[index]; }
     uint64_t      getImageCount() { return pSwapChainImages.size(); }
     VkFormat      getSwapChainImageFormat() { return pSwapChainImageFormat; }
+    VkFormat      getSwapChainDepthFormat() { return pSwapChainDepthFormat; }
     VkExtent2D    getSwapChainExtent() { return pSwapChainExtent; }
     uint32_t      getWidth() { return pSwapChainExtent.width; }
     uint32_t      getHeight() { return pSwapChainExtent.height; }
 
+    const SwapChainConfig &getConfig() const { return pConfig; }
+    uint32_t               getFramesInFlight() const { return pConfig.frames_in_flight; }
+    VkPresentModeKHR       getPresentMode() const { return pPresentMode; }
+    uint32_t               getCurrentFrame() const { return static_cast<uint32_t>(pCurrentFrame); }
+
    public:
     float getExtentAspectRatio() {
       return static_cast<float>(pSwapChainExtent.width) / static_cast<float>(pSwapChainExtent.height);
@@ -40,7 +69,13 @@ namespace svke {
    public:
     VkFormat FindDepthFormat();
     VkResult AcquireNextImage(uint32_t *image_index);
-    VkResult SubmitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *image_index);
+    // Extra timeline waits, such as for uploads on another queue, need the device's timeline semaphore support
+    VkResult SubmitCommandBuffers(const VkCommandBuffer *          buffers,
+                                  uint32_t *                       image_index,
+                                  const std::vector<TimelineWait> &timeline_waits = {});
+
+    // Whether the last frame submitted in the given frame slot has finished on the GPU, without waiting
+    bool IsFrameComplete(uint32_t frame);
 
    private:
     void pInitSwapChain();
@@ -50,6 +85,7 @@ namespace svke {
     void pCreateRenderPass();
     void pCreateFramebuffers();
     void pCreateSyncObjects();
+    void pAdoptSyncObjects(SwapChain &previous);
 
    private:
     VkSurfaceFormatKHR pChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats);
@@ -57,9 +93,11 @@ namespace svke {
     VkExtent2D         pChooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities);
 
    private:
-    VkFormat   pSwapChainImageFormat;
-    VkFormat   pSwapChainDepthFormat;
-    VkExtent2D pSwapChainExtent;
+    SwapChainConfig  pConfig;
+    VkPresentModeKHR pPresentMode;
+    VkFormat         pSwapChainImageFormat;
+    VkFormat         pSwapChainDepthFormat;
+    VkExtent2D       pSwapChainExtent;
 
    private:
     std::vector<VkFramebuffer> pSwapChainFramebuffers;
@@ -81,9 +119,15 @@ namespace svke {
    private:
     std::vector<VkSemaphore> pImageAvailableSemaphores;
     std::vector<VkSemaphore> pRenderFinishedSemaphores;
-    std::vector<VkFence>     pInFlightFences;
-    std::vector<VkFence>     pInFlightImages;
     uint64_t                 pCurrentFrame = 0;
+
+    // Fence scheme, used when the device has no timeline semaphores
+    std::vector<VkFence> pInFlightFences;
+    std::vector<VkFence> pInFlightImages;
+
+    // Timeline scheme, the frame value last submitted in each frame slot and last rendered to each image
+    std::vector<uint64_t> pFrameValues;
+    std::vector<uint64_t> pImageFrameValues;
   };
 }
 
@@ -0,0 +1,552 @@
+#include "texture.hpp"
+
+#include "defines.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  static constexpr uint32_t FourCC(char a, char b, char c, char d) {
+    return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) |
+           (static_cast<uint32_t>(d) << 24);
+  }
+
+  template <typename T>
+  static T ReadValue(const std::vector<uint8_t>& file, size_t offset) {
+    if (offset + sizeof(T) > file.size()) {
+      throw std::runtime_error("Texture file is truncated");
+    }
+
+    T value;
+    memcpy(&value, file.data() + offset, sizeof(T));
+
+    return value;
+  }
+
+  // Levels of a full mip chain down to 1x1, the most a texture file may hold
+  static uint32_t FullMipCount(uint32_t width, uint32_t height) {
+    uint32_t count = 1;
+
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+      count++;
+    }
+
+    return count;
+  }
+
+  static std::vector<uint8_t> ReadBinaryFile(const std::string& path) {
+    std::ifstream file {path, std::ios::ate | std::ios::binary};
+
+    if (!file.is_open()) {
+      throw std::runtime_error("Failed to open file: " + path);
+    }
+
+    std::vector<uint8_t> bytes(static_cast<size_t>(file.tellg()));
+
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+    return bytes;
+  }
+
+  static void RecordImageBarrier(VkCommandBuffer      command_buffer,
+                                 VkImage              image,
+                                 uint32_t             base_mip,
+                                 uint32_t             mip_count,
+                                 VkImageLayout        old_layout,
+                                 VkImageLayout        new_layout,
+                                 VkPipelineStageFlags src_stage,
+                                 VkAccessFlags        src_access,
+                                 VkPipelineStageFlags dst_stage,
+                                 VkAccessFlags        dst_access) {
+    VkImageMemoryBarrier barrier {};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout                       = old_layout;
+    barrier.newLayout                       = new_layout;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.srcAccessMask                   = src_access;
+    barrier.dstAccessMask                   = dst_access;
+    barrier.image                           = image;
+    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel   = base_mip;
+    barrier.subresourceRange.levelCount     = mip_count;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = 1;
+
+    vkCmdPipelineBarrier(command_buffer, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+  }
+
+  // DXGI_FORMAT values of the DX10 DDS header extension
+  static const std::unordered_map<uint32_t, VkFormat> DXGI_FORMATS = {
+      {28, VK_FORMAT_R8G8B8A8_UNORM},
+      {29, VK_FORMAT_R8G8B8A8_SRGB},
+      {71, VK_FORMAT_BC1_RGBA_UNORM_BLOCK},
+      {72, VK_FORMAT_BC1_RGBA_SRGB_BLOCK},
+      {74, VK_FORMAT_BC2_UNORM_BLOCK},
+      {75, VK_FORMAT_BC2_SRGB_BLOCK},
+      {77, VK_FORMAT_BC3_UNORM_BLOCK},
+      {78, VK_FORMAT_BC3_SRGB_BLOCK},
+      {80, VK_FORMAT_BC4_UNORM_BLOCK},
+      {81, VK_FORMAT_BC4_SNORM_BLOCK},
+      {83, VK_FORMAT_BC5_UNORM_BLOCK},
+      {84, VK_FORMAT_BC5_SNORM_BLOCK},
+      {87, VK_FORMAT_B8G8R8A8_UNORM},
+      {91, VK_FORMAT_B8G8R8A8_SRGB},
+      {95, VK_FORMAT_BC6H_UFLOAT_BLOCK},
+      {96, VK_FORMAT_BC6H_SFLOAT_BLOCK},
+      {98, VK_FORMAT_BC7_UNORM_BLOCK},
+      {99, VK_FORMAT_BC7_SRGB_BLOCK},
+  };
+
+  bool TextureData::IsBlockCompressed() const {
+    return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+  }
+
+  VkDeviceSize TextureData::getSize() const {
+    VkDeviceSize size = 0;
+
+    for (const auto& mip : mips) {
+      size += mip.size;
+    }
+
+    return size;
+  }
+
+  TextureData TextureData::DropMips(uint32_t count) const {
+    count = std::min(count, static_cast<uint32_t>(mips.size()) - 1);
+
+    TextureData data;
+    data.format = format;
+    data.width  = mips[count].width;
+    data.height = mips[count].height;
+
+    for (uint32_t level = count; level < mips.size(); level++) {
+      data.pAddMip(bytes.data() + mips[level].offset, mips[level].size, mips[level].width, mips[level].height);
+    }
+
+    return data;
+  }
+
+  VkDeviceSize TextureData::ImageSize(VkFormat format, uint32_t width, uint32_t height) {
+    VkDeviceSize blocks_wide = std::max(1u, (width + 3) / 4);
+    VkDeviceSize blocks_high = std::max(1u, (height + 3) / 4);
+
+    switch (format) {
+      case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+      case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+      case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+      case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+      case VK_FORMAT_BC4_UNORM_BLOCK:
+      case VK_FORMAT_BC4_SNORM_BLOCK:
+        return blocks_wide * blocks_high * 8;
+
+      case VK_FORMAT_BC2_UNORM_BLOCK:
+      case VK_FORMAT_BC2_SRGB_BLOCK:
+      case VK_FORMAT_BC3_UNORM_BLOCK:
+      case VK_FORMAT_BC3_SRGB_BLOCK:
+      case VK_FORMAT_BC5_UNORM_BLOCK:
+      case VK_FORMAT_BC5_SNORM_BLOCK:
+      case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+      case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+      case VK_FORMAT_BC7_UNORM_BLOCK:
+      case VK_FORMAT_BC7_SRGB_BLOCK:
+        return blocks_wide * blocks_high * 16;
+
+      case VK_FORMAT_R8G8B8A8_UNORM:
+      case VK_FORMAT_R8G8B8A8_SRGB:
+      case VK_FORMAT_B8G8R8A8_UNORM:
+      case VK_FORMAT_B8G8R8A8_SRGB:
+        return static_cast<VkDeviceSize>(width) * height * 4;
+
+      default:
+        return 0;
+    }
+  }
+
+  void TextureData::pAddMip(const uint8_t* data, VkDeviceSize size, uint32_t mip_width, uint32_t mip_height) {
+    // Buffer to image copies need offsets aligned to the texel block size, 16 covers every supported format
+    VkDeviceSize offset = (bytes.size() + 15) & ~VkDeviceSize {15};
+
+    bytes.resize(offset + size);
+    memcpy(bytes.data() + offset, data, static_cast<size_t>(size));
+
+    mips.push_back({offset, size, mip_width, mip_height});
+  }
+
+  TextureData TextureData::FromFile(const std::string& path) { return FromMemory(ReadBinaryFile(path)); }
+
+  TextureData TextureData::FromMemory(const std::vector<uint8_t>& file) {
+    if (file.size() >= 4 && ReadValue<uint32_t>(file, 0) == FourCC('D', 'D', 'S', ' ')) {
+      return FromDds(file);
+    }
+
+    return FromKtx2(file);
+  }
+
+  TextureData TextureData::FromKtx2(const std::vector<uint8_t>& file) {
+    static const uint8_t IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+    if (file.size() < sizeof(IDENTIFIER) || memcmp(file.data(), IDENTIFIER, sizeof(IDENTIFIER)) != 0) {
+      throw std::runtime_error("Texture file is neither KTX2 nor DDS");
+    }
+
+    TextureData data;
+    data.format = static_cast<VkFormat>(ReadValue<uint32_t>(file, 12));
+    data.width  = ReadValue<uint32_t>(file, 20);
+    data.height = ReadValue<uint32_t>(file, 24);
+
+    uint32_t depth            = ReadValue<uint32_t>(file, 28);
+    uint32_t layer_count      = ReadValue<uint32_t>(file, 32);
+    uint32_t face_count       = ReadValue<uint32_t>(file, 36);
+    uint32_t level_count      = std::max(1u, ReadValue<uint32_t>(file, 40));
+    uint32_t supercompression = ReadValue<uint32_t>(file, 44);
+
+    if (depth > 1 || layer_count > 1 || face_count != 1) {
+      throw std::runtime_error("Only 2D KTX2 textures are supported");
+    }
+
+    if (supercompression != 0) {
+      throw std::runtime_error("Supercompressed KTX2 textures are not supported");
+    }
+
+    if (ImageSize(data.format, data.width, data.height) == 0) {
+      throw std::runtime_error("Unsupported KTX2 texture format");
+    }
+
+    if (level_count > FullMipCount(data.width, data.height)) {
+      throw std::runtime_error("KTX2 texture has more levels than its size allows");
+    }
+
+    // The level index follows the 80 byte header, level 0 is the base level
+    for (uint32_t level = 0; level < level_count; level++) {
+      uint64_t offset = ReadValue<uint64_t>(file, 80 + level * 24);
+      uint64_t length = ReadValue<uint64_t>(file, 80 + level * 24 + 8);
+
+      uint32_t     mip_width  = std::max(1u, data.width >> level);
+      uint32_t     mip_height = std::max(1u, data.height >> level);
+      VkDeviceSize mip_size   = ImageSize(data.format, mip_width, mip_height);
+
+      if (length < mip_size || offset > file.size() || mip_size > file.size() - offset) {
+        throw std::runtime_error("KTX2 texture level is truncated");
+      }
+
+      data.pAddMip(file.data() + offset, mip_size, mip_width, mip_height);
+    }
+
+    return data;
+  }
+
+  TextureData TextureData::FromDds(const std::vector<uint8_t>& file) {
+    constexpr uint32_t DDPF_FOURCC      = 0x4;
+    constexpr uint32_t DDPF_RGB         = 0x40;
+    constexpr uint32_t DDSCAPS2_CUBE    = 0x200;
+    constexpr uint32_t DDS_HEADER_SIZE  = 128;  // Magic and DDS_HEADER
+    constexpr uint32_t DX10_HEADER_SIZE = 20;
+
+    if (ReadValue<uint32_t>(file, 0) != FourCC('D', 'D', 'S', ' ') || ReadValue<uint32_t>(file, 4) != 124) {
+      throw std::runtime_error("Invalid DDS header");
+    }
+
+    TextureData data;
+    data.height = ReadValue<uint32_t>(file, 12);
+    data.width  = ReadValue<uint32_t>(file, 16);
+
+    uint32_t mip_count   = std::max(1u, ReadValue<uint32_t>(file, 28));
+    uint32_t pixel_flags = ReadValue<uint32_t>(file, 80);
+    uint32_t four_cc     = ReadValue<uint32_t>(file, 84);
+    uint32_t bit_count   = ReadValue<uint32_t>(file, 88);
+    uint32_t red_mask    = ReadValue<uint32_t>(file, 92);
+    uint32_t caps2       = ReadValue<uint32_t>(file, 112);
+    size_t   data_offset = DDS_HEADER_SIZE;
+
+    if (caps2 & DDSCAPS2_CUBE) {
+      throw std::runtime_error("Only 2D DDS textures are supported");
+    }
+
+    if ((pixel_flags & DDPF_FOURCC) && four_cc == FourCC('D', 'X', '1', '0')) {
+      uint32_t dxgi_format = ReadValue<uint32_t>(file, DDS_HEADER_SIZE);
+      uint32_t array_size  = ReadValue<uint32_t>(file, DDS_HEADER_SIZE + 12);
+
+      if (array_size > 1) {
+        throw std::runtime_error("Only 2D DDS textures are supported");
+      }
+
+      auto found = DXGI_FORMATS.find(dxgi_format);
+
+      if (found != DXGI_FORMATS.end()) {
+        data.format = found->second;
+      }
+
+      data_offset += DX10_HEADER_SIZE;
+    } else if (pixel_flags & DDPF_FOURCC) {
+      if (four_cc == FourCC('D', 'X', 'T', '1')) {
+        data.format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+      } else if (four_cc == FourCC('D', 'X', 'T', '3')) {
+        data.format = VK_FORMAT_BC2_UNORM_BLOCK;
+      } else if (four_cc == FourCC('D', 'X', 'T', '5')) {
+        data.format = VK_FORMAT_BC3_UNORM_BLOCK;
+      } else if (four_cc == FourCC('A', 'T', 'I', '1') || four_cc == FourCC('B', 'C', '4', 'U')) {
+        data.format = VK_FORMAT_BC4_UNORM_BLOCK;
+      } else if (four_cc == FourCC('A', 'T', 'I', '2') || four_cc == FourCC('B', 'C', '5', 'U')) {
+        data.format = VK_FORMAT_BC5_UNORM_BLOCK;
+      }
+    } else if ((pixel_flags & DDPF_RGB) && bit_count == 32) {
+      data.format = red_mask == 0x000000ff ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_B8G8R8A8_UNORM;
+    }
+
+    if (ImageSize(data.format, data.width, data.height) == 0) {
+      throw std::runtime_error("Unsupported DDS texture format");
+    }
+
+    if (mip_count > FullMipCount(data.width, data.height)) {
+      throw std::runtime_error("DDS texture has more mips than its size allows");
+    }
+
+    // Mips follow each other tightly packed, largest first
+    for (uint32_t level = 0; level < mip_count; level++) {
+      uint32_t     mip_width  = std::max(1u, data.width >> level);
+      uint32_t     mip_height = std::max(1u, data.height >> level);
+      VkDeviceSize mip_size   = ImageSize(data.format, mip_width, mip_height);
+
+      if (data_offset + mip_size > file.size()) {
+        throw std::runtime_error("DDS texture level is truncated");
+      }
+
+      data.pAddMip(file.data() + data_offset, mip_size, mip_width, mip_height);
+      data_offset += mip_size;
+    }
+
+    return data;
+  }
+
+  TextureData TextureData::FromPixels(const void* rgba, uint32_t width, uint32_t height, bool srgb) {
+    TextureData data;
+    data.format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    data.width  = width;
+    data.height = height;
+
+    data.pAddMip(static_cast<const uint8_t*>(rgba), ImageSize(data.format, width, height), width, height);
+
+    return data;
+  }
+
+  Texture::Texture(Device& device, const TextureData& data, bool generate_mips)
+      : pDevice {device}, pFormat {data.format}, pExtent {data.width, data.height} {
+    VkFormatProperties   format_properties = pDevice.getFormatProperties(pFormat);
+    VkFormatFeatureFlags features          = format_properties.optimalTilingFeatures;
+
+    if (!(features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+      throw std::runtime_error("Texture format is not supported by the device");
+    }
+
+    const VkFormatFeatureFlags blit_features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                               VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    // Compressed formats can not be blitted to, their mips have to come with the data
+    bool generate = generate_mips && data.mips.size() == 1 && !data.IsBlockCompressed() &&
+                    (features & blit_features) == blit_features;
+
+    pMipLevels = generate ? FullMipCount(data.width, data.height) : static_cast<uint32_t>(data.mips.size());
+
+    pCreateImage(VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                 (generate ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0));
+    pCreateImageView();
+
+    VkBuffer       staging_buffer;
+    VkDeviceMemory staging_memory;
+
+    pDevice.CreateBuffer(data.bytes.size(),
+                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         staging_buffer,
+                         staging_memory,
+                         MemoryCategory::Staging);
+
+    void* mapped;
+
+    vkMapMemory(pDevice.getDevice(), staging_memory, 0, data.bytes.size(), 0, &mapped);
+    memcpy(mapped, data.bytes.data(), data.bytes.size());
+    vkUnmapMemory(pDevice.getDevice(), staging_memory);
+
+    // Blits need a graphics queue, plain copies can go to the transfer queue
+    UploadContext& upload_context = generate ? pDevice.getGraphicsUploadContext() : pDevice.getUploadContext();
+
+    pUploadTicket = upload_context.Record([&](VkCommandBuffer command_buffer) {
+      pRecordCopy(command_buffer, staging_buffer, data);
+
+      if (generate) {
+        pRecordMipGeneration(command_buffer);
+      }
+    });
+
+    upload_context.OnComplete([device = &pDevice, staging_buffer, staging_memory]() {
+      vkDestroyBuffer(device->getDevice(), staging_buffer, nullptr);
+      device->FreeMemory(staging_memory);
+    });
+  }
+
+  Texture::~Texture() {
+    // Frames that are still in flight may sample this texture
+    pDevice.DeferDestroy([device = &pDevice, image = pImage, memory = pImageMemory, image_view = pImageView]() {
+      vkDestroyImageView(device->getDevice(), image_view, nullptr);
+      vkDestroyImage(device->getDevice(), image, nullptr);
+      device->FreeMemory(memory);
+    });
+  }
+
+  std::unique_ptr<Texture> Texture::FromFile(Device& device, const std::string& path, bool generate_mips) {
+    return std::make_unique<Texture>(device, TextureData::FromFile(path), generate_mips);
+  }
+
+  void Texture::pCreateImage(VkImageUsageFlags usage) {
+    VkImageCreateInfo image_info {};
+    image_info.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType     = VK_IMAGE_TYPE_2D;
+    image_info.extent.width  = pExtent.width;
+    image_info.extent.height = pExtent.height;
+    image_info.extent.depth  = 1;
+    image_info.mipLevels     = pMipLevels;
+    image_info.arrayLayers   = 1;
+    image_info.format        = pFormat;
+    image_info.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image_info.usage         = usage;
+    image_info.samples       = VK_SAMPLE_COUNT_1_BIT;
+    image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+
+    pDevice.CreateImageWithInfo(
+        image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pImage, pImageMemory, MemoryCategory::Texture);
+  }
+
+  void Texture::pCreateImageView() {
+    VkImageViewCreateInfo view_info {};
+    view_info.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image                           = pImage;
+    view_info.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format                          = pFormat;
+    view_info.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    view_info.subresourceRange.baseMipLevel   = 0;
+    view_info.subresourceRange.levelCount     = pMipLevels;
+    view_info.subresourceRange.baseArrayLayer = 0;
+    view_info.subresourceRange.layerCount     = 1;
+
+    if (vkCreateImageView(pDevice.getDevice(), &view_info, nullptr, &pImageView) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create texture image view");
+    }
+  }
+
+  void Texture::pRecordCopy(VkCommandBuffer command_buffer, VkBuffer staging_buffer, const TextureData& data) {
+    RecordImageBarrier(command_buffer,
+                       pImage,
+                       0,
+                       pMipLevels,
+                       VK_IMAGE_LAYOUT_UNDEFINED,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       0,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    std::vector<VkBufferImageCopy> regions;
+
+    for (uint32_t level = 0; level < data.mips.size(); level++) {
+      VkBufferImageCopy region {};
+      region.bufferOffset                    = data.mips[level].offset;
+      region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+      region.imageSubresource.mipLevel       = level;
+      region.imageSubresource.baseArrayLayer = 0;
+      region.imageSubresource.layerCount     = 1;
+      region.imageExtent                     = {data.mips[level].width, data.mips[level].height, 1};
+
+      regions.push_back(region);
+    }
+
+    vkCmdCopyBufferToImage(command_buffer,
+                           staging_buffer,
+                           pImage,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(regions.size()),
+                           regions.data());
+
+    if (pMipLevels == data.mips.size()) {
+      // Transfer stages only, this may run on a transfer queue. The end of the upload batch makes it visible to shaders
+      RecordImageBarrier(command_buffer,
+                         pImage,
+                         0,
+                         pMipLevels,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_ACCESS_TRANSFER_WRITE_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0);
+    }
+  }
+
+  void Texture::pRecordMipGeneration(VkCommandBuffer command_buffer) {
+    int32_t mip_width  = static_cast<int32_t>(pExtent.width);
+    int32_t mip_height = static_cast<int32_t>(pExtent.height);
+
+    // Each level is blitted from the one above it, which is then done and can be handed to shaders
+    for (uint32_t level = 1; level < pMipLevels; level++) {
+      RecordImageBarrier(command_buffer,
+                         pImage,
+                         level - 1,
+                         1,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_ACCESS_TRANSFER_WRITE_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_ACCESS_TRANSFER_READ_BIT);
+
+      int32_t next_width  = std::max(1, mip_width / 2);
+      int32_t next_height = std::max(1, mip_height / 2);
+
+      VkImageBlit blit {};
+      blit.srcOffsets[1]                 = {mip_width, mip_height, 1};
+      blit.srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+      blit.srcSubresource.mipLevel       = level - 1;
+      blit.srcSubresource.baseArrayLayer = 0;
+      blit.srcSubresource.layerCount     = 1;
+      blit.dstOffsets[1]                 = {next_width, next_height, 1};
+      blit.dstSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+      blit.dstSubresource.mipLevel       = level;
+      blit.dstSubresource.baseArrayLayer = 0;
+      blit.dstSubresource.layerCount     = 1;
+
+      vkCmdBlitImage(command_buffer,
+                     pImage,
+                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                     pImage,
+                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                     1,
+                     &blit,
+                     VK_FILTER_LINEAR);
+
+      RecordImageBarrier(command_buffer,
+                         pImage,
+                         level - 1,
+                         1,
+                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_ACCESS_TRANSFER_READ_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0);
+
+      mip_width  = next_width;
+      mip_height = next_height;
+    }
+
+    RecordImageBarrier(command_buffer,
+                       pImage,
+                       pMipLevels - 1,
+                       1,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_TRANSFER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0);
+  }
+}
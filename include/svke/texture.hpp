@@ -0,0 +1,89 @@
+#ifndef SVKE_TEXTURE_HPP
+#define SVKE_TEXTURE_HPP
+
+#include "defines.hpp"
+#include "device.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  struct TextureMip {
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    uint32_t     width;
+    uint32_t     height;
+  };
+
+  // Pixel data of a 2D texture and all the mips it comes with, packed into one buffer ready to be copied to an image.
+  // Supports BC1 to BC7 and 8 bit RGBA / BGRA, read from KTX2 (without supercompression) or DDS files.
+  struct TextureData {
+    VkFormat                format {VK_FORMAT_UNDEFINED};
+    uint32_t                width {0};
+    uint32_t                height {0};
+    std::vector<TextureMip> mips;
+    std::vector<uint8_t>    bytes;
+
+    bool         IsBlockCompressed() const;
+    VkDeviceSize getSize() const;
+
+    // Copy without the count largest mips, keeping at least the smallest one. Used to stream textures in at a reduced
+    // quality when memory is tight.
+    TextureData DropMips(uint32_t count) const;
+
+    static TextureData FromFile(const std::string& path);
+    static TextureData FromMemory(const std::vector<uint8_t>& file);  // KTX2 or DDS, told apart by the magic
+    static TextureData FromKtx2(const std::vector<uint8_t>& file);
+    static TextureData FromDds(const std::vector<uint8_t>& file);
+    static TextureData FromPixels(const void* rgba, uint32_t width, uint32_t height, bool srgb);
+
+    // Size in bytes of a width x height image, rounded up to whole blocks for compressed formats. Zero when the format
+    // is not supported.
+    static VkDeviceSize ImageSize(VkFormat format, uint32_t width, uint32_t height);
+
+   private:
+    void pAddMip(const uint8_t* data, VkDeviceSize size, uint32_t mip_width, uint32_t mip_height);
+  };
+
+  // Sampled 2D image. Mips that come with the data are uploaded with a single copy on the upload context, a texture
+  // with only its base level gets the rest of the chain blitted on the graphics queue instead.
+  class Texture {
+   public:
+    Texture(Device& device, const TextureData& data, bool generate_mips = true);
+    ~Texture();
+
+    Texture(const Texture& other) = delete;
+    Texture& operator=(const Texture& other) = delete;
+
+   public:
+    static std::unique_ptr<Texture> FromFile(Device& device, const std::string& path, bool generate_mips = true);
+
+    VkImage      getImage() const { return pImage; }
+    VkImageView  getImageView() const { return pImageView; }
+    VkFormat     getFormat() const { return pFormat; }
+    VkExtent2D   getExtent() const { return pExtent; }
+    uint32_t     getMipLevels() const { return pMipLevels; }
+    UploadTicket getUploadTicket() const { return pUploadTicket; }
+
+    VkDescriptorImageInfo getDescriptorInfo(VkSampler sampler) const {
+      return {sampler, pImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    }
+
+   private:
+    void pCreateImage(VkImageUsageFlags usage);
+    void pCreateImageView();
+    void pRecordCopy(VkCommandBuffer command_buffer, VkBuffer staging_buffer, const TextureData& data);
+    void pRecordMipGeneration(VkCommandBuffer command_buffer);
+
+   private:
+    Device& pDevice;
+
+    VkImage        pImage;
+    VkDeviceMemory pImageMemory;
+    VkImageView    pImageView;
+    VkFormat       pFormat;
+    VkExtent2D     pExtent;
+    uint32_t       pMipLevels;
+    UploadTicket   pUploadTicket {0};
+  };
+}
+
+#endif
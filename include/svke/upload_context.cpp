@@ -0,0 +1,377 @@
+#include "defines.hpp"
+#include "device.hpp"
+#include "pch.hpp"
+#include "upload_context.hpp"
+
+namespace svke {
+  UploadContext::UploadContext(Device& device, VkQueue queue, uint32_t queue_family, bool dedicated_queue)
+      : pDevice {device}, pQueue {queue} {
+    VkCommandPoolCreateInfo pool_info = {};
+    pool_info.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.queueFamilyIndex        = queue_family;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    if (vkCreateCommandPool(pDevice.getDevice(), &pool_info, nullptr, &pCommandPool) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create upload command pool");
+    }
+
+    if (dedicated_queue) {
+      VkSemaphoreTypeCreateInfo type_info = {};
+      type_info.sType                     = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+      type_info.semaphoreType             = VK_SEMAPHORE_TYPE_TIMELINE;
+      type_info.initialValue              = 0;
+
+      VkSemaphoreCreateInfo semaphore_info = {};
+      semaphore_info.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+      semaphore_info.pNext                 = &type_info;
+
+      if (vkCreateSemaphore(pDevice.getDevice(), &semaphore_info, nullptr, &pTimeline) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upload timeline semaphore");
+      }
+    }
+  }
+
+  UploadContext::~UploadContext() {
+    WaitIdle();
+
+    for (auto& batch : pFree) {
+      vkDestroyFence(pDevice.getDevice(), batch->fence, nullptr);
+
+      if (batch->staging_buffer != VK_NULL_HANDLE) {
+        vkUnmapMemory(pDevice.getDevice(), batch->staging_memory);
+        vkDestroyBuffer(pDevice.getDevice(), batch->staging_buffer, nullptr);
+        pDevice.FreeMemory(batch->staging_memory);
+      }
+    }
+
+    if (pTimeline != VK_NULL_HANDLE) {
+      vkDestroySemaphore(pDevice.getDevice(), pTimeline, nullptr);
+    }
+
+    vkDestroyCommandPool(pDevice.getDevice(), pCommandPool, nullptr);
+  }
+
+  UploadTicket UploadContext::Record(const std::function<void(VkCommandBuffer)>& record) {
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    Batch& batch = pGetRecordingBatch();
+    record(batch.command_buffer);
+
+    return batch.ticket;
+  }
+
+  UploadTicket UploadContext::UploadBuffer(const void* data, VkDeviceSize size, VkBuffer buffer, VkDeviceSize offset) {
+    if (size > STAGING_BLOCK_SIZE) {
+      return pUploadDedicated(data, size, buffer, offset);
+    }
+
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    Batch*       batch          = &pGetRecordingBatch();
+    VkDeviceSize staging_offset = (batch->staging_offset + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+
+    if (staging_offset + size > STAGING_BLOCK_SIZE) {
+      pSubmit();
+      batch          = &pGetRecordingBatch();
+      staging_offset = 0;
+    }
+
+    if (batch->staging_buffer == VK_NULL_HANDLE) {
+      pCreateStagingBlock(*batch);
+    }
+
+    memcpy(static_cast<char*>(batch->staging_mapped) + staging_offset, data, static_cast<size_t>(size));
+
+    VkBufferCopy copy_region {};
+    copy_region.srcOffset = staging_offset;
+    copy_region.dstOffset = offset;
+    copy_region.size      = size;
+    vkCmdCopyBuffer(batch->command_buffer, batch->staging_buffer, buffer, 1, &copy_region);
+
+    batch->staging_offset = staging_offset + size;
+    batch->staging_size += size;
+
+    UploadTicket ticket = batch->ticket;
+
+    if (batch->staging_size >= MAX_BATCH_STAGING_SIZE) {
+      pSubmit();
+    }
+
+    return ticket;
+  }
+
+  UploadTicket UploadContext::CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size) {
+    return Record([&](VkCommandBuffer command_buffer) {
+      VkBufferCopy copy_region {};
+      copy_region.srcOffset = 0;
+      copy_region.dstOffset = 0;
+      copy_region.size      = size;
+      vkCmdCopyBuffer(command_buffer, src_buffer, dst_buffer, 1, &copy_region);
+    });
+  }
+
+  UploadTicket UploadContext::CopyBufferToImage(VkBuffer buffer,
+                                                VkImage  image,
+                                                uint32_t width,
+                                                uint32_t height,
+                                                uint32_t layers) {
+    return Record([&](VkCommandBuffer command_buffer) {
+      VkBufferImageCopy region {};
+      region.bufferOffset      = 0;
+      region.bufferRowLength   = 0;
+      region.bufferImageHeight = 0;
+
+      region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+      region.imageSubresource.mipLevel       = 0;
+      region.imageSubresource.baseArrayLayer = 0;
+      region.imageSubresource.layerCount     = layers;
+
+      region.imageOffset = {0, 0, 0};
+      region.imageExtent = {width, height, 1};
+
+      vkCmdCopyBufferToImage(command_buffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    });
+  }
+
+  void UploadContext::OnComplete(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock {pMutex};
+    pGetRecordingBatch().on_complete.push_back(std::move(callback));
+  }
+
+  UploadTicket UploadContext::Submit() {
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    if (pRecording != nullptr) {
+      pSubmit();
+    }
+
+    return pNextTicket - 1;
+  }
+
+  bool UploadContext::IsComplete(UploadTicket ticket) {
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    pPoll();
+
+    return ticket <= pCompletedTicket;
+  }
+
+  void UploadContext::Wait(UploadTicket ticket) {
+    std::unique_lock<std::mutex> lock {pMutex};
+
+    if (pRecording != nullptr && ticket >= pRecording->ticket) {
+      pSubmit();
+    }
+
+    // Batches complete in order, waiting for the newest one the ticket covers waits for all of them
+    Batch* waited = nullptr;
+
+    for (auto batch = pInFlight.rbegin(); batch != pInFlight.rend(); batch++) {
+      if ((*batch)->ticket <= ticket) {
+        waited = batch->get();
+        break;
+      }
+    }
+
+    if (waited != nullptr) {
+      // Other threads keep recording and submitting meanwhile. A batch with waiters is not recycled, so its fence is
+      // not reset or reused before this wait returns.
+      VkFence fence = waited->fence;
+      waited->waiters++;
+
+      lock.unlock();
+      vkWaitForFences(pDevice.getDevice(), 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+      lock.lock();
+
+      waited->waiters--;
+    }
+
+    pPoll();
+  }
+
+  void UploadContext::WaitIdle() { Wait(std::numeric_limits<UploadTicket>::max()); }
+
+  void UploadContext::Poll() {
+    std::lock_guard<std::mutex> lock {pMutex};
+    pPoll();
+  }
+
+  UploadTicket UploadContext::pUploadDedicated(const void*  data,
+                                               VkDeviceSize size,
+                                               VkBuffer     buffer,
+                                               VkDeviceSize offset) {
+    VkBuffer       staging_buffer;
+    VkDeviceMemory staging_memory;
+
+    pDevice.CreateBuffer(size,
+                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         staging_buffer,
+                         staging_memory,
+                         MemoryCategory::Staging);
+
+    void* mapped;
+
+    vkMapMemory(pDevice.getDevice(), staging_memory, 0, size, 0, &mapped);
+    memcpy(mapped, data, static_cast<size_t>(size));
+    vkUnmapMemory(pDevice.getDevice(), staging_memory);
+
+    std::lock_guard<std::mutex> lock {pMutex};
+
+    Batch& batch = pGetRecordingBatch();
+
+    VkBufferCopy copy_region {};
+    copy_region.srcOffset = 0;
+    copy_region.dstOffset = offset;
+    copy_region.size      = size;
+    vkCmdCopyBuffer(batch.command_buffer, staging_buffer, buffer, 1, &copy_region);
+
+    batch.staging_size += size;
+    batch.on_complete.push_back([device = &pDevice, staging_buffer, staging_memory]() {
+      vkDestroyBuffer(device->getDevice(), staging_buffer, nullptr);
+      device->FreeMemory(staging_memory);
+    });
+
+    UploadTicket ticket = batch.ticket;
+
+    if (batch.staging_size >= MAX_BATCH_STAGING_SIZE) {
+      pSubmit();
+    }
+
+    return ticket;
+  }
+
+  void UploadContext::pCreateStagingBlock(Batch& batch) {
+    pDevice.CreateBuffer(STAGING_BLOCK_SIZE,
+                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         batch.staging_buffer,
+                         batch.staging_memory,
+                         MemoryCategory::Staging);
+
+    // Stays mapped for as long as the batch exists
+    vkMapMemory(pDevice.getDevice(), batch.staging_memory, 0, STAGING_BLOCK_SIZE, 0, &batch.staging_mapped);
+  }
+
+  UploadContext::Batch& UploadContext::pGetRecordingBatch() {
+    if (pRecording != nullptr) {
+      return *pRecording;
+    }
+
+    auto reusable = std::find_if(pFree.rbegin(), pFree.rend(), [](const auto& batch) { return batch->waiters == 0; });
+
+    if (reusable != pFree.rend()) {
+      pRecording = std::move(*reusable);
+      pFree.erase(std::next(reusable).base());
+
+      vkResetFences(pDevice.getDevice(), 1, &pRecording->fence);
+      vkResetCommandBuffer(pRecording->command_buffer, 0);
+    } else {
+      pRecording = std::make_unique<Batch>();
+
+      VkCommandBufferAllocateInfo alloc_info {};
+      alloc_info.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      alloc_info.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      alloc_info.commandPool        = pCommandPool;
+      alloc_info.commandBufferCount = 1;
+
+      if (vkAllocateCommandBuffers(pDevice.getDevice(), &alloc_info, &pRecording->command_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate upload command buffer");
+      }
+
+      VkFenceCreateInfo fence_info = {};
+      fence_info.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+      if (vkCreateFence(pDevice.getDevice(), &fence_info, nullptr, &pRecording->fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upload fence");
+      }
+    }
+
+    pRecording->ticket         = pNextTicket;
+    pRecording->staging_offset = 0;
+    pRecording->staging_size   = 0;
+
+    VkCommandBufferBeginInfo begin_info {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(pRecording->command_buffer, &begin_info);
+
+    return *pRecording;
+  }
+
+  void UploadContext::pSubmit() {
+    if (pTimeline == VK_NULL_HANDLE) {
+      pRecordVisibilityBarrier(pRecording->command_buffer);
+    }
+
+    if (vkEndCommandBuffer(pRecording->command_buffer) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to record upload command buffer");
+    }
+
+    VkTimelineSemaphoreSubmitInfo timeline_info {};
+    timeline_info.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_info.signalSemaphoreValueCount = 1;
+    timeline_info.pSignalSemaphoreValues    = &pRecording->ticket;
+
+    VkSubmitInfo submit_info {};
+    submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers    = &pRecording->command_buffer;
+
+    if (pTimeline != VK_NULL_HANDLE) {
+      submit_info.pNext                = &timeline_info;
+      submit_info.signalSemaphoreCount = 1;
+      submit_info.pSignalSemaphores    = &pTimeline;
+    }
+
+    {
+      auto queue_lock = pDevice.LockQueue(pQueue);
+
+      if (vkQueueSubmit(pQueue, 1, &submit_info, pRecording->fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit upload command buffer");
+      }
+    }
+
+    pInFlight.push_back(std::move(pRecording));
+    pNextTicket++;
+    pSubmitCount++;
+  }
+
+  void UploadContext::pRecordVisibilityBarrier(VkCommandBuffer command_buffer) {
+    VkMemoryBarrier barrier {};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                            VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+
+    vkCmdPipelineBarrier(command_buffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         0,
+                         1,
+                         &barrier,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+  }
+
+  void UploadContext::pPoll() {
+    // Batches go to a single queue, so they complete in submission order
+    while (!pInFlight.empty() && vkGetFenceStatus(pDevice.getDevice(), pInFlight.front()->fence) == VK_SUCCESS) {
+      pComplete(*pInFlight.front());
+      pFree.push_back(std::move(pInFlight.front()));
+      pInFlight.pop_front();
+    }
+  }
+
+  void UploadContext::pComplete(Batch& batch) {
+    for (auto& callback : batch.on_complete) {
+      callback();
+    }
+
+    batch.on_complete.clear();
+    pCompletedTicket = batch.ticket;
+  }
+}
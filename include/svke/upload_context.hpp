@@ -0,0 +1,100 @@
+#ifndef SVKE_UPLOAD_CONTEXT_HPP
+#define SVKE_UPLOAD_CONTEXT_HPP
+
+#include "defines.hpp"
+#include "pch.hpp"
+
+namespace svke {
+  class Device;
+
+  // Identifies a submission of the upload context, complete once every copy recorded before it was handed out has
+  // finished on the GPU. Tickets increase monotonically.
+  using UploadTicket = uint64_t;
+
+  // Records transfer work from any thread into one command buffer, which is submitted as a single batch with a fence
+  // when Submit is called, when it grows past MAX_BATCH_STAGING_SIZE, or when a ticket of it is waited on. Any of
+  // those may happen on any thread, submits hold the device's lock on the queue. Wait blocks on the fence without
+  // holding the context's lock. Command buffers and fences are recycled once their batch completes and nothing waits on
+  // it anymore.
+  // Each batch owns a persistently mapped staging block that UploadBuffer suballocates from, a batch whose block is
+  // full is submitted and the next one continues in its own block. Only uploads larger than a block get a staging
+  // buffer of their own, freed once their batch completes.
+  // On a shared queue a memory barrier at the end of every batch makes the copies visible to all later work on it. On a
+  // dedicated queue every batch instead signals the context's timeline semaphore with its ticket, which other queues
+  // wait on before using what was uploaded.
+  class UploadContext {
+   public:
+    static constexpr VkDeviceSize MAX_BATCH_STAGING_SIZE = 64 * 1024 * 1024;
+    static constexpr VkDeviceSize STAGING_BLOCK_SIZE     = 8 * 1024 * 1024;
+    static constexpr VkDeviceSize STAGING_ALIGNMENT      = 16;
+
+   public:
+    UploadContext(Device& device, VkQueue queue, uint32_t queue_family, bool dedicated_queue);
+    ~UploadContext();
+
+    UploadContext(const UploadContext& other) = delete;
+    UploadContext& operator=(const UploadContext& other) = delete;
+
+   public:
+    // Ticket that work recorded now will complete with
+    UploadTicket Record(const std::function<void(VkCommandBuffer)>& record);
+    UploadTicket UploadBuffer(const void* data, VkDeviceSize size, VkBuffer buffer, VkDeviceSize offset = 0);
+    UploadTicket CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size);
+    UploadTicket CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layers);
+
+    // Runs after the batch of the current ticket completes, usually to free what the copies read from
+    void OnComplete(std::function<void()> callback);
+
+    UploadTicket Submit();
+    bool         IsComplete(UploadTicket ticket);
+    void         Wait(UploadTicket ticket);
+    void         WaitIdle();
+
+    // Recycles completed batches, called once per frame
+    void Poll();
+
+    uint64_t getSubmitCount() const { return pSubmitCount; }
+
+    // Null on a shared queue. Signaled with the ticket of each batch as it completes.
+    VkSemaphore getTimeline() const { return pTimeline; }
+
+   private:
+    struct Batch {
+      VkCommandBuffer                    command_buffer {VK_NULL_HANDLE};
+      VkFence                            fence {VK_NULL_HANDLE};
+      UploadTicket                       ticket {0};
+      VkBuffer                           staging_buffer {VK_NULL_HANDLE};
+      VkDeviceMemory                     staging_memory {VK_NULL_HANDLE};
+      void*                              staging_mapped {nullptr};
+      VkDeviceSize                       staging_offset {0};  // Used bytes of the staging block
+      VkDeviceSize                       staging_size {0};    // Including dedicated staging buffers
+      uint32_t                           waiters {0};         // Threads blocked on the fence in Wait
+      std::vector<std::function<void()>> on_complete;
+    };
+
+    UploadTicket pUploadDedicated(const void* data, VkDeviceSize size, VkBuffer buffer, VkDeviceSize offset);
+    void         pCreateStagingBlock(Batch& batch);
+    Batch&       pGetRecordingBatch();
+    void         pSubmit();
+    void         pRecordVisibilityBarrier(VkCommandBuffer command_buffer);
+    void         pPoll();
+    void         pComplete(Batch& batch);
+
+   private:
+    Device&       pDevice;
+    VkQueue       pQueue;
+    VkCommandPool pCommandPool;
+    VkSemaphore   pTimeline {VK_NULL_HANDLE};
+
+    std::mutex                          pMutex;
+    std::unique_ptr<Batch>              pRecording;
+    std::deque<std::unique_ptr<Batch>>  pInFlight;
+    std::vector<std::unique_ptr<Batch>> pFree;
+
+    UploadTicket pNextTicket {1};
+    UploadTicket pCompletedTicket {0};
+    uint64_t     pSubmitCount {0};
+  };
+}
+
+#endif
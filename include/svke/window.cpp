@@ -4,8 +4,8 @@
 #include "pch.hpp"
 
 namespace svke {
-  Window::Window(uint32_t width, uint32_t height, const std::string& win_name)
-      : pWidth {width}, pHeight {height}, pWindowName {win_name} {
+  Window::Window(uint32_t width, uint32_t height, const std::string& win_name, bool visible)
+      : pWidth {width}, pHeight {height}, pVisible {visible}, pWindowName {win_name} {
     pCreateWindow();
   }
 
@@ -18,11 +18,16 @@ namespace svke {
 
   void Window::PollEvents() { glfwPollEvents(); }
 
+  void Window::SetSize(uint32_t width, uint32_t height) {
+    glfwSetWindowSize(pWindow, static_cast<int32_t>(width), static_cast<int32_t>(height));
+  }
+
   void Window::pCreateWindow() {
     glfwInit();
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, pVisible ? GLFW_TRUE : GLFW_FALSE);
 
     pWindow = glfwCreateWindow(pWidth, pHeight, pWindowName.c_str(), nullptr, nullptr);
 
@@ -42,5 +47,6 @@ namespace svke {
     svke_window->pFrameBufferResized = true;
     svke_window->pWidth              = width;
     svke_window->pHeight             = height;
+    svke_window->pLastResizeTime     = std::chrono::steady_clock::now();
   }
 }
\ No newline at end of file
@@ -7,7 +7,8 @@
 namespace svke {
   class Window {
    public:
-    Window(uint32_t width, uint32_t height, const std::string& win_name);
+    // An invisible window still gets a surface and swap chain, which is enough to render without showing anything
+    Window(uint32_t width, uint32_t height, const std::string& win_name, bool visible = true);
     ~Window();
 
     Window(const Window& other) = delete;
@@ -20,6 +21,15 @@ namespace svke {
     bool       WasResized() { return pFrameBufferResized; }
     void       ResetResize() { pFrameBufferResized = false; }
 
+    // Time since the last framebuffer resize event, used to wait for a resize to settle before recreating
+    std::chrono::steady_clock::duration getTimeSinceResize() const {
+      return std::chrono::steady_clock::now() - pLastResizeTime;
+    }
+
+    void SetSize(uint32_t width, uint32_t height);
+
+    bool IsKeyDown(int32_t key) { return glfwGetKey(pWindow, key) == GLFW_PRESS; }
+
     friend class Device;
 
    private:
@@ -33,6 +43,9 @@ namespace svke {
     uint32_t pWidth;
     uint32_t pHeight;
     bool     pFrameBufferResized = false;
+    bool     pVisible;
+
+    std::chrono::steady_clock::time_point pLastResizeTime {};
 
     GLFWwindow* pWindow;
     std::string pWindowName;